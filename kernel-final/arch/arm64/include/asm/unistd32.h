@@ -907,6 +907,10 @@ __SYSCALL(__NR_process_mrelease, sys_process_mrelease)
 __SYSCALL(__NR_futex_waitv, sys_futex_waitv)
 #define __NR_set_mempolicy_home_node 450
 __SYSCALL(__NR_set_mempolicy_home_node, sys_set_mempolicy_home_node)
+#define __NR_statx_batch 451
+__SYSCALL(__NR_statx_batch, sys_statx_batch)
+#define __NR_getdents_statx 452
+__SYSCALL(__NR_getdents_statx, sys_getdents_statx)
 
 /*
  * Please add new compat syscalls above this comment and update
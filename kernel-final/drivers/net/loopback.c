@@ -63,6 +63,69 @@
 struct net_device *blackhole_netdev;
 EXPORT_SYMBOL(blackhole_netdev);
 
+/* Per-CPU receive context used while GRO is enabled on the device. It
+ * is laid out like the softnet backlog: the transmit side appends to
+ * input_queue under its lock, the poller splices that into
+ * process_queue which only it touches.
+ */
+struct loopback_gro {
+	struct napi_struct	napi;
+	struct sk_buff_head	input_queue;
+	struct sk_buff_head	process_queue;
+};
+
+struct loopback_priv {
+	struct loopback_gro __percpu *gro;
+};
+
+static int loopback_gro_poll(struct napi_struct *napi, int budget)
+{
+	struct loopback_gro *lg = container_of(napi, struct loopback_gro, napi);
+	struct sk_buff *skb;
+	int work = 0;
+
+	while (work < budget) {
+		skb = __skb_dequeue(&lg->process_queue);
+		if (!skb) {
+			spin_lock(&lg->input_queue.lock);
+			skb_queue_splice_tail_init(&lg->input_queue,
+						   &lg->process_queue);
+			spin_unlock(&lg->input_queue.lock);
+
+			skb = __skb_dequeue(&lg->process_queue);
+			if (!skb)
+				break;
+		}
+		napi_gro_receive(napi, skb);
+		work++;
+	}
+
+	if (work < budget)
+		napi_complete_done(napi, work);
+
+	return work;
+}
+
+static int loopback_gro_enqueue(struct net_device *dev, struct sk_buff *skb)
+{
+	struct loopback_priv *priv = netdev_priv(dev);
+	struct loopback_gro *lg = this_cpu_ptr(priv->gro);
+
+	spin_lock(&lg->input_queue.lock);
+	if (unlikely(skb_queue_len(&lg->input_queue) >=
+		     READ_ONCE(netdev_max_backlog))) {
+		spin_unlock(&lg->input_queue.lock);
+		dev_core_stats_rx_dropped_inc(dev);
+		kfree_skb_reason(skb, SKB_DROP_REASON_CPU_BACKLOG);
+		return NET_RX_DROP;
+	}
+	__skb_queue_tail(&lg->input_queue, skb);
+	spin_unlock(&lg->input_queue.lock);
+
+	napi_schedule(&lg->napi);
+	return NET_RX_SUCCESS;
+}
+
 /* The higher levels take care of making this non-reentrant (it's
  * called with bh's disabled).
  */
@@ -86,8 +149,13 @@ static netdev_tx_t loopback_xmit(struct sk_buff *skb,
 	skb->protocol = eth_type_trans(skb, dev);
 
 	len = skb->len;
-	if (likely(__netif_rx(skb) == NET_RX_SUCCESS))
+	/* Let GRO merge back to back segments, e.g. small TCP_NODELAY writes */
+	if ((dev->features & NETIF_F_GRO) && netif_running(dev)) {
+		if (likely(loopback_gro_enqueue(dev, skb) == NET_RX_SUCCESS))
+			dev_lstats_add(dev, len);
+	} else if (likely(__netif_rx(skb) == NET_RX_SUCCESS)) {
 		dev_lstats_add(dev, len);
+	}
 
 	return NETDEV_TX_OK;
 }
@@ -141,20 +209,91 @@ static const struct ethtool_ops loopback_ethtool_ops = {
 
 static int loopback_dev_init(struct net_device *dev)
 {
+	struct loopback_priv *priv = netdev_priv(dev);
+	int cpu;
+
 	dev->lstats = netdev_alloc_pcpu_stats(struct pcpu_lstats);
 	if (!dev->lstats)
 		return -ENOMEM;
+
+	priv->gro = alloc_percpu(struct loopback_gro);
+	if (!priv->gro) {
+		free_percpu(dev->lstats);
+		dev->lstats = NULL;
+		return -ENOMEM;
+	}
+
+	for_each_possible_cpu(cpu) {
+		struct loopback_gro *lg = per_cpu_ptr(priv->gro, cpu);
+
+		skb_queue_head_init(&lg->input_queue);
+		__skb_queue_head_init(&lg->process_queue);
+		netif_napi_add(dev, &lg->napi, loopback_gro_poll);
+	}
+	return 0;
+}
+
+static void loopback_gro_purge(struct net_device *dev)
+{
+	struct loopback_priv *priv = netdev_priv(dev);
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct loopback_gro *lg = per_cpu_ptr(priv->gro, cpu);
+
+		skb_queue_purge(&lg->input_queue);
+		__skb_queue_purge(&lg->process_queue);
+	}
+}
+
+static void loopback_dev_uninit(struct net_device *dev)
+{
+	struct loopback_priv *priv = netdev_priv(dev);
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		__netif_napi_del(&per_cpu_ptr(priv->gro, cpu)->napi);
+	synchronize_net();
+
+	loopback_gro_purge(dev);
+}
+
+static int loopback_dev_open(struct net_device *dev)
+{
+	struct loopback_priv *priv = netdev_priv(dev);
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		napi_enable(&per_cpu_ptr(priv->gro, cpu)->napi);
+	return 0;
+}
+
+static int loopback_dev_stop(struct net_device *dev)
+{
+	struct loopback_priv *priv = netdev_priv(dev);
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		napi_disable(&per_cpu_ptr(priv->gro, cpu)->napi);
+
+	loopback_gro_purge(dev);
 	return 0;
 }
 
 static void loopback_dev_free(struct net_device *dev)
 {
+	struct loopback_priv *priv = netdev_priv(dev);
+
 	dev_net(dev)->loopback_dev = NULL;
+	free_percpu(priv->gro);
 	free_percpu(dev->lstats);
 }
 
 static const struct net_device_ops loopback_ops = {
 	.ndo_init        = loopback_dev_init,
+	.ndo_uninit      = loopback_dev_uninit,
+	.ndo_open        = loopback_dev_open,
+	.ndo_stop        = loopback_dev_stop,
 	.ndo_start_xmit  = loopback_xmit,
 	.ndo_get_stats64 = loopback_get_stats64,
 	.ndo_set_mac_address = eth_mac_addr,
@@ -211,7 +350,8 @@ static __net_init int loopback_net_init(struct net *net)
 	int err;
 
 	err = -ENOMEM;
-	dev = alloc_netdev(0, "lo", NET_NAME_PREDICTABLE, loopback_setup);
+	dev = alloc_netdev(sizeof(struct loopback_priv), "lo",
+			   NET_NAME_PREDICTABLE, loopback_setup);
 	if (!dev)
 		goto out;
 
@@ -2267,6 +2267,118 @@ static ssize_t tun_chr_read_iter(struct kiocb *iocb, struct iov_iter *to)
 	return ret;
 }
 
+/* A batch queued its packets with "more" set but ended early: push out
+ * what tun_rx_batched() or the NAPI queue is still holding.
+ */
+static void tun_rx_flush(struct tun_file *tfile)
+{
+	struct sk_buff_head *queue = &tfile->sk.sk_write_queue;
+	struct sk_buff_head process_queue;
+	struct sk_buff *skb;
+
+	if (tfile->napi_enabled) {
+		local_bh_disable();
+		napi_schedule(&tfile->napi);
+		local_bh_enable();
+		return;
+	}
+
+	__skb_queue_head_init(&process_queue);
+	spin_lock(&queue->lock);
+	skb_queue_splice_tail_init(queue, &process_queue);
+	spin_unlock(&queue->lock);
+
+	local_bh_disable();
+	while ((skb = __skb_dequeue(&process_queue))) {
+		skb_record_rx_queue(skb, tfile->queue_index);
+		netif_receive_skb(skb);
+	}
+	local_bh_enable();
+}
+
+static ssize_t tun_mmsg_one(struct tun_struct *tun, struct tun_file *tfile,
+			    struct tun_mmsghdr __user *umsg, bool send,
+			    int noblock, bool more)
+{
+	struct iovec iovstack[UIO_FASTIOV], *iov = iovstack;
+	struct tun_mmsghdr msg;
+	struct iov_iter iter;
+	ssize_t ret, len;
+
+	if (copy_from_user(&msg, umsg, sizeof(msg)))
+		return -EFAULT;
+
+	ret = import_iovec(send ? ITER_SOURCE : ITER_DEST,
+			   u64_to_user_ptr(msg.iov), msg.iovlen,
+			   UIO_FASTIOV, &iov, &iter);
+	if (ret < 0)
+		return ret;
+
+	if (send) {
+		ret = tun_get_user(tun, tfile, NULL, &iter, noblock, more);
+	} else {
+		len = iov_iter_count(&iter);
+		ret = tun_do_read(tun, tfile, &iter, noblock, NULL);
+		ret = min_t(ssize_t, ret, len);
+	}
+	kfree(iov);
+
+	if (ret >= 0 && put_user((u32)ret, &umsg->len))
+		ret = -EFAULT;
+
+	return ret;
+}
+
+/* TUNSENDMMSG/TUNRECVMMSG: the write side marks every packet but the last
+ * with "more", so that with IFF_NAPI the whole batch is queued before NAPI
+ * runs and GRO can coalesce it, and without it rx_batched (ethtool
+ * rx-frames) delivers the batch in one go. Reads only block for the first
+ * packet.
+ */
+static long tun_chr_mmsg(struct file *file, bool send, void __user *argp)
+{
+	struct tun_file *tfile = file->private_data;
+	struct tun_mmsghdr __user *umsgs;
+	struct tun_struct *tun;
+	struct tun_mmsg args;
+	ssize_t ret = 0;
+	int noblock;
+	u32 i;
+
+	if (copy_from_user(&args, argp, sizeof(args)))
+		return -EFAULT;
+
+	if (args.flags & ~MSG_DONTWAIT)
+		return -EINVAL;
+
+	if (!args.nr || args.nr > UIO_MAXIOV)
+		return -EINVAL;
+
+	tun = tun_get(tfile);
+	if (!tun)
+		return -EBADFD;
+
+	noblock = !!(file->f_flags & O_NONBLOCK) || (args.flags & MSG_DONTWAIT);
+	umsgs = u64_to_user_ptr(args.msgs);
+
+	for (i = 0; i < args.nr; i++) {
+		if (send)
+			ret = tun_mmsg_one(tun, tfile, &umsgs[i], true, noblock,
+					   i + 1 < args.nr);
+		else
+			ret = tun_mmsg_one(tun, tfile, &umsgs[i], false,
+					   noblock || i, false);
+		if (ret < 0)
+			break;
+	}
+
+	if (send && ret < 0 && i)
+		tun_rx_flush(tfile);
+
+	tun_put(tun);
+	return i ?: ret;
+}
+
 static void tun_prog_free(struct rcu_head *rcu)
 {
 	struct tun_prog *prog = container_of(rcu, struct tun_prog, rcu);
@@ -3094,6 +3206,8 @@ static long __tun_chr_ioctl(struct file *file, unsigned int cmd,
 				TUN_FEATURES, (unsigned int __user*)argp);
 	} else if (cmd == TUNSETQUEUE) {
 		return tun_set_queue(file, &ifr);
+	} else if (cmd == TUNSENDMMSG || cmd == TUNRECVMMSG) {
+		return tun_chr_mmsg(file, cmd == TUNSENDMMSG, argp);
 	} else if (cmd == SIOCGSKNS) {
 		if (!ns_capable(net->user_ns, CAP_NET_ADMIN))
 			return -EPERM;
@@ -3408,6 +3522,8 @@ static long tun_chr_compat_ioctl(struct file *file,
 	case TUNSETTXFILTER:
 	case TUNGETSNDBUF:
 	case TUNSETSNDBUF:
+	case TUNSENDMMSG:
+	case TUNRECVMMSG:
 	case SIOCGIFHWADDR:
 	case SIOCSIFHWADDR:
 		arg = (unsigned long)compat_ptr(arg);
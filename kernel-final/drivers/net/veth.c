@@ -27,6 +27,7 @@
 #include <linux/bpf_trace.h>
 #include <linux/net_tstamp.h>
 #include <net/page_pool.h>
+#include <net/xdp_sock_drv.h>
 
 #define DRV_NAME	"veth"
 #define DRV_VERSION	"1.0"
@@ -67,6 +68,8 @@ struct veth_rq {
 	struct ptr_ring		xdp_ring;
 	struct xdp_rxq_info	xdp_rxq;
 	struct page_pool	*page_pool;
+	struct xsk_buff_pool	*xsk_pool;
+	struct xdp_rxq_info	xsk_rxq;
 };
 
 struct veth_priv {
@@ -469,7 +472,7 @@ static struct net_device *veth_peer_dev(struct net_device *dev)
 
 static int veth_xdp_xmit(struct net_device *dev, int n,
 			 struct xdp_frame **frames,
-			 u32 flags, bool ndo_xmit)
+			 u32 flags, bool ndo_xmit, int rxq)
 {
 	struct veth_priv *rcv_priv, *priv = netdev_priv(dev);
 	int i, ret = -ENXIO, nxmit = 0;
@@ -486,7 +489,9 @@ static int veth_xdp_xmit(struct net_device *dev, int n,
 		goto out;
 
 	rcv_priv = netdev_priv(rcv);
-	rq = &rcv_priv->rq[veth_select_rxq(rcv)];
+	if (rxq < 0 || rxq >= rcv->real_num_rx_queues)
+		rxq = veth_select_rxq(rcv);
+	rq = &rcv_priv->rq[rxq];
 	/* The napi pointer is set if NAPI is enabled, which ensures that
 	 * xdp_ring is initialized on receive side and the peer device is up.
 	 */
@@ -529,7 +534,7 @@ static int veth_ndo_xdp_xmit(struct net_device *dev, int n,
 {
 	int err;
 
-	err = veth_xdp_xmit(dev, n, frames, flags, true);
+	err = veth_xdp_xmit(dev, n, frames, flags, true, -1);
 	if (err < 0) {
 		struct veth_priv *priv = netdev_priv(dev);
 
@@ -543,7 +548,7 @@ static void veth_xdp_flush_bq(struct veth_rq *rq, struct veth_xdp_tx_bq *bq)
 {
 	int sent, i, err = 0, drops;
 
-	sent = veth_xdp_xmit(rq->dev, bq->count, bq->q, 0, false);
+	sent = veth_xdp_xmit(rq->dev, bq->count, bq->q, 0, false, -1);
 	if (sent < 0) {
 		err = sent;
 		sent = 0;
@@ -716,6 +721,21 @@ static void veth_xdp_get(struct xdp_buff *xdp)
 		__skb_frag_ref(&sinfo->frags[i]);
 }
 
+/* Buffers up to half a page are carved out of a shared page_pool page,
+ * larger ones get a page of their own. Returns the page, the offset into it
+ * and in @size the truesize of the buffer.
+ */
+static struct page *veth_pp_alloc(struct page_pool *pool,
+				  unsigned int *offset, unsigned int *size)
+{
+	if ((pool->p.flags & PP_FLAG_PAGE_FRAG) && *size <= PAGE_SIZE / 2)
+		return page_pool_dev_alloc_frag(pool, offset, *size);
+
+	*offset = 0;
+	*size = PAGE_SIZE;
+	return page_pool_dev_alloc_pages(pool);
+}
+
 static int veth_convert_skb_to_xdp_buff(struct veth_rq *rq,
 					struct xdp_buff *xdp,
 					struct sk_buff **pskb)
@@ -726,7 +746,7 @@ static int veth_convert_skb_to_xdp_buff(struct veth_rq *rq,
 	if (skb_shared(skb) || skb_head_is_locked(skb) ||
 	    skb_shinfo(skb)->nr_frags ||
 	    skb_headroom(skb) < XDP_PACKET_HEADROOM) {
-		u32 size, len, max_head_size, off;
+		u32 size, truesize, len, max_head_size, off, page_off;
 		struct sk_buff *nskb;
 		struct page *page;
 		int i, head_off;
@@ -743,11 +763,13 @@ static int veth_convert_skb_to_xdp_buff(struct veth_rq *rq,
 			goto drop;
 
 		/* Allocate skb head */
-		page = page_pool_dev_alloc_pages(rq->page_pool);
+		size = min_t(u32, skb->len, max_head_size);
+		truesize = VETH_XDP_HEADROOM + SKB_HEAD_ALIGN(size);
+		page = veth_pp_alloc(rq->page_pool, &page_off, &truesize);
 		if (!page)
 			goto drop;
 
-		nskb = build_skb(page_address(page), PAGE_SIZE);
+		nskb = build_skb(page_address(page) + page_off, truesize);
 		if (!nskb) {
 			page_pool_put_full_page(rq->page_pool, page, true);
 			goto drop;
@@ -757,7 +779,6 @@ static int veth_convert_skb_to_xdp_buff(struct veth_rq *rq,
 		skb_copy_header(nskb, skb);
 		skb_mark_for_recycle(nskb);
 
-		size = min_t(u32, skb->len, max_head_size);
 		if (skb_copy_bits(skb, 0, nskb->data, size)) {
 			consume_skb(nskb);
 			goto drop;
@@ -772,16 +793,18 @@ static int veth_convert_skb_to_xdp_buff(struct veth_rq *rq,
 		len = skb->len - off;
 
 		for (i = 0; i < MAX_SKB_FRAGS && off < skb->len; i++) {
-			page = page_pool_dev_alloc_pages(rq->page_pool);
+			size = min_t(u32, len, PAGE_SIZE);
+			truesize = size;
+			page = veth_pp_alloc(rq->page_pool, &page_off,
+					     &truesize);
 			if (!page) {
 				consume_skb(nskb);
 				goto drop;
 			}
 
-			size = min_t(u32, len, PAGE_SIZE);
-			skb_add_rx_frag(nskb, i, page, 0, size, PAGE_SIZE);
-			if (skb_copy_bits(skb, off, page_address(page),
-					  size)) {
+			skb_add_rx_frag(nskb, i, page, page_off, size, truesize);
+			if (skb_copy_bits(skb, off,
+					  page_address(page) + page_off, size)) {
 				consume_skb(nskb);
 				goto drop;
 			}
@@ -928,10 +951,302 @@ xdp_xmit:
 	return NULL;
 }
 
+static struct sk_buff *veth_xsk_construct_skb(struct veth_rq *rq,
+					      struct xdp_buff *xdp)
+{
+	unsigned int metasize = xdp->data - xdp->data_meta;
+	unsigned int len = xdp->data_end - xdp->data_meta;
+	struct sk_buff *skb;
+
+	skb = napi_alloc_skb(&rq->xdp_napi, len);
+	if (unlikely(!skb))
+		return NULL;
+
+	skb_put_data(skb, xdp->data_meta, len);
+	if (metasize) {
+		__skb_pull(skb, metasize);
+		skb_metadata_set(skb, metasize);
+	}
+	xsk_buff_free(xdp);
+
+	skb->protocol = eth_type_trans(skb, rq->dev);
+
+	return skb;
+}
+
+static void veth_xsk_copy_frame(void *to, struct xdp_frame *frame)
+{
+	struct skb_shared_info *sinfo;
+	int i;
+
+	memcpy(to, frame->data, frame->len);
+	if (likely(!xdp_frame_has_frags(frame)))
+		return;
+
+	to += frame->len;
+	sinfo = xdp_get_shared_info_from_frame(frame);
+	for (i = 0; i < sinfo->nr_frags; i++) {
+		skb_frag_t *frag = &sinfo->frags[i];
+
+		memcpy(to, skb_frag_address(frag), skb_frag_size(frag));
+		to += skb_frag_size(frag);
+	}
+}
+
+/* Receive into a buffer of the AF_XDP zero-copy pool bound to this queue.
+ * The packet is copied once, straight into the umem, after which an
+ * XDP_REDIRECT to the socket hands the buffer over without another copy.
+ * Frames with fragments are gathered into the one buffer. Returns false
+ * if the packet has to take the regular path, e.g. when it doesn't fit.
+ */
+static bool veth_xsk_rcv(struct veth_rq *rq, struct xsk_buff_pool *pool,
+			 void *ptr, struct veth_xdp_tx_bq *bq,
+			 struct veth_stats *stats)
+{
+	struct xdp_frame *frame = NULL;
+	struct veth_xdp_buff *vxbuf;
+	struct bpf_prog *xdp_prog;
+	struct sk_buff *skb = NULL;
+	struct xdp_buff *xdp;
+	u32 act, len;
+
+	if (veth_is_xdp_frame(ptr)) {
+		frame = veth_ptr_to_xdp(ptr);
+		len = xdp_get_frame_len(frame);
+	} else {
+		skb = ptr;
+		if (skb_is_gso(skb) || skb_csum_is_sctp(skb))
+			return false;
+		len = skb->len + skb->data - skb_mac_header(skb);
+	}
+
+	if (len > xsk_pool_get_rx_frame_size(pool))
+		return false;
+
+	rcu_read_lock();
+	xdp_prog = rcu_dereference(rq->xdp_prog);
+	if (unlikely(!xdp_prog)) {
+		rcu_read_unlock();
+		return false;
+	}
+
+	stats->xdp_bytes += len;
+
+	xdp = xsk_buff_alloc(pool);
+	if (unlikely(!xdp)) {
+		stats->rx_drops++;
+		goto out;
+	}
+
+	if (frame) {
+		veth_xsk_copy_frame(xdp->data, frame);
+		xdp_return_frame(frame);
+		frame = NULL;
+	} else {
+		__skb_push(skb, skb->data - skb_mac_header(skb));
+		if (skb_copy_bits(skb, 0, xdp->data, len)) {
+			xsk_buff_free(xdp);
+			stats->rx_drops++;
+			goto out;
+		}
+		/* The copy leaves checksum offload behind, finish it here */
+		if (skb->ip_summed == CHECKSUM_PARTIAL) {
+			int off = skb_checksum_start_offset(skb);
+			__wsum csum = skb_checksum(skb, off, len - off, 0);
+
+			*(__sum16 *)(xdp->data + off + skb->csum_offset) =
+				csum_fold(csum) ?: CSUM_MANGLED_0;
+		}
+	}
+	xsk_buff_set_size(xdp, len);
+
+	/* The metadata kfuncs look for the skb right behind the xdp_buff */
+	XSK_CHECK_PRIV_TYPE(struct veth_xdp_buff);
+	vxbuf = (struct veth_xdp_buff *)xdp;
+	vxbuf->skb = skb;
+
+	act = bpf_prog_run_xdp(xdp_prog, xdp);
+
+	switch (act) {
+	case XDP_PASS: {
+		struct sk_buff *nskb = veth_xsk_construct_skb(rq, xdp);
+
+		if (unlikely(!nskb)) {
+			xsk_buff_free(xdp);
+			stats->rx_drops++;
+			break;
+		}
+		napi_gro_receive(&rq->xdp_napi, nskb);
+		break;
+	}
+	case XDP_TX:
+		if (unlikely(veth_xdp_tx(rq, xdp, bq) < 0)) {
+			trace_xdp_exception(rq->dev, xdp_prog, act);
+			xsk_buff_free(xdp);
+			stats->rx_drops++;
+			break;
+		}
+		stats->xdp_tx++;
+		break;
+	case XDP_REDIRECT:
+		if (xdp_do_redirect(rq->dev, xdp, xdp_prog)) {
+			xsk_buff_free(xdp);
+			stats->rx_drops++;
+			break;
+		}
+		stats->xdp_redirect++;
+		break;
+	default:
+		bpf_warn_invalid_xdp_action(rq->dev, xdp_prog, act);
+		fallthrough;
+	case XDP_ABORTED:
+		trace_xdp_exception(rq->dev, xdp_prog, act);
+		fallthrough;
+	case XDP_DROP:
+		xsk_buff_free(xdp);
+		stats->xdp_drops++;
+		break;
+	}
+out:
+	rcu_read_unlock();
+	if (frame)
+		xdp_return_frame(frame);
+	if (skb)
+		consume_skb(skb);
+
+	return true;
+}
+
+static struct xdp_frame *veth_xsk_build_frame(void *data, u32 len)
+{
+	struct xdp_frame *frame;
+	struct page *page;
+
+	if (len > PAGE_SIZE - VETH_XDP_HEADROOM -
+		  SKB_DATA_ALIGN(sizeof(struct skb_shared_info)))
+		return NULL;
+
+	page = dev_alloc_page();
+	if (unlikely(!page))
+		return NULL;
+
+	frame = page_address(page);
+	memset(frame, 0, sizeof(*frame));
+	frame->data = (void *)frame + VETH_XDP_HEADROOM;
+	frame->len = len;
+	frame->headroom = VETH_XDP_HEADROOM - sizeof(*frame);
+	frame->frame_sz = PAGE_SIZE;
+	frame->mem.type = MEM_TYPE_PAGE_ORDER0;
+	memcpy(frame->data, data, len);
+
+	return frame;
+}
+
+static void veth_xsk_xmit_frames(struct veth_rq *rq, struct xdp_frame **frames,
+				 int n, int qid)
+{
+	struct veth_priv *priv = netdev_priv(rq->dev);
+	int i, sent;
+
+	sent = veth_xdp_xmit(rq->dev, n, frames, XDP_XMIT_FLUSH, true, qid);
+	if (sent < 0)
+		sent = 0;
+
+	for (i = sent; unlikely(i < n); i++)
+		xdp_return_frame(frames[i]);
+	if (unlikely(sent < n))
+		atomic64_add(n - sent, &priv->dropped);
+}
+
+static void veth_xsk_xmit_skb(struct veth_rq *rq, void *data, u32 len,
+			      int qid)
+{
+	struct sk_buff *skb;
+
+	skb = napi_alloc_skb(&rq->xdp_napi, len);
+	if (unlikely(!skb)) {
+		struct veth_priv *priv = netdev_priv(rq->dev);
+
+		atomic64_inc(&priv->dropped);
+		return;
+	}
+
+	skb_put_data(skb, data, len);
+	skb->dev = rq->dev;
+	skb_set_queue_mapping(skb, qid);
+	veth_xmit(skb, rq->dev);
+}
+
+/* Transmit from the AF_XDP zero-copy pool bound to this queue. The peer
+ * may keep a packet for as long as it likes, so each one is copied out of
+ * the umem and its descriptor completed right away. Packets go to the
+ * peer queue with the same index, as XDP frames when that queue runs NAPI
+ * and as skbs otherwise.
+ */
+static int veth_xsk_xmit(struct veth_rq *rq, struct xsk_buff_pool *pool,
+			 int budget)
+{
+	struct veth_priv *rcv_priv, *priv = netdev_priv(rq->dev);
+	struct xdp_frame *frames[VETH_XDP_TX_BULK_SIZE];
+	int qid = rq - priv->rq;
+	struct net_device *rcv;
+	int done = 0, n = 0;
+	bool use_xdp = false;
+	struct xdp_desc desc;
+
+	rcu_read_lock();
+	rcv = rcu_dereference(priv->peer);
+	if (rcv && qid < rcv->real_num_rx_queues) {
+		rcv_priv = netdev_priv(rcv);
+		use_xdp = !!rcu_access_pointer(rcv_priv->rq[qid].napi);
+	}
+
+	while (done < budget && xsk_tx_peek_desc(pool, &desc)) {
+		void *data = xsk_buff_raw_get_data(pool, desc.addr);
+		struct xdp_frame *frame;
+
+		done++;
+		if (!use_xdp) {
+			veth_xsk_xmit_skb(rq, data, desc.len, qid);
+			continue;
+		}
+
+		frame = veth_xsk_build_frame(data, desc.len);
+		if (unlikely(!frame)) {
+			atomic64_inc(&priv->dropped);
+			continue;
+		}
+
+		frames[n++] = frame;
+		if (n == VETH_XDP_TX_BULK_SIZE) {
+			veth_xsk_xmit_frames(rq, frames, n, qid);
+			n = 0;
+		}
+	}
+	if (n)
+		veth_xsk_xmit_frames(rq, frames, n, qid);
+	rcu_read_unlock();
+
+	if (done) {
+		xsk_tx_release(pool);
+		xsk_tx_completed(pool, done);
+	}
+
+	if (xsk_uses_need_wakeup(pool)) {
+		if (done < budget)
+			xsk_set_tx_need_wakeup(pool);
+		else
+			xsk_clear_tx_need_wakeup(pool);
+	}
+
+	return done;
+}
+
 static int veth_xdp_rcv(struct veth_rq *rq, int budget,
 			struct veth_xdp_tx_bq *bq,
 			struct veth_stats *stats)
 {
+	struct xsk_buff_pool *pool = READ_ONCE(rq->xsk_pool);
 	int i, done = 0, n_xdpf = 0;
 	void *xdpf[VETH_XDP_BATCH];
 
@@ -941,6 +1256,11 @@ static int veth_xdp_rcv(struct veth_rq *rq, int budget,
 		if (!ptr)
 			break;
 
+		if (pool && veth_xsk_rcv(rq, pool, ptr, bq, stats)) {
+			done++;
+			continue;
+		}
+
 		if (veth_is_xdp_frame(ptr)) {
 			/* ndo_xdp_xmit */
 			struct xdp_frame *frame = veth_ptr_to_xdp(ptr);
@@ -991,6 +1311,7 @@ static int veth_poll(struct napi_struct *napi, int budget)
 	struct veth_rq *rq =
 		container_of(napi, struct veth_rq, xdp_napi);
 	struct veth_stats stats = {};
+	struct xsk_buff_pool *pool;
 	struct veth_xdp_tx_bq bq;
 	int done;
 
@@ -999,6 +1320,10 @@ static int veth_poll(struct napi_struct *napi, int budget)
 	xdp_set_return_frame_no_direct();
 	done = veth_xdp_rcv(rq, budget, &bq, &stats);
 
+	pool = READ_ONCE(rq->xsk_pool);
+	if (pool && veth_xsk_xmit(rq, pool, budget) == budget)
+		done = budget;
+
 	if (stats.xdp_redirect > 0)
 		xdp_do_flush();
 
@@ -1027,8 +1352,12 @@ static int veth_create_page_pool(struct veth_rq *rq)
 		.pool_size = VETH_RING_SIZE,
 		.nid = NUMA_NO_NODE,
 		.dev = &rq->dev->dev,
+		.netdev = rq->dev,
 	};
 
+	if (!PAGE_POOL_DMA_USE_PP_FRAG_COUNT)
+		pp_params.flags |= PP_FLAG_PAGE_FRAG;
+
 	rq->page_pool = page_pool_create(&pp_params);
 	if (IS_ERR(rq->page_pool)) {
 		int err = PTR_ERR(rq->page_pool);
@@ -1319,7 +1648,8 @@ static void veth_set_xdp_features(struct net_device *dev)
 		struct veth_priv *priv_peer = netdev_priv(peer);
 		xdp_features_t val = NETDEV_XDP_ACT_BASIC |
 				     NETDEV_XDP_ACT_REDIRECT |
-				     NETDEV_XDP_ACT_RX_SG;
+				     NETDEV_XDP_ACT_RX_SG |
+				     NETDEV_XDP_ACT_XSK_ZEROCOPY;
 
 		if (priv_peer->_xdp_prog || veth_gro_requested(peer))
 			val |= NETDEV_XDP_ACT_NDO_XMIT |
@@ -1337,12 +1667,17 @@ static int veth_set_channels(struct net_device *dev,
 	unsigned int old_rx_count, new_rx_count;
 	struct veth_priv *peer_priv;
 	struct net_device *peer;
-	int err;
+	int err, i;
 
 	/* sanity check. Upper bounds are already enforced by the caller */
 	if (!ch->rx_count || !ch->tx_count)
 		return -EINVAL;
 
+	/* don't drop queues with an AF_XDP socket bound to them */
+	for (i = ch->rx_count; i < dev->real_num_rx_queues; i++)
+		if (priv->rq[i].xsk_pool)
+			return -EBUSY;
+
 	/* avoid braking XDP, if that is enabled */
 	peer = rtnl_dereference(priv->peer);
 	peer_priv = peer ? netdev_priv(peer) : NULL;
@@ -1686,11 +2021,99 @@ err:
 	return err;
 }
 
+static int veth_xsk_pool_setup(struct net_device *dev,
+			       struct xsk_buff_pool *pool, u16 qid)
+{
+	struct veth_priv *priv = netdev_priv(dev);
+	struct xsk_buff_pool *old_pool;
+	struct veth_rq *rq;
+	bool running;
+	int err;
+
+	if (qid >= dev->real_num_rx_queues)
+		return -EINVAL;
+
+	rq = &priv->rq[qid];
+	old_pool = rq->xsk_pool;
+	if (!pool && !old_pool)
+		return -EINVAL;
+
+	if (pool) {
+		/* No DMA device, packets are copied by the CPU */
+		err = xsk_pool_dma_map(pool, NULL, 0);
+		if (err)
+			return err;
+
+		err = xdp_rxq_info_reg(&rq->xsk_rxq, dev, qid,
+				       rq->xdp_napi.napi_id);
+		if (err < 0)
+			goto err_unmap;
+
+		err = xdp_rxq_info_reg_mem_model(&rq->xsk_rxq,
+						 MEM_TYPE_XSK_BUFF_POOL, NULL);
+		if (err < 0)
+			goto err_unreg;
+
+		xsk_pool_set_rxq_info(pool, &rq->xsk_rxq);
+	}
+
+	/* Quiesce NAPI so that it never sees a pool going away */
+	running = !!rtnl_dereference(rq->napi);
+	if (running)
+		napi_disable(&rq->xdp_napi);
+	WRITE_ONCE(rq->xsk_pool, pool);
+	if (running)
+		napi_enable(&rq->xdp_napi);
+
+	if (!pool) {
+		xdp_rxq_info_unreg(&rq->xsk_rxq);
+		xsk_pool_dma_unmap(old_pool, 0);
+	}
+
+	return 0;
+
+err_unreg:
+	xdp_rxq_info_unreg(&rq->xsk_rxq);
+err_unmap:
+	xsk_pool_dma_unmap(pool, 0);
+
+	return err;
+}
+
+static int veth_xsk_wakeup(struct net_device *dev, u32 qid, u32 flags)
+{
+	struct veth_priv *priv = netdev_priv(dev);
+	struct veth_rq *rq;
+
+	if (!netif_running(dev))
+		return -ENETDOWN;
+
+	if (qid >= dev->real_num_rx_queues)
+		return -EINVAL;
+
+	rq = &priv->rq[qid];
+	if (!READ_ONCE(rq->xsk_pool) || !rcu_access_pointer(rq->xdp_prog))
+		return -EINVAL;
+
+	if (!rcu_access_pointer(rq->napi))
+		return -ENETDOWN;
+
+	/* Received packets schedule NAPI themselves, only Tx needs a kick */
+	local_bh_disable();
+	napi_schedule(&rq->xdp_napi);
+	local_bh_enable();
+
+	return 0;
+}
+
 static int veth_xdp(struct net_device *dev, struct netdev_bpf *xdp)
 {
 	switch (xdp->command) {
 	case XDP_SETUP_PROG:
 		return veth_xdp_set(dev, xdp->prog, xdp->extack);
+	case XDP_SETUP_XSK_POOL:
+		return veth_xsk_pool_setup(dev, xdp->xsk.pool,
+					   xdp->xsk.queue_id);
 	default:
 		return -EINVAL;
 	}
@@ -1740,6 +2163,7 @@ static const struct net_device_ops veth_netdev_ops = {
 	.ndo_set_rx_headroom	= veth_set_rx_headroom,
 	.ndo_bpf		= veth_xdp,
 	.ndo_xdp_xmit		= veth_ndo_xdp_xmit,
+	.ndo_xsk_wakeup		= veth_xsk_wakeup,
 	.ndo_get_peer_dev	= veth_peer_dev,
 };
 
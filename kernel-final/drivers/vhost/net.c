@@ -40,6 +40,11 @@ module_param(experimental_zcopytx, int, 0444);
 MODULE_PARM_DESC(experimental_zcopytx, "Enable Zero Copy TX;"
 		                       " 1 -Enable; 0 - Disable");
 
+static bool adaptive_busyloop = true;
+module_param(adaptive_busyloop, bool, 0644);
+MODULE_PARM_DESC(adaptive_busyloop, "Treat the busy loop timeout as an upper"
+		 " bound and adapt it to how often busy polling finds work");
+
 /* Max number of bytes transferred before requeueing the job.
  * Using this limit prevents one virtqueue from starving others. */
 #define VHOST_NET_WEIGHT 0x80000
@@ -54,6 +59,9 @@ MODULE_PARM_DESC(experimental_zcopytx, "Enable Zero Copy TX;"
 #define VHOST_MAX_PEND 128
 #define VHOST_GOODCOPY_LEN 256
 
+/* Lower bound of an adaptive busy loop timeout, in busy_clock() units */
+#define VHOST_NET_BUSYLOOP_MIN 2
+
 /*
  * For transmit, used buffer len is unused; we override it to track buffer
  * status internally; used for zerocopy tx only.
@@ -127,6 +135,8 @@ struct vhost_net_virtqueue {
 	struct vhost_net_buf rxq;
 	/* Batched XDP buffs */
 	struct xdp_buff *xdp;
+	/* Current adaptive busy loop timeout, 0 until first used */
+	unsigned long busyloop_cur;
 };
 
 struct vhost_net {
@@ -312,6 +322,7 @@ static void vhost_net_vq_reset(struct vhost_net *n)
 		n->vqs[i].ubufs = NULL;
 		n->vqs[i].vhost_hlen = 0;
 		n->vqs[i].sock_hlen = 0;
+		n->vqs[i].busyloop_cur = 0;
 		vhost_net_buf_init(&n->vqs[i].rxq);
 	}
 
@@ -421,6 +432,37 @@ static bool vhost_can_busy_poll(unsigned long endtime)
 		      !signal_pending(current));
 }
 
+/* Start from the configured timeout, halve it whenever busy polling runs
+ * out of time without finding work and double it again, up to the
+ * configured timeout, whenever it does find work. Polling that never pays
+ * off then costs little, and leaves a shared worker to the other devices.
+ */
+static unsigned long vhost_net_busyloop_timeout(struct vhost_net_virtqueue *nvq)
+{
+	unsigned long limit = nvq->vq.busyloop_timeout;
+
+	if (!adaptive_busyloop)
+		return limit;
+
+	if (!nvq->busyloop_cur || nvq->busyloop_cur > limit)
+		nvq->busyloop_cur = limit;
+
+	return nvq->busyloop_cur;
+}
+
+static void vhost_net_busyloop_adapt(struct vhost_net_virtqueue *nvq,
+				     bool found)
+{
+	unsigned long limit = nvq->vq.busyloop_timeout;
+
+	if (found)
+		nvq->busyloop_cur = min(nvq->busyloop_cur * 2, limit);
+	else
+		nvq->busyloop_cur = max(nvq->busyloop_cur / 2,
+					min_t(unsigned long, limit,
+					      VHOST_NET_BUSYLOOP_MIN));
+}
+
 static void vhost_net_disable_vq(struct vhost_net *n,
 				 struct vhost_virtqueue *vq)
 {
@@ -524,10 +566,12 @@ static void vhost_net_busy_poll(struct vhost_net *net,
 				bool *busyloop_intr,
 				bool poll_rx)
 {
+	struct vhost_net_virtqueue *nvq;
 	unsigned long busyloop_timeout;
-	unsigned long endtime;
+	unsigned long start, endtime, now;
 	struct socket *sock;
 	struct vhost_virtqueue *vq = poll_rx ? tvq : rvq;
+	bool found = false;
 
 	/* Try to hold the vq mutex of the paired virtqueue. We can't
 	 * use mutex_lock() here since we could not guarantee a
@@ -539,11 +583,12 @@ static void vhost_net_busy_poll(struct vhost_net *net,
 	vhost_disable_notify(&net->dev, vq);
 	sock = vhost_vq_get_backend(rvq);
 
-	busyloop_timeout = poll_rx ? rvq->busyloop_timeout:
-				     tvq->busyloop_timeout;
+	nvq = container_of(poll_rx ? rvq : tvq, struct vhost_net_virtqueue, vq);
+	busyloop_timeout = vhost_net_busyloop_timeout(nvq);
 
 	preempt_disable();
-	endtime = busy_clock() + busyloop_timeout;
+	start = busy_clock();
+	endtime = start + busyloop_timeout;
 
 	while (vhost_can_busy_poll(endtime)) {
 		if (vhost_has_work(&net->dev)) {
@@ -553,14 +598,21 @@ static void vhost_net_busy_poll(struct vhost_net *net,
 
 		if ((sock_has_rx_data(sock) &&
 		     !vhost_vq_avail_empty(&net->dev, rvq)) ||
-		    !vhost_vq_avail_empty(&net->dev, tvq))
+		    !vhost_vq_avail_empty(&net->dev, tvq)) {
+			found = true;
 			break;
+		}
 
 		cpu_relax();
 	}
 
+	now = busy_clock();
 	preempt_enable();
 
+	vhost_account_poll(&net->dev, (u64)(now - start) << 10);
+	if (adaptive_busyloop && (found || time_after(now, endtime)))
+		vhost_net_busyloop_adapt(nvq, found);
+
 	if (poll_rx || sock_has_rx_data(sock))
 		vhost_net_busy_poll_try_queue(net, vq);
 	else if (!poll_rx) /* On tx here, sock has no rx data. */
@@ -1340,6 +1392,7 @@ static int vhost_net_open(struct inode *inode, struct file *f)
 		n->vqs[i].vhost_hlen = 0;
 		n->vqs[i].sock_hlen = 0;
 		n->vqs[i].rx_ring = NULL;
+		n->vqs[i].busyloop_cur = 0;
 		vhost_net_buf_init(&n->vqs[i].rxq);
 	}
 	vhost_dev_init(dev, vqs, VHOST_NET_VQ_MAX,
@@ -30,6 +30,7 @@
 #include <linux/interval_tree_generic.h>
 #include <linux/nospec.h>
 #include <linux/kcov.h>
+#include <linux/xarray.h>
 
 #include "vhost.h"
 
@@ -231,43 +232,87 @@ void vhost_poll_stop(struct vhost_poll *poll)
 }
 EXPORT_SYMBOL_GPL(vhost_poll_stop);
 
-void vhost_dev_flush(struct vhost_dev *dev)
+/* dev->worker is only changed by the owner, under dev->mutex or on release */
+static struct vhost_worker *vhost_dev_worker(struct vhost_dev *dev)
 {
-	struct vhost_flush_struct flush;
-
-	if (dev->worker.vtsk) {
-		init_completion(&flush.wait_event);
-		vhost_work_init(&flush.work, vhost_flush_work);
-
-		vhost_work_queue(dev, &flush.work);
-		wait_for_completion(&flush.wait_event);
-	}
+	return rcu_dereference_protected(dev->worker, 1);
 }
-EXPORT_SYMBOL_GPL(vhost_dev_flush);
 
-void vhost_work_queue(struct vhost_dev *dev, struct vhost_work *work)
+static void vhost_worker_queue(struct vhost_worker *worker,
+			       struct vhost_work *work)
 {
-	if (!dev->worker.vtsk)
-		return;
-
 	if (!test_and_set_bit(VHOST_WORK_QUEUED, &work->flags)) {
 		/* We can only add the work to the list after we're
 		 * sure it was not in the list.
 		 * test_and_set_bit() implies a memory barrier.
 		 */
-		llist_add(&work->node, &dev->worker.work_list);
-		vhost_task_wake(dev->worker.vtsk);
+		llist_add(&work->node, &worker->work_list);
+		vhost_task_wake(worker->vtsk);
 	}
 }
+
+static void vhost_worker_flush(struct vhost_worker *worker)
+{
+	struct vhost_flush_struct flush;
+
+	init_completion(&flush.wait_event);
+	vhost_work_init(&flush.work, vhost_flush_work);
+
+	vhost_worker_queue(worker, &flush.work);
+	wait_for_completion(&flush.wait_event);
+}
+
+void vhost_dev_flush(struct vhost_dev *dev)
+{
+	struct vhost_worker *worker = vhost_dev_worker(dev);
+
+	if (worker)
+		vhost_worker_flush(worker);
+}
+EXPORT_SYMBOL_GPL(vhost_dev_flush);
+
+void vhost_work_queue(struct vhost_dev *dev, struct vhost_work *work)
+{
+	struct vhost_worker *worker;
+
+	rcu_read_lock();
+	worker = rcu_dereference(dev->worker);
+	if (worker)
+		vhost_worker_queue(worker, work);
+	rcu_read_unlock();
+}
 EXPORT_SYMBOL_GPL(vhost_work_queue);
 
-/* A lockless hint for busy polling code to exit the loop */
+/* A lockless hint for busy polling code to exit the loop. With a shared
+ * worker this also covers work queued by the other devices it serves.
+ */
 bool vhost_has_work(struct vhost_dev *dev)
 {
-	return !llist_empty(&dev->worker.work_list);
+	struct vhost_worker *worker;
+	bool has_work;
+
+	rcu_read_lock();
+	worker = rcu_dereference(dev->worker);
+	has_work = worker && !llist_empty(&worker->work_list);
+	rcu_read_unlock();
+
+	return has_work;
 }
 EXPORT_SYMBOL_GPL(vhost_has_work);
 
+/* Called from the worker to account time spent busy polling */
+void vhost_account_poll(struct vhost_dev *dev, u64 ns)
+{
+	struct vhost_worker *worker;
+
+	rcu_read_lock();
+	worker = rcu_dereference(dev->worker);
+	if (worker)
+		WRITE_ONCE(worker->poll_ns, worker->poll_ns + ns);
+	rcu_read_unlock();
+}
+EXPORT_SYMBOL_GPL(vhost_account_poll);
+
 void vhost_poll_queue(struct vhost_poll *poll)
 {
 	vhost_work_queue(poll->dev, &poll->work);
@@ -338,6 +383,7 @@ static bool vhost_worker(void *data)
 	struct vhost_worker *worker = data;
 	struct vhost_work *work, *work_next;
 	struct llist_node *node;
+	u64 start;
 
 	node = llist_del_all(&worker->work_list);
 	if (node) {
@@ -349,7 +395,11 @@ static bool vhost_worker(void *data)
 		llist_for_each_entry_safe(work, work_next, node, node) {
 			clear_bit(VHOST_WORK_QUEUED, &work->flags);
 			kcov_remote_start_common(worker->kcov_handle);
+			start = local_clock();
 			work->fn(work);
+			WRITE_ONCE(worker->busy_ns, worker->busy_ns +
+				   local_clock() - start);
+			WRITE_ONCE(worker->works, worker->works + 1);
 			kcov_remote_stop();
 			cond_resched();
 		}
@@ -458,8 +508,7 @@ void vhost_dev_init(struct vhost_dev *dev,
 	dev->umem = NULL;
 	dev->iotlb = NULL;
 	dev->mm = NULL;
-	memset(&dev->worker, 0, sizeof(dev->worker));
-	init_llist_head(&dev->worker.work_list);
+	RCU_INIT_POINTER(dev->worker, NULL);
 	dev->iov_limit = iov_limit;
 	dev->weight = weight;
 	dev->byte_weight = byte_weight;
@@ -531,32 +580,137 @@ static void vhost_detach_mm(struct vhost_dev *dev)
 	dev->mm = NULL;
 }
 
+/* Workers by id, so devices of the same owner can share them */
+static DEFINE_XARRAY_ALLOC(vhost_workers);
+static DEFINE_MUTEX(vhost_workers_mutex);
+
+static void vhost_worker_put(struct vhost_worker *worker)
+{
+	if (!refcount_dec_and_mutex_lock(&worker->refcount,
+					 &vhost_workers_mutex))
+		return;
+
+	xa_erase(&vhost_workers, worker->id);
+	mutex_unlock(&vhost_workers_mutex);
+
+	WARN_ON(!llist_empty(&worker->work_list));
+	vhost_task_stop(worker->vtsk);
+	kfree(worker);
+}
+
 static void vhost_worker_free(struct vhost_dev *dev)
 {
-	if (!dev->worker.vtsk)
+	struct vhost_worker *worker = vhost_dev_worker(dev);
+
+	if (!worker)
 		return;
 
-	WARN_ON(!llist_empty(&dev->worker.work_list));
-	vhost_task_stop(dev->worker.vtsk);
-	dev->worker.kcov_handle = 0;
-	dev->worker.vtsk = NULL;
+	RCU_INIT_POINTER(dev->worker, NULL);
+	vhost_worker_put(worker);
 }
 
 static int vhost_worker_create(struct vhost_dev *dev)
 {
+	struct vhost_worker *worker;
 	struct vhost_task *vtsk;
 	char name[TASK_COMM_LEN];
+	int ret;
+
+	worker = kzalloc(sizeof(*worker), GFP_KERNEL_ACCOUNT);
+	if (!worker)
+		return -ENOMEM;
+
+	init_llist_head(&worker->work_list);
+	refcount_set(&worker->refcount, 1);
+	worker->mm = dev->mm;
 
 	snprintf(name, sizeof(name), "vhost-%d", current->pid);
 
-	vtsk = vhost_task_create(vhost_worker, &dev->worker, name);
-	if (!vtsk)
-		return -ENOMEM;
+	vtsk = vhost_task_create(vhost_worker, worker, name);
+	if (!vtsk) {
+		ret = -ENOMEM;
+		goto free_worker;
+	}
 
-	dev->worker.kcov_handle = kcov_common_handle();
-	dev->worker.vtsk = vtsk;
+	worker->kcov_handle = kcov_common_handle();
+	worker->vtsk = vtsk;
+	/* vhost_task_stop() waits for the task to exit, so it must run */
 	vhost_task_start(vtsk);
+
+	mutex_lock(&vhost_workers_mutex);
+	ret = xa_alloc(&vhost_workers, &worker->id, worker, xa_limit_32b,
+		       GFP_KERNEL);
+	mutex_unlock(&vhost_workers_mutex);
+	if (ret < 0)
+		goto stop_worker;
+
+	rcu_assign_pointer(dev->worker, worker);
 	return 0;
+
+stop_worker:
+	vhost_task_stop(vtsk);
+free_worker:
+	kfree(worker);
+	return ret;
+}
+
+static long vhost_attach_worker(struct vhost_dev *dev, u32 __user *argp)
+{
+	struct vhost_worker *worker, *old = vhost_dev_worker(dev);
+	u32 id;
+	int i;
+
+	if (get_user(id, argp))
+		return -EFAULT;
+
+	if (!old)
+		return -EINVAL;
+
+	/* Devices with running queues can't switch, see below for the rest */
+	for (i = 0; i < dev->nvqs; ++i) {
+		if (dev->vqs[i]->kick || vhost_vq_get_backend(dev->vqs[i]))
+			return -EBUSY;
+	}
+
+	mutex_lock(&vhost_workers_mutex);
+	worker = xa_load(&vhost_workers, id);
+	if (!worker || worker->mm != dev->mm) {
+		mutex_unlock(&vhost_workers_mutex);
+		return -ENOENT;
+	}
+	refcount_inc(&worker->refcount);
+	mutex_unlock(&vhost_workers_mutex);
+
+	/*
+	 * Work can still be queued without a backend, e.g. vhost-vsock's
+	 * send_pkt_work once a CID is set. Once the grace period is over
+	 * nobody can queue on the old worker anymore; flush what it has
+	 * before dropping our reference.
+	 */
+	rcu_assign_pointer(dev->worker, worker);
+	synchronize_rcu();
+	vhost_worker_flush(old);
+	vhost_worker_put(old);
+	return 0;
+}
+
+static long vhost_get_worker_stats(struct vhost_dev *dev,
+				   struct vhost_worker_stats __user *argp)
+{
+	struct vhost_worker *worker = vhost_dev_worker(dev);
+	struct vhost_worker_stats stats = {};
+
+	if (!worker)
+		return -EINVAL;
+
+	stats.id = worker->id;
+	stats.pid = vhost_task_pid(worker->vtsk);
+	stats.users = refcount_read(&worker->refcount);
+	stats.works = READ_ONCE(worker->works);
+	stats.busy_ns = READ_ONCE(worker->busy_ns);
+	stats.poll_ns = READ_ONCE(worker->poll_ns);
+
+	return copy_to_user(argp, &stats, sizeof(stats)) ? -EFAULT : 0;
 }
 
 /* Caller should have device mutex */
@@ -1735,6 +1889,7 @@ EXPORT_SYMBOL_GPL(vhost_init_device_iotlb);
 /* Caller must have device mutex */
 long vhost_dev_ioctl(struct vhost_dev *d, unsigned int ioctl, void __user *argp)
 {
+	struct vhost_worker *worker;
 	struct eventfd_ctx *ctx;
 	u64 p;
 	long r;
@@ -1795,6 +1950,16 @@ long vhost_dev_ioctl(struct vhost_dev *d, unsigned int ioctl, void __user *argp)
 		if (ctx)
 			eventfd_ctx_put(ctx);
 		break;
+	case VHOST_GET_WORKER:
+		worker = vhost_dev_worker(d);
+		r = worker ? put_user(worker->id, (u32 __user *)argp) : -EINVAL;
+		break;
+	case VHOST_ATTACH_WORKER:
+		r = vhost_attach_worker(d, argp);
+		break;
+	case VHOST_GET_WORKER_STATS:
+		r = vhost_get_worker_stats(d, argp);
+		break;
 	default:
 		r = -ENOIOCTLCMD;
 		break;
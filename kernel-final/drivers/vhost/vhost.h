@@ -12,6 +12,7 @@
 #include <linux/virtio_config.h>
 #include <linux/virtio_ring.h>
 #include <linux/atomic.h>
+#include <linux/refcount.h>
 #include <linux/vhost_iotlb.h>
 #include <linux/irqbypass.h>
 
@@ -30,6 +31,15 @@ struct vhost_worker {
 	struct vhost_task	*vtsk;
 	struct llist_head	work_list;
 	u64			kcov_handle;
+	/* One reference per device served, see VHOST_ATTACH_WORKER */
+	refcount_t		refcount;
+	u32			id;
+	/* Owner of the devices allowed to share this worker */
+	struct mm_struct	*mm;
+	/* Utilization stats, only written by the worker itself */
+	u64			works;
+	u64			busy_ns;
+	u64			poll_ns;
 };
 
 /* Poll a file (eventfd or socket) */
@@ -46,6 +56,7 @@ struct vhost_poll {
 void vhost_work_init(struct vhost_work *work, vhost_work_fn_t fn);
 void vhost_work_queue(struct vhost_dev *dev, struct vhost_work *work);
 bool vhost_has_work(struct vhost_dev *dev);
+void vhost_account_poll(struct vhost_dev *dev, u64 ns);
 
 void vhost_poll_init(struct vhost_poll *poll, vhost_work_fn_t fn,
 		     __poll_t mask, struct vhost_dev *dev);
@@ -158,7 +169,8 @@ struct vhost_dev {
 	struct vhost_virtqueue **vqs;
 	int nvqs;
 	struct eventfd_ctx *log_ctx;
-	struct vhost_worker worker;
+	/* RCU so vhost_work_queue() can race with VHOST_ATTACH_WORKER */
+	struct vhost_worker __rcu *worker;
 	struct vhost_iotlb *umem;
 	struct vhost_iotlb *iotlb;
 	spinlock_t iotlb_lock;
@@ -565,6 +565,8 @@ struct btrfs_fs_info {
 	struct task_struct *transaction_kthread;
 	struct task_struct *cleaner_kthread;
 	u32 thread_pool_size;
+	/* Max active compression workers, see delalloc_workers */
+	u32 compress_workers;
 
 	struct kobject *space_info_kobj;
 	struct kobject *qgroups_kobj;
@@ -515,6 +515,8 @@ struct async_chunk {
 	struct cgroup_subsys_state *blkcg_css;
 	struct btrfs_work work;
 	struct async_cow *async_cow;
+	/* inode_need_compress() of the range, taken when it was queued */
+	bool compress;
 };
 
 struct async_cow {
@@ -713,10 +715,10 @@ again:
 
 	/*
 	 * we do compression for mount -o compress and when the
-	 * inode has not been flagged as nocompress.  This flag can
-	 * change at any time if we discover bad compression ratios.
+	 * inode has not been flagged as nocompress.  cow_file_range_async()
+	 * already asked inode_need_compress(), don't sample the data again.
 	 */
-	if (inode_need_compress(inode, start, end)) {
+	if (async_chunk->compress) {
 		WARN_ON(pages);
 		pages = kcalloc(nr_pages, sizeof(struct page *), GFP_NOFS);
 		if (!pages) {
@@ -1536,6 +1538,8 @@ static int cow_file_range_async(struct btrfs_inode *inode,
 	u64 num_chunks = DIV_ROUND_UP(end - start, SZ_512K);
 	int i;
 	bool should_compress;
+	/* Verdict for the chunk at @start, < 0 if not known yet */
+	int verdict = -1;
 	unsigned nofs_flag;
 	const blk_opf_t write_flags = wbc_to_write_flags(wbc);
 
@@ -1568,11 +1572,37 @@ static int cow_file_range_async(struct btrfs_inode *inode,
 	async_chunk = ctx->chunks;
 	atomic_set(&ctx->num_chunks, num_chunks);
 
-	for (i = 0; i < num_chunks; i++) {
-		if (should_compress)
+	for (i = 0; i < num_chunks && start <= end; i++) {
+		bool compress;
+
+		if (should_compress) {
 			cur_end = min(end, start + SZ_512K - 1);
-		else
+			/*
+			 * Rule out incompressible data here rather than in the
+			 * worker, and write a run of such chunks as a single
+			 * uncompressed chunk.  The verdict that ends the run
+			 * is kept for the next chunk, which covers the same
+			 * range.
+			 */
+			if (verdict < 0)
+				verdict = inode_need_compress(inode, start,
+							      cur_end);
+			compress = verdict;
+			verdict = -1;
+			while (!compress && cur_end < end) {
+				u64 next_end = min(end, cur_end + SZ_512K);
+
+				verdict = inode_need_compress(inode,
+							      cur_end + 1,
+							      next_end);
+				if (verdict)
+					break;
+				cur_end = next_end;
+			}
+		} else {
 			cur_end = end;
+			compress = inode_need_compress(inode, start, end);
+		}
 
 		/*
 		 * igrab is called higher up in the call chain, take only the
@@ -1584,6 +1614,7 @@ static int cow_file_range_async(struct btrfs_inode *inode,
 		async_chunk[i].start = start;
 		async_chunk[i].end = cur_end;
 		async_chunk[i].write_flags = write_flags;
+		async_chunk[i].compress = compress;
 		INIT_LIST_HEAD(&async_chunk[i].extents);
 
 		/*
@@ -1632,6 +1663,12 @@ static int cow_file_range_async(struct btrfs_inode *inode,
 		*nr_written += nr_pages;
 		start = cur_end + 1;
 	}
+
+	/* Drop the references of the chunks merged away above. */
+	if (i < num_chunks &&
+	    atomic_sub_and_test(num_chunks - i, &ctx->num_chunks))
+		kvfree(ctx);
+
 	*page_started = 1;
 	return 0;
 }
@@ -1277,6 +1277,37 @@ static ssize_t btrfs_bg_reclaim_threshold_store(struct kobject *kobj,
 BTRFS_ATTR_RW(, bg_reclaim_threshold, btrfs_bg_reclaim_threshold_show,
 	      btrfs_bg_reclaim_threshold_store);
 
+static ssize_t btrfs_compress_workers_show(struct kobject *kobj,
+					   struct kobj_attribute *a, char *buf)
+{
+	struct btrfs_fs_info *fs_info = to_fs_info(kobj);
+
+	return sysfs_emit(buf, "%u\n", READ_ONCE(fs_info->compress_workers));
+}
+
+static ssize_t btrfs_compress_workers_store(struct kobject *kobj,
+					    struct kobj_attribute *a,
+					    const char *buf, size_t len)
+{
+	struct btrfs_fs_info *fs_info = to_fs_info(kobj);
+	u32 workers;
+	int ret;
+
+	ret = kstrtou32(buf, 10, &workers);
+	if (ret)
+		return ret;
+
+	if (workers == 0 || workers > num_possible_cpus())
+		return -EINVAL;
+
+	WRITE_ONCE(fs_info->compress_workers, workers);
+	btrfs_workqueue_set_max(fs_info->delalloc_workers, workers);
+
+	return len;
+}
+BTRFS_ATTR_RW(, compress_workers, btrfs_compress_workers_show,
+	      btrfs_compress_workers_store);
+
 /*
  * Per-filesystem information and stats.
  *
@@ -1295,6 +1326,7 @@ static const struct attribute *btrfs_attrs[] = {
 	BTRFS_ATTR_PTR(, read_policy),
 	BTRFS_ATTR_PTR(, bg_reclaim_threshold),
 	BTRFS_ATTR_PTR(, commit_stats),
+	BTRFS_ATTR_PTR(, compress_workers),
 	NULL,
 };
 
@@ -136,6 +136,13 @@ struct erofs_sb_info {
 	/* pseudo inode to manage cached pages */
 	struct inode *managed_cache;
 
+	/* LRU cache of decompressed pclusters, protected by its xa_lock */
+	struct xarray decomp_cache;
+	struct list_head decomp_cache_lru;
+	unsigned int max_decomp_cache_pages;
+	unsigned long decomp_cache_pages;
+	unsigned long decomp_cache_hits, decomp_cache_misses;
+
 	struct erofs_sb_lz4_info lz4;
 #endif	/* CONFIG_EROFS_FS_ZIP */
 	struct inode *packed_inode;
@@ -501,6 +508,9 @@ void z_erofs_exit_zip_subsystem(void);
 int erofs_try_to_free_all_cached_pages(struct erofs_sb_info *sbi,
 				       struct erofs_workgroup *egrp);
 int erofs_try_to_free_cached_page(struct page *page);
+unsigned long z_erofs_decomp_cache_count(void);
+unsigned long z_erofs_shrink_decomp_cache(struct erofs_sb_info *sbi,
+					  unsigned long nr_shrink);
 int z_erofs_load_lz4_config(struct super_block *sb,
 			    struct erofs_super_block *dsb,
 			    struct z_erofs_lz4_cfgs *lz4, int len);
@@ -790,6 +790,8 @@ static int erofs_fc_fill_super(struct super_block *sb, struct fs_context *fc)
 
 #ifdef CONFIG_EROFS_FS_ZIP
 	xa_init(&sbi->managed_pslots);
+	xa_init(&sbi->decomp_cache);
+	INIT_LIST_HEAD(&sbi->decomp_cache_lru);
 #endif
 
 	/* get the root inode */
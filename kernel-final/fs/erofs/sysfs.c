@@ -12,6 +12,7 @@ enum {
 	attr_feature,
 	attr_pointer_ui,
 	attr_pointer_bool,
+	attr_pointer_ul,
 };
 
 enum {
@@ -53,15 +54,26 @@ static struct erofs_attr erofs_attr_##_name = {			\
 #define EROFS_ATTR_RW_BOOL(_name, _struct)	\
 	EROFS_ATTR_RW(_name, pointer_bool, _struct)
 
+#define EROFS_RO_ATTR_UL(_name, _struct)	\
+	EROFS_RO_ATTR(_name, pointer_ul, _struct)
+
 #define ATTR_LIST(name) (&erofs_attr_##name.attr)
 
 #ifdef CONFIG_EROFS_FS_ZIP
 EROFS_ATTR_RW_UI(sync_decompress, erofs_mount_opts);
+EROFS_ATTR_RW_UI(max_decomp_cache_pages, erofs_sb_info);
+EROFS_RO_ATTR_UL(decomp_cache_pages, erofs_sb_info);
+EROFS_RO_ATTR_UL(decomp_cache_hits, erofs_sb_info);
+EROFS_RO_ATTR_UL(decomp_cache_misses, erofs_sb_info);
 #endif
 
 static struct attribute *erofs_attrs[] = {
 #ifdef CONFIG_EROFS_FS_ZIP
 	ATTR_LIST(sync_decompress),
+	ATTR_LIST(max_decomp_cache_pages),
+	ATTR_LIST(decomp_cache_pages),
+	ATTR_LIST(decomp_cache_hits),
+	ATTR_LIST(decomp_cache_misses),
 #endif
 	NULL,
 };
@@ -123,6 +135,10 @@ static ssize_t erofs_attr_show(struct kobject *kobj,
 		if (!ptr)
 			return 0;
 		return sysfs_emit(buf, "%d\n", *(bool *)ptr);
+	case attr_pointer_ul:
+		if (!ptr)
+			return 0;
+		return sysfs_emit(buf, "%lu\n", READ_ONCE(*(unsigned long *)ptr));
 	}
 	return 0;
 }
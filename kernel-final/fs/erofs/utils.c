@@ -206,6 +206,7 @@ void erofs_shrinker_unregister(struct super_block *sb)
 	mutex_lock(&sbi->umount_mutex);
 	/* clean up all remaining workgroups in memory */
 	erofs_shrink_workstation(sbi, ~0UL);
+	z_erofs_shrink_decomp_cache(sbi, ~0UL);
 
 	spin_lock(&erofs_sb_list_lock);
 	list_del(&sbi->list);
@@ -216,7 +217,8 @@ void erofs_shrinker_unregister(struct super_block *sb)
 static unsigned long erofs_shrink_count(struct shrinker *shrink,
 					struct shrink_control *sc)
 {
-	return atomic_long_read(&erofs_global_shrink_cnt);
+	return atomic_long_read(&erofs_global_shrink_cnt) +
+		z_erofs_decomp_cache_count();
 }
 
 static unsigned long erofs_shrink_scan(struct shrinker *shrink,
@@ -254,7 +256,9 @@ static unsigned long erofs_shrink_scan(struct shrinker *shrink,
 		spin_unlock(&erofs_sb_list_lock);
 		sbi->shrinker_run_no = run_no;
 
-		freed += erofs_shrink_workstation(sbi, nr - freed);
+		freed += z_erofs_shrink_decomp_cache(sbi, nr - freed);
+		if (freed < nr)
+			freed += erofs_shrink_workstation(sbi, nr - freed);
 
 		spin_lock(&erofs_sb_list_lock);
 		/* Get the next list element before we move this one */
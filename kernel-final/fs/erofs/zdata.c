@@ -1144,6 +1144,189 @@ struct z_erofs_bvec_item {
 	struct list_head list;
 };
 
+/*
+ * Decompressed pclusters can be kept in a per-sb LRU cache so that other
+ * inodes referring to the same (deduplicated) pcluster, or the same file
+ * read again after its page cache was dropped, just copy the data instead
+ * of decompressing it once more.  The cache is disabled unless its size is
+ * set by "max_decomp_cache_pages" in sysfs.
+ */
+struct z_erofs_decomp_entry {
+	struct list_head lru;
+	refcount_t ref;
+	pgoff_t index;
+	unsigned int pageofs_out, length, nr_pages;
+	struct page *pages[];
+};
+
+/* number of cached entries of all superblocks, for the shrinker */
+static atomic_long_t z_erofs_decomp_cache_cnt;
+
+unsigned long z_erofs_decomp_cache_count(void)
+{
+	return atomic_long_read(&z_erofs_decomp_cache_cnt);
+}
+
+static void z_erofs_decomp_entry_put(struct z_erofs_decomp_entry *e)
+{
+	unsigned int i;
+
+	if (!refcount_dec_and_test(&e->ref))
+		return;
+	for (i = 0; i < e->nr_pages; ++i)
+		__free_page(e->pages[i]);
+	kfree(e);
+}
+
+/* should be called with xa_lock held */
+static void z_erofs_decomp_cache_del(struct erofs_sb_info *sbi,
+				     struct z_erofs_decomp_entry *e,
+				     struct list_head *freelist)
+{
+	DBG_BUGON(__xa_erase(&sbi->decomp_cache, e->index) != e);
+	list_move(&e->lru, freelist);
+	sbi->decomp_cache_pages -= e->nr_pages;
+	atomic_long_dec(&z_erofs_decomp_cache_cnt);
+}
+
+static void z_erofs_decomp_cache_free(struct list_head *freelist)
+{
+	struct z_erofs_decomp_entry *e, *n;
+
+	list_for_each_entry_safe(e, n, freelist, lru) {
+		list_del(&e->lru);
+		z_erofs_decomp_entry_put(e);
+	}
+}
+
+unsigned long z_erofs_shrink_decomp_cache(struct erofs_sb_info *sbi,
+					  unsigned long nr_shrink)
+{
+	LIST_HEAD(freelist);
+	unsigned long freed = 0;
+
+	xa_lock(&sbi->decomp_cache);
+	while (freed < nr_shrink && !list_empty(&sbi->decomp_cache_lru)) {
+		z_erofs_decomp_cache_del(sbi,
+				list_last_entry(&sbi->decomp_cache_lru,
+						struct z_erofs_decomp_entry,
+						lru), &freelist);
+		++freed;
+	}
+	xa_unlock(&sbi->decomp_cache);
+	z_erofs_decomp_cache_free(&freelist);
+	return freed;
+}
+
+static bool z_erofs_decomp_cacheable(struct z_erofs_decompress_backend *be)
+{
+	/* inline pclusters have no unique index, plain data isn't worth it */
+	return READ_ONCE(EROFS_SB(be->sb)->max_decomp_cache_pages) &&
+		!z_erofs_is_inline_pcluster(be->pcl) &&
+		be->pcl->algorithmformat < Z_EROFS_COMPRESSION_MAX;
+}
+
+static struct z_erofs_decomp_entry *
+z_erofs_decomp_cache_get(struct z_erofs_decompress_backend *be)
+{
+	struct erofs_sb_info *const sbi = EROFS_SB(be->sb);
+	struct z_erofs_pcluster *pcl = be->pcl;
+	struct z_erofs_decomp_entry *e;
+
+	xa_lock(&sbi->decomp_cache);
+	e = xa_load(&sbi->decomp_cache, pcl->obj.index);
+	if (e && e->pageofs_out == pcl->pageofs_out &&
+	    e->length >= pcl->length) {
+		refcount_inc(&e->ref);
+		list_move(&e->lru, &sbi->decomp_cache_lru);
+		++sbi->decomp_cache_hits;
+	} else {
+		e = NULL;
+		++sbi->decomp_cache_misses;
+	}
+	xa_unlock(&sbi->decomp_cache);
+	return e;
+}
+
+static void z_erofs_decomp_cache_copy(struct z_erofs_decompress_backend *be,
+				      struct z_erofs_decomp_entry *e)
+{
+	unsigned int start = be->pcl->pageofs_out;
+	unsigned int end = start + be->pcl->length;
+	unsigned int i;
+
+	for (i = 0; i < be->nr_pages; ++i) {
+		unsigned int pos = i << PAGE_SHIFT;
+		unsigned int from = max(start, pos) - pos;
+		unsigned int to = min(end, pos + (unsigned int)PAGE_SIZE) - pos;
+
+		if (be->decompressed_pages[i])
+			memcpy_page(be->decompressed_pages[i], from,
+				    e->pages[i], from, to - from);
+	}
+}
+
+/* only keep pclusters which are fully decompressed into the page array */
+static bool z_erofs_decomp_cache_wanted(struct z_erofs_decompress_backend *be)
+{
+	unsigned int i;
+
+	if (be->pcl->partial ||
+	    be->nr_pages > READ_ONCE(EROFS_SB(be->sb)->max_decomp_cache_pages))
+		return false;
+	for (i = 0; i < be->nr_pages; ++i)
+		if (!be->decompressed_pages[i])
+			return false;
+	return true;
+}
+
+static void z_erofs_decomp_cache_add(struct z_erofs_decompress_backend *be)
+{
+	struct erofs_sb_info *const sbi = EROFS_SB(be->sb);
+	struct z_erofs_decomp_entry *e;
+	LIST_HEAD(freelist);
+	unsigned int limit;
+
+	e = kmalloc(struct_size(e, pages, be->nr_pages),
+		    GFP_KERNEL | __GFP_NOWARN);
+	if (!e)
+		return;
+	refcount_set(&e->ref, 1);
+	e->index = be->pcl->obj.index;
+	e->pageofs_out = be->pcl->pageofs_out;
+	e->length = be->pcl->length;
+	for (e->nr_pages = 0; e->nr_pages < be->nr_pages; ++e->nr_pages) {
+		struct page *page = alloc_page(GFP_KERNEL | __GFP_NOWARN);
+
+		if (!page)
+			goto out;
+		copy_highpage(page, be->decompressed_pages[e->nr_pages]);
+		e->pages[e->nr_pages] = page;
+	}
+
+	xa_lock(&sbi->decomp_cache);
+	if (__xa_insert(&sbi->decomp_cache, e->index, e,
+			GFP_NOWAIT | __GFP_NOWARN)) {
+		xa_unlock(&sbi->decomp_cache);
+		goto out;
+	}
+	list_add(&e->lru, &sbi->decomp_cache_lru);
+	sbi->decomp_cache_pages += e->nr_pages;
+	atomic_long_inc(&z_erofs_decomp_cache_cnt);
+
+	limit = READ_ONCE(sbi->max_decomp_cache_pages);
+	while (sbi->decomp_cache_pages > limit)
+		z_erofs_decomp_cache_del(sbi,
+				list_last_entry(&sbi->decomp_cache_lru,
+						struct z_erofs_decomp_entry,
+						lru), &freelist);
+	xa_unlock(&sbi->decomp_cache);
+	z_erofs_decomp_cache_free(&freelist);
+	return;
+out:
+	z_erofs_decomp_entry_put(e);
+}
+
 static void z_erofs_do_decompressed_bvec(struct z_erofs_decompress_backend *be,
 					 struct z_erofs_bvec *bvec)
 {
@@ -1286,7 +1469,7 @@ static int z_erofs_decompress_pcluster(struct z_erofs_decompress_backend *be,
 	unsigned int i, inputsize;
 	int err2;
 	struct page *page;
-	bool overlapped;
+	bool overlapped, cache_fill = false;
 
 	mutex_lock(&pcl->lock);
 	be->nr_pages = PAGE_ALIGN(pcl->length + pcl->pageofs_out) >> PAGE_SHIFT;
@@ -1321,6 +1504,17 @@ static int z_erofs_decompress_pcluster(struct z_erofs_decompress_backend *be,
 	if (err)
 		goto out;
 
+	if (z_erofs_decomp_cacheable(be)) {
+		struct z_erofs_decomp_entry *e = z_erofs_decomp_cache_get(be);
+
+		if (e) {
+			z_erofs_decomp_cache_copy(be, e);
+			z_erofs_decomp_entry_put(e);
+			goto out;
+		}
+		cache_fill = z_erofs_decomp_cache_wanted(be);
+	}
+
 	if (z_erofs_is_inline_pcluster(pcl))
 		inputsize = pcl->tailpacking_size;
 	else
@@ -1339,6 +1533,8 @@ static int z_erofs_decompress_pcluster(struct z_erofs_decompress_backend *be,
 					.partial_decoding = pcl->partial,
 					.fillgaps = pcl->multibases,
 				 }, be->pagepool);
+	if (!err && cache_fill)
+		z_erofs_decomp_cache_add(be);
 
 out:
 	/* must handle all compressed pages before actual file pages */
@@ -212,6 +212,13 @@ struct eventpoll {
 	/* The user that created the eventpoll descriptor */
 	struct user_struct *user;
 
+	/*
+	 * Private instance of the poll(2) registration cache: its items are
+	 * not charged to max_user_watches, they are bounded by the pollfd
+	 * array (RLIMIT_NOFILE) and accounted to the memcg like any epitem.
+	 */
+	bool poll_cache;
+
 	struct file *file;
 
 	/* used to optimize loop detection check */
@@ -710,6 +717,23 @@ static void ep_free(struct eventpoll *ep)
 	kfree(ep);
 }
 
+static bool ep_charge_watch(struct eventpoll *ep)
+{
+	if (ep->poll_cache)
+		return true;
+	if (unlikely(percpu_counter_compare(&ep->user->epoll_watches,
+					    max_user_watches) >= 0))
+		return false;
+	percpu_counter_inc(&ep->user->epoll_watches);
+	return true;
+}
+
+static void ep_uncharge_watch(struct eventpoll *ep)
+{
+	if (!ep->poll_cache)
+		percpu_counter_dec(&ep->user->epoll_watches);
+}
+
 /*
  * Removes a "struct epitem" from the eventpoll RB tree and deallocates
  * all the associated resources. Must be called with "mtx" held.
@@ -770,7 +794,7 @@ static bool __ep_remove(struct eventpoll *ep, struct epitem *epi, bool force)
 	 */
 	call_rcu(&epi->rcu, epi_rcu_free);
 
-	percpu_counter_dec(&ep->user->epoll_watches);
+	ep_uncharge_watch(ep);
 	return ep_refcount_dec_and_test(ep);
 }
 
@@ -1496,13 +1520,11 @@ static int ep_insert(struct eventpoll *ep, const struct epoll_event *event,
 
 	lockdep_assert_irqs_enabled();
 
-	if (unlikely(percpu_counter_compare(&ep->user->epoll_watches,
-					    max_user_watches) >= 0))
+	if (!ep_charge_watch(ep))
 		return -ENOSPC;
-	percpu_counter_inc(&ep->user->epoll_watches);
 
 	if (!(epi = kmem_cache_zalloc(epi_cache, GFP_KERNEL))) {
-		percpu_counter_dec(&ep->user->epoll_watches);
+		ep_uncharge_watch(ep);
 		return -ENOMEM;
 	}
 
@@ -1520,7 +1542,7 @@ static int ep_insert(struct eventpoll *ep, const struct epoll_event *event,
 		if (tep)
 			mutex_unlock(&tep->mtx);
 		kmem_cache_free(epi_cache, epi);
-		percpu_counter_dec(&ep->user->epoll_watches);
+		ep_uncharge_watch(ep);
 		return -ENOMEM;
 	}
 
@@ -1954,6 +1976,172 @@ static int ep_poll(struct eventpoll *ep, struct epoll_event __user *events,
 	}
 }
 
+/*
+ * Private eventpoll instances backing the poll(2) registration cache in
+ * fs/select.c.  They are never reachable through a file, so there is no
+ * loop or path check to run; only plain pollable files are accepted and
+ * every item is level triggered, matching what poll(2) reports.
+ */
+struct eventpoll *ep_poll_cache_alloc(void)
+{
+	struct eventpoll *ep;
+
+	if (ep_alloc(&ep))
+		return NULL;
+	ep->poll_cache = true;
+	return ep;
+}
+
+void ep_poll_cache_free(struct eventpoll *ep)
+{
+	ep_clear_and_put(ep);
+}
+
+int ep_poll_cache_add(struct eventpoll *ep, struct file *file, int fd,
+		      __poll_t events, u64 data)
+{
+	struct epoll_event epds;
+	int error;
+
+	if (!file_can_poll(file) || is_file_epoll(file))
+		return -EINVAL;
+
+	epds.events = events;
+	epds.data = data;
+
+	mutex_lock(&ep->mtx);
+	if (ep_find(ep, file, fd))
+		error = -EEXIST;
+	else
+		error = ep_insert(ep, &epds, file, fd, 0);
+	mutex_unlock(&ep->mtx);
+
+	return error;
+}
+
+/*
+ * Tells whether @fd still refers to the @file the item was registered for.
+ * A closed file drops its items through eventpoll_release_file(), so a
+ * recycled descriptor or struct file never matches a stale item.
+ */
+bool ep_poll_cache_match(struct eventpoll *ep, struct file *file, int fd)
+{
+	bool match;
+
+	mutex_lock(&ep->mtx);
+	match = ep_find(ep, file, fd) != NULL;
+	mutex_unlock(&ep->mtx);
+
+	return match;
+}
+
+static int ep_poll_cache_harvest(struct eventpoll *ep,
+				 void (*report)(void *, u64, __poll_t),
+				 void *priv)
+{
+	struct epitem *epi, *tmp;
+	LIST_HEAD(txlist);
+	poll_table pt;
+	int res = 0;
+
+	init_poll_funcptr(&pt, NULL);
+
+	mutex_lock(&ep->mtx);
+	ep_start_scan(ep, &txlist);
+
+	list_for_each_entry_safe(epi, tmp, &txlist, rdllink) {
+		__poll_t revents;
+
+		list_del_init(&epi->rdllink);
+
+		revents = ep_item_poll(epi, &pt, 1);
+		if (!revents)
+			continue;
+
+		report(priv, epi->event.data, revents);
+		res++;
+
+		/* Level triggered, see ep_send_events() */
+		list_add_tail(&epi->rdllink, &ep->rdllist);
+	}
+	ep_done_scan(ep, &txlist);
+	mutex_unlock(&ep->mtx);
+
+	return res;
+}
+
+/**
+ * ep_poll_cache_wait - wait for events on a private eventpoll instance
+ *
+ * @ep: instance returned by ep_poll_cache_alloc().
+ * @timeout: absolute timeout, %NULL to wait forever, zero to not block.
+ * @report: called with the item data and ready events of each ready item.
+ * @priv: passed to @report.
+ *
+ * This is ep_poll() minus busy polling, with the events handed to @report
+ * instead of being copied to userspace.
+ *
+ * Return: the number of ready items, or -ERESTARTNOHAND if a signal is
+ *         pending and nothing was ready.
+ */
+int ep_poll_cache_wait(struct eventpoll *ep, struct timespec64 *timeout,
+		       void (*report)(void *, u64, __poll_t), void *priv)
+{
+	int res, eavail, timed_out = 0;
+	u64 slack = 0;
+	wait_queue_entry_t wait;
+	ktime_t expires, *to = NULL;
+
+	if (timeout && (timeout->tv_sec | timeout->tv_nsec)) {
+		slack = select_estimate_accuracy(timeout);
+		to = &expires;
+		*to = timespec64_to_ktime(*timeout);
+	} else if (timeout) {
+		timed_out = 1;
+	}
+
+	eavail = ep_events_available(ep);
+
+	while (1) {
+		if (eavail) {
+			res = ep_poll_cache_harvest(ep, report, priv);
+			if (res)
+				return res;
+		}
+
+		if (timed_out)
+			return 0;
+
+		if (signal_pending(current))
+			return -ERESTARTNOHAND;
+
+		init_wait(&wait);
+		wait.func = ep_autoremove_wake_function;
+
+		write_lock_irq(&ep->lock);
+		__set_current_state(TASK_INTERRUPTIBLE);
+		eavail = ep_events_available(ep);
+		if (!eavail)
+			__add_wait_queue_exclusive(&ep->wq, &wait);
+		write_unlock_irq(&ep->lock);
+
+		if (!eavail)
+			timed_out = !schedule_hrtimeout_range(to, slack,
+							      HRTIMER_MODE_ABS);
+		__set_current_state(TASK_RUNNING);
+
+		eavail = 1;
+
+		if (!list_empty_careful(&wait.entry)) {
+			write_lock_irq(&ep->lock);
+			if (timed_out)
+				eavail = list_empty(&wait.entry);
+			__remove_wait_queue(&ep->wq, &wait);
+			write_unlock_irq(&ep->lock);
+		}
+	}
+}
+
 /**
  * ep_loop_check_proc - verify that adding an epoll file inside another
  *                      epoll structure does not violate the constraints, in
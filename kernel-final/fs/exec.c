@@ -44,6 +44,7 @@
 #include <linux/spinlock.h>
 #include <linux/key.h>
 #include <linux/personality.h>
+#include <linux/poll.h>
 #include <linux/binfmts.h>
 #include <linux/utsname.h>
 #include <linux/pid_namespace.h>
@@ -1268,6 +1269,10 @@ int begin_new_exec(struct linux_binprm * bprm)
 	 */
 	io_uring_task_cancel();
 
+	/* Reserved slots would outlive close-on-exec, give them back. */
+	release_fd_cache(me);
+	release_poll_cache(me);
+
 	/* Ensure the files table is not shared. */
 	retval = unshare_files();
 	if (retval)
@@ -1835,6 +1835,7 @@ enum {
 	EXT4_STATE_VERITY_IN_PROGRESS,	/* building fs-verity Merkle tree */
 	EXT4_STATE_FC_COMMITTING,	/* Fast commit ongoing */
 	EXT4_STATE_ORPHAN_FILE,		/* Inode orphaned in orphan file */
+	EXT4_STATE_DIR_RA,		/* Lookup readahead was started */
 };
 
 #define EXT4_INODE_BIT_FNS(name, field, offset)				\
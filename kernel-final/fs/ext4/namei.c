@@ -1573,6 +1573,43 @@ static int is_dx_internal_node(struct inode *dir, ext4_lblk_t block,
 	return 0;
 }
 
+/*
+ * A cold lookup in a directory is usually followed by lookups of its
+ * siblings (node_modules, site-packages and the like), each of which
+ * hashes to a different htree leaf.  The first time a name is looked up
+ * in an indexed directory, start reading all of its blocks so those
+ * lookups find them in memory instead of issuing one read at a time.
+ * Directories larger than EXT4_DIR_RA_BLOCKS are left alone; for them
+ * readahead would mostly read blocks nobody asks for.
+ */
+#define EXT4_DIR_RA_BLOCKS	64
+
+static void ext4_dir_readahead(struct inode *dir)
+{
+	struct buffer_head *bhs[NAMEI_RA_SIZE];
+	ext4_lblk_t block, nblocks;
+	struct blk_plug plug;
+	int i, count;
+
+	if (ext4_test_inode_state(dir, EXT4_STATE_DIR_RA))
+		return;
+	ext4_set_inode_state(dir, EXT4_STATE_DIR_RA);
+
+	nblocks = dir->i_size >> EXT4_BLOCK_SIZE_BITS(dir->i_sb);
+	if (nblocks <= 1 || nblocks > EXT4_DIR_RA_BLOCKS)
+		return;
+
+	blk_start_plug(&plug);
+	for (block = 0; block < nblocks; block += count) {
+		count = min_t(ext4_lblk_t, nblocks - block, ARRAY_SIZE(bhs));
+		if (ext4_bread_batch(dir, block, count, false /* wait */, bhs))
+			break;
+		for (i = 0; i < count; i++)
+			brelse(bhs[i]);
+	}
+	blk_finish_plug(&plug);
+}
+
 /*
  *	__ext4_find_entry()
  *
@@ -1628,6 +1665,7 @@ static struct buffer_head *__ext4_find_entry(struct inode *dir,
 		goto restart;
 	}
 	if (is_dx(dir)) {
+		ext4_dir_readahead(dir);
 		ret = ext4_dx_find_entry(dir, fname, res_dir);
 		/*
 		 * On success, or if the error was file not found,
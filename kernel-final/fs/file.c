@@ -21,6 +21,7 @@
 #include <linux/rcupdate.h>
 #include <linux/filescontrol.h>
 #include <linux/close_range.h>
+#include <linux/poll.h>
 #include <net/sock.h>
 
 #include "internal.h"
@@ -332,6 +333,7 @@ struct files_struct *dup_fd(struct files_struct *oldf, unsigned int max_fds, int
 	newf->resize_in_progress = false;
 	init_waitqueue_head(&newf->resize_wait);
 	newf->next_fd = 0;
+	newf->close_gen = 0;
 	new_fdt = &newf->fdtab;
 	new_fdt->max_fds = NR_OPEN_DEFAULT;
 	new_fdt->close_on_exec = newf->close_on_exec_init;
@@ -484,6 +486,7 @@ void exit_files(struct task_struct *tsk)
 	struct files_struct * files = tsk->files;
 
 	if (files) {
+		release_fd_cache(tsk);
 		task_lock(tsk);
 		tsk->files = NULL;
 		task_unlock(tsk);
@@ -519,6 +522,184 @@ static unsigned int find_next_fd(struct fdtable *fdt, unsigned int start)
 	return find_next_zero_bit(fdt->open_fds, maxfd, start);
 }
 
+static void __put_unused_fd(struct files_struct *files, unsigned int fd);
+
+/*
+ * Per-task cache of reserved descriptors, enabled with PR_SET_FD_CACHE.
+ *
+ * Reserved slots are marked in open_fds, and in close_on_exec for the
+ * O_CLOEXEC pool, but have no file installed - exactly the state of a
+ * slot whose open() is in progress, which the rest of the fd code already
+ * copes with.  The owning task can therefore hand one out without taking
+ * file_lock, which is only taken to refill a pool a batch at a time.
+ *
+ * Descriptors come from the cache in ascending order, but a task using it
+ * no longer gets the lowest free descriptor of the process, and dup2()
+ * onto a reserved slot fails with -EBUSY.  Processes that need POSIX
+ * lowest-fd semantics simply don't enable it.
+ */
+#define FD_CACHE_MAX	64
+
+struct fd_cache {
+	struct files_struct *files;
+	unsigned int batch;
+	unsigned int head[2];
+	unsigned int nr[2];
+	unsigned int fds[2][FD_CACHE_MAX];
+};
+
+/* Return all reserved slots to @cache->files; file_lock must be held. */
+static void __fd_cache_drain(struct fd_cache *cache)
+{
+	int pool;
+
+	for (pool = 0; pool < 2; pool++) {
+		while (cache->head[pool] < cache->nr[pool])
+			__put_unused_fd(cache->files,
+					cache->fds[pool][cache->head[pool]++]);
+		cache->head[pool] = cache->nr[pool] = 0;
+	}
+}
+
+static void fd_cache_refill(struct fd_cache *cache, bool cloexec,
+			    unsigned int end)
+{
+	struct files_struct *files = cache->files;
+	unsigned int fd, nr = 0;
+	struct fdtable *fdt;
+
+	spin_lock(&files->file_lock);
+	fdt = files_fdtable(files);
+	end = min(end, fdt->max_fds);
+	/* never expand the table here, the slow path does that */
+	for (fd = files->next_fd; nr < cache->batch; fd++) {
+		fd = find_next_fd(fdt, fd);
+		if (fd >= end)
+			break;
+#ifdef CONFIG_CGROUP_FILES
+		if (files_cgroup_alloc_fd(files, 1))
+			break;
+#endif
+		__set_open_fd(fd, fdt);
+		if (cloexec)
+			__set_close_on_exec(fd, fdt);
+		else
+			__clear_close_on_exec(fd, fdt);
+		cache->fds[cloexec][nr++] = fd;
+		files->next_fd = fd + 1;
+	}
+	spin_unlock(&files->file_lock);
+
+	cache->head[cloexec] = 0;
+	cache->nr[cloexec] = nr;
+}
+
+/* Lockless fast path of alloc_fd(), -EAGAIN means take the slow path. */
+static int fd_cache_alloc(struct files_struct *files, unsigned int end,
+			  unsigned int flags)
+{
+	struct fd_cache *cache = current->fd_cache;
+	bool cloexec = flags & O_CLOEXEC;
+	struct fdtable *fdt;
+	unsigned int fd;
+	bool stale;
+
+	if (WARN_ON_ONCE(cache->files != files))
+		return -EAGAIN;
+
+	if (cache->head[cloexec] == cache->nr[cloexec]) {
+		fd_cache_refill(cache, cloexec, end);
+		if (!cache->nr[cloexec])
+			return -EAGAIN;
+	}
+
+	fd = cache->fds[cloexec][cache->head[cloexec]];
+	if (unlikely(fd >= end)) {
+		/* RLIMIT_NOFILE was lowered under us */
+		spin_lock(&files->file_lock);
+		__fd_cache_drain(cache);
+		spin_unlock(&files->file_lock);
+		return -EAGAIN;
+	}
+	cache->head[cloexec]++;
+
+	/* close_range(CLOSE_RANGE_CLOEXEC) may have covered the slot */
+	rcu_read_lock_sched();
+	fdt = rcu_dereference_sched(files->fdt);
+	stale = close_on_exec(fd, fdt) != cloexec;
+	rcu_read_unlock_sched();
+	if (unlikely(stale)) {
+		spin_lock(&files->file_lock);
+		fdt = files_fdtable(files);
+		if (cloexec)
+			__set_close_on_exec(fd, fdt);
+		else
+			__clear_close_on_exec(fd, fdt);
+		spin_unlock(&files->file_lock);
+	}
+	return fd;
+}
+
+/**
+ * release_fd_cache - return a task's reserved descriptors
+ * @tsk: task whose cache to free
+ *
+ * Must be called before @tsk->files is replaced or dropped, as the
+ * reserved slots belong to that table.
+ */
+void release_fd_cache(struct task_struct *tsk)
+{
+	struct fd_cache *cache = tsk->fd_cache;
+	struct files_struct *files;
+
+	if (!cache)
+		return;
+	files = cache->files;
+	spin_lock(&files->file_lock);
+	__fd_cache_drain(cache);
+	spin_unlock(&files->file_lock);
+	tsk->fd_cache = NULL;
+	kfree(cache);
+}
+
+/*
+ * PR_SET_FD_CACHE: reserve descriptors @batch at a time for the calling
+ * thread, or stop doing so if @batch is zero.
+ */
+int set_fd_cache(unsigned long batch)
+{
+	struct files_struct *files = current->files;
+	struct fd_cache *cache = current->fd_cache;
+
+	if (batch > FD_CACHE_MAX)
+		return -EINVAL;
+	if (!batch) {
+		release_fd_cache(current);
+		return 0;
+	}
+	if (!files)
+		return -EINVAL;
+
+	if (!cache) {
+		cache = kzalloc(sizeof(*cache), GFP_KERNEL_ACCOUNT);
+		if (!cache)
+			return -ENOMEM;
+		cache->files = files;
+		current->fd_cache = cache;
+	} else {
+		spin_lock(&files->file_lock);
+		__fd_cache_drain(cache);
+		spin_unlock(&files->file_lock);
+	}
+	cache->batch = batch;
+	return 0;
+}
+
+int get_fd_cache(void)
+{
+	return current->fd_cache ? current->fd_cache->batch : 0;
+}
+
 /*
  * allocate a file descriptor, mark it busy.
  */
@@ -529,6 +710,12 @@ static int alloc_fd(unsigned start, unsigned end, unsigned flags)
 	int error;
 	struct fdtable *fdt;
 
+	if (current->fd_cache && !start) {
+		error = fd_cache_alloc(files, end, flags);
+		if (error >= 0)
+			return error;
+	}
+
 	spin_lock(&files->file_lock);
 repeat:
 	fdt = files_fdtable(files);
@@ -661,6 +848,16 @@ void fd_install(unsigned int fd, struct file *file)
 
 EXPORT_SYMBOL(fd_install);
 
+/*
+ * Called with file_lock held after an fd stopped referring to its file.
+ * Pairs with the acquire in files_close_gen(): whoever sees the new value
+ * also sees the fd table update.
+ */
+static inline void files_close_gen_inc(struct files_struct *files)
+{
+	smp_store_release(&files->close_gen, files->close_gen + 1);
+}
+
 /**
  * pick_file - return file associatd with fd
  * @files: file struct to retrieve file from
@@ -683,6 +880,7 @@ static struct file *pick_file(struct files_struct *files, unsigned fd)
 	if (file) {
 		rcu_assign_pointer(fdt->fd[fd], NULL);
 		__put_unused_fd(files, fd);
+		files_close_gen_inc(files);
 	}
 	return file;
 }
@@ -817,6 +1015,8 @@ int __close_range(unsigned fd, unsigned max_fd, unsigned int flags)
 		 * We're done closing the files we were supposed to. Time to install
 		 * the new file descriptor table and drop the old one.
 		 */
+		release_fd_cache(me);
+		release_poll_cache(me);
 		task_lock(me);
 		me->files = cur_fds;
 		task_unlock(me);
@@ -877,6 +1077,7 @@ void do_close_on_exec(struct files_struct *files)
 				continue;
 			rcu_assign_pointer(fdt->fd[fd], NULL);
 			__put_unused_fd(files, fd);
+			files_close_gen_inc(files);
 			spin_unlock(&files->file_lock);
 			filp_close(file, files);
 			cond_resched();
@@ -1158,6 +1359,8 @@ __releases(&files->file_lock)
 #endif
 	get_file(file);
 	rcu_assign_pointer(fdt->fd[fd], file);
+	if (tofree)
+		files_close_gen_inc(files);
 	__set_open_fd(fd, fdt);
 	if (flags & O_CLOEXEC)
 		__set_close_on_exec(fd, fdt);
@@ -1789,6 +1789,148 @@ static long writeback_chunk_size(struct bdi_writeback *wb,
 	return pages;
 }
 
+/*
+ * Parallel writeback.  With bdi->wb_threads > 1, writeback_sb_inodes()
+ * pins a batch of inodes with I_SYNC and writes them out from several
+ * workers at once.  I_SYNC still keeps an inode on a single writer, so
+ * the per-inode ordering is the same as with the serial loop.  The helpers
+ * run on their own rescuer-backed workqueue because the flusher waits for
+ * them and must not depend on bdi_wq's rescuer.
+ */
+#define WB_PAR_BATCH		16
+
+static struct workqueue_struct *wb_par_wq;
+
+struct wb_par_inode {
+	struct inode *inode;
+	struct writeback_control wbc;
+	long write_chunk;
+};
+
+struct wb_par_batch;
+
+struct wb_par_worker {
+	struct work_struct work;
+	struct wb_par_batch *batch;
+	unsigned int idx;
+};
+
+struct wb_par_batch {
+	unsigned int nr;
+	unsigned int nr_workers;
+	atomic_t running;
+	struct completion done;
+	struct wb_par_worker workers[BDI_MAX_WB_THREADS];
+	struct wb_par_inode inodes[WB_PAR_BATCH];
+};
+
+static void wb_par_write(struct wb_par_batch *batch, unsigned int idx)
+{
+	struct blk_plug plug;
+	unsigned int i;
+
+	blk_start_plug(&plug);
+	for (i = idx; i < batch->nr; i += batch->nr_workers)
+		__writeback_single_inode(batch->inodes[i].inode,
+					 &batch->inodes[i].wbc);
+	blk_finish_plug(&plug);
+}
+
+static void wb_par_workfn(struct work_struct *work)
+{
+	struct wb_par_worker *worker = container_of(work,
+						    struct wb_par_worker, work);
+	struct wb_par_batch *batch = worker->batch;
+
+	wb_par_write(batch, worker->idx);
+	if (atomic_dec_and_test(&batch->running))
+		complete(&batch->done);
+}
+
+/*
+ * Write out the batched inodes and requeue them like the serial loop in
+ * writeback_sb_inodes() does.  Must be called without wb->list_lock.
+ */
+static long wb_par_flush(struct bdi_writeback *wb,
+			 struct wb_writeback_work *work,
+			 struct wb_par_batch *batch)
+{
+	long total_wrote = 0;
+	unsigned int i;
+
+	batch->nr_workers = clamp_t(unsigned int,
+				    READ_ONCE(wb->bdi->wb_threads), 1,
+				    min_t(unsigned int, batch->nr,
+					  BDI_MAX_WB_THREADS));
+	atomic_set(&batch->running, batch->nr_workers - 1);
+	init_completion(&batch->done);
+	for (i = 1; i < batch->nr_workers; i++) {
+		struct wb_par_worker *worker = &batch->workers[i];
+
+		worker->batch = batch;
+		worker->idx = i;
+		INIT_WORK(&worker->work, wb_par_workfn);
+		queue_work(wb_par_wq, &worker->work);
+	}
+	wb_par_write(batch, 0);
+	if (batch->nr_workers > 1)
+		wait_for_completion(&batch->done);
+
+	for (i = 0; i < batch->nr; i++) {
+		struct wb_par_inode *pi = &batch->inodes[i];
+		struct inode *inode = pi->inode;
+		struct bdi_writeback *tmp_wb;
+		long wrote;
+
+		wbc_detach_inode(&pi->wbc);
+		work->nr_pages -= pi->write_chunk - pi->wbc.nr_to_write;
+		wrote = pi->write_chunk - pi->wbc.nr_to_write -
+			pi->wbc.pages_skipped;
+		total_wrote += wrote < 0 ? 0 : wrote;
+
+		tmp_wb = inode_to_wb_and_lock_list(inode);
+		spin_lock(&inode->i_lock);
+		if (!(inode->i_state & I_DIRTY_ALL))
+			total_wrote++;
+		requeue_inode(inode, tmp_wb, &pi->wbc);
+		inode_sync_complete(inode);
+		spin_unlock(&inode->i_lock);
+		spin_unlock(&tmp_wb->list_lock);
+	}
+	batch->nr = 0;
+	cond_resched();
+
+	return total_wrote;
+}
+
+static int __init wb_par_init(void)
+{
+	wb_par_wq = alloc_workqueue("writeback_par", WQ_MEM_RECLAIM |
+				    WQ_UNBOUND | WQ_SYSFS, 0);
+	return wb_par_wq ? 0 : -ENOMEM;
+}
+__initcall(wb_par_init);
+
+/*
+ * The batch is allocated the first time @wb is flushed with wb_threads > 1
+ * and kept until wb_exit().  Only the flusher uses it, and it calls this
+ * without wb->list_lock.  Without a batch writeback stays serial.
+ */
+static void wb_par_alloc_batch(struct bdi_writeback *wb)
+{
+	struct wb_par_batch *batch;
+
+	if (wb->par_batch || READ_ONCE(wb->bdi->wb_threads) <= 1 ||
+	    !wb_par_wq)
+		return;
+
+	batch = kmalloc(sizeof(*batch), GFP_NOFS | __GFP_NOWARN);
+	if (batch) {
+		batch->nr = 0;
+		wb->par_batch = batch;
+	}
+}
+
 /*
  * Write a portion of b_io inodes which belong to @sb.
  *
@@ -1815,6 +1957,11 @@ static long writeback_sb_inodes(struct super_block *sb,
 	unsigned long start_time = jiffies;
 	long write_chunk;
 	long total_wrote = 0;  /* count both pages and inodes */
+	struct wb_par_batch *batch = NULL;
+	long batched = 0;
+
+	if (READ_ONCE(wb->bdi->wb_threads) > 1)
+		batch = wb->par_batch;
 
 	while (!list_empty(&wb->b_io)) {
 		struct inode *inode = wb_inode(wb->b_io.prev);
@@ -1866,6 +2013,12 @@ static long writeback_sb_inodes(struct super_block *sb,
 			trace_writeback_sb_inodes_requeue(inode);
 			continue;
 		}
+		/*
+		 * A batched inode is written later, get it off b_io now.  It
+		 * is put back on the right list once it has been written.
+		 */
+		if (batch && !(inode->i_state & I_SYNC))
+			requeue_io(inode, wb);
 		spin_unlock(&wb->list_lock);
 
 		/*
@@ -1881,6 +2034,37 @@ static long writeback_sb_inodes(struct super_block *sb,
 			continue;
 		}
 		inode->i_state |= I_SYNC;
+
+		if (batch) {
+			struct wb_par_inode *pi = &batch->inodes[batch->nr++];
+
+			pi->inode = inode;
+			pi->wbc = wbc;
+			wbc_attach_and_unlock_inode(&pi->wbc, inode);
+			pi->write_chunk = writeback_chunk_size(wb, work);
+			pi->wbc.nr_to_write = pi->write_chunk;
+			pi->wbc.pages_skipped = 0;
+			if (pi->write_chunk != LONG_MAX)
+				batched += pi->write_chunk;
+
+			if (batch->nr < WB_PAR_BATCH &&
+			    (!batched || batched < work->nr_pages)) {
+				spin_lock(&wb->list_lock);
+				continue;
+			}
+			total_wrote += wb_par_flush(wb, work, batch);
+			batched = 0;
+			spin_lock(&wb->list_lock);
+			/* same bail out tests as below */
+			if (total_wrote) {
+				if (time_is_before_jiffies(start_time + HZ / 10UL))
+					break;
+				if (work->nr_pages <= 0)
+					break;
+			}
+			continue;
+		}
+
 		wbc_attach_and_unlock_inode(&wbc, inode);
 
 		write_chunk = writeback_chunk_size(wb, work);
@@ -1940,6 +2124,11 @@ static long writeback_sb_inodes(struct super_block *sb,
 				break;
 		}
 	}
+	if (batch && batch->nr) {
+		spin_unlock(&wb->list_lock);
+		total_wrote += wb_par_flush(wb, work, batch);
+		spin_lock(&wb->list_lock);
+	}
 	return total_wrote;
 }
 
@@ -2023,6 +2212,8 @@ static long wb_writeback(struct bdi_writeback *wb,
 	long progress;
 	struct blk_plug plug;
 
+	wb_par_alloc_batch(wb);
+
 	blk_start_plug(&plug);
 	spin_lock(&wb->list_lock);
 	for (;;) {
@@ -192,10 +192,13 @@ unsigned int fuse_len_args(unsigned int numargs, struct fuse_arg *args)
 }
 EXPORT_SYMBOL_GPL(fuse_len_args);
 
+/*
+ * Doesn't need fiq->lock, so that requests can be queued on the per-CPU queues
+ * without touching the shared input queue.
+ */
 u64 fuse_get_unique(struct fuse_iqueue *fiq)
 {
-	fiq->reqctr += FUSE_REQ_ID_STEP;
-	return fiq->reqctr;
+	return atomic64_add_return(FUSE_REQ_ID_STEP, &fiq->reqctr);
 }
 EXPORT_SYMBOL_GPL(fuse_get_unique);
 
@@ -222,17 +225,64 @@ const struct fuse_iqueue_ops fuse_dev_fiq_ops = {
 };
 EXPORT_SYMBOL_GPL(fuse_dev_fiq_ops);
 
-static void queue_request_and_unlock(struct fuse_iqueue *fiq,
-				     struct fuse_req *req)
-__releases(fiq->lock)
+static void fuse_req_set_len(struct fuse_req *req)
 {
 	req->in.h.len = sizeof(struct fuse_in_header) +
 		fuse_len_args(req->args->in_numargs,
 			      (struct fuse_arg *) req->args->in_args);
+}
+
+static void queue_request_and_unlock(struct fuse_iqueue *fiq,
+				     struct fuse_req *req)
+__releases(fiq->lock)
+{
+	fuse_req_set_len(req);
 	list_add_tail(&req->list, &fiq->pending);
 	fiq->ops->wake_pending_and_unlock(fiq);
 }
 
+/*
+ * Queue a request on the per-CPU queue of the submitting CPU, if a device has
+ * been bound to that CPU.  Returns false if the request needs to go through
+ * the shared input queue instead.
+ *
+ * The CPU is only a locality hint, so it's fine if the task migrates after
+ * the queue was picked.
+ */
+static bool queue_request_cpu(struct fuse_iqueue *fiq, struct fuse_req *req)
+{
+	struct fuse_cpu_queue __percpu *queues;
+	struct fuse_cpu_queue *fcq;
+
+	/* Pairs with smp_store_release() in fuse_dev_bind_cpu() */
+	queues = smp_load_acquire(&fiq->cpu_queues);
+	if (!queues)
+		return false;
+
+	fcq = per_cpu_ptr(queues, raw_smp_processor_id());
+	if (!READ_ONCE(fcq->nr_bound))
+		return false;
+
+	spin_lock(&fcq->lock);
+	/*
+	 * fuse_abort_conn() clears fiq->connected before draining the per-CPU
+	 * queues under fcq->lock, so the request is either seen by the abort or
+	 * sent through the shared queue, which will fail it.
+	 */
+	if (!fcq->nr_bound || !READ_ONCE(fiq->connected)) {
+		spin_unlock(&fcq->lock);
+		return false;
+	}
+	req->in.h.unique = fuse_get_unique(fiq);
+	fuse_req_set_len(req);
+	req->fcq = fcq;
+	list_add_tail(&req->list, &fcq->pending);
+	wake_up(&fcq->waitq);
+	spin_unlock(&fcq->lock);
+
+	return true;
+}
+
 void fuse_queue_forget(struct fuse_conn *fc, struct fuse_forget_link *forget,
 		       u64 nodeid, u64 nlookup)
 {
@@ -263,6 +313,8 @@ static void flush_bg_queue(struct fuse_conn *fc)
 		req = list_first_entry(&fc->bg_queue, struct fuse_req, list);
 		list_del(&req->list);
 		fc->active_background++;
+		if (queue_request_cpu(fiq, req))
+			continue;
 		spin_lock(&fiq->lock);
 		req->in.h.unique = fuse_get_unique(fiq);
 		queue_request_and_unlock(fiq, req);
@@ -365,6 +417,8 @@ static void request_wait_answer(struct fuse_req *req)
 {
 	struct fuse_conn *fc = req->fm->fc;
 	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_cpu_queue *fcq;
+	bool pending;
 	int err;
 
 	if (!fc->no_interrupt) {
@@ -389,15 +443,21 @@ static void request_wait_answer(struct fuse_req *req)
 			return;
 
 		spin_lock(&fiq->lock);
+		fcq = req->fcq;
+		if (fcq)
+			spin_lock(&fcq->lock);
 		/* Request is not yet in userspace, bail out */
-		if (test_bit(FR_PENDING, &req->flags)) {
+		pending = test_bit(FR_PENDING, &req->flags);
+		if (pending)
 			list_del(&req->list);
-			spin_unlock(&fiq->lock);
+		if (fcq)
+			spin_unlock(&fcq->lock);
+		spin_unlock(&fiq->lock);
+		if (pending) {
 			__fuse_put_request(req);
 			req->out.h.error = -EINTR;
 			return;
 		}
-		spin_unlock(&fiq->lock);
 	}
 
 	/*
@@ -412,21 +472,24 @@ static void __fuse_request_send(struct fuse_req *req)
 	struct fuse_iqueue *fiq = &req->fm->fc->iq;
 
 	BUG_ON(test_bit(FR_BACKGROUND, &req->flags));
-	spin_lock(&fiq->lock);
-	if (!fiq->connected) {
-		spin_unlock(&fiq->lock);
-		req->out.h.error = -ENOTCONN;
-	} else {
+	/* acquire extra reference, since request is still needed
+	   after fuse_request_end() */
+	__fuse_get_request(req);
+	if (!queue_request_cpu(fiq, req)) {
+		spin_lock(&fiq->lock);
+		if (!fiq->connected) {
+			spin_unlock(&fiq->lock);
+			__fuse_put_request(req);
+			req->out.h.error = -ENOTCONN;
+			return;
+		}
 		req->in.h.unique = fuse_get_unique(fiq);
-		/* acquire extra reference, since request is still needed
-		   after fuse_request_end() */
-		__fuse_get_request(req);
 		queue_request_and_unlock(fiq, req);
-
-		request_wait_answer(req);
-		/* Pairs with smp_wmb() in fuse_request_end() */
-		smp_rmb();
 	}
+
+	request_wait_answer(req);
+	/* Pairs with smp_wmb() in fuse_request_end() */
+	smp_rmb();
 }
 
 static void fuse_adjust_compat(struct fuse_conn *fc, struct fuse_args *args)
@@ -1038,6 +1101,60 @@ static int request_pending(struct fuse_iqueue *fiq)
 		forget_pending(fiq);
 }
 
+static bool cpu_request_pending(struct fuse_cpu_queue *fcq)
+{
+	return fcq && !list_empty(&fcq->pending);
+}
+
+/* Take the next request off a per-CPU queue, NULL if there is none */
+static struct fuse_req *fuse_cpu_queue_take(struct fuse_cpu_queue *fcq)
+{
+	struct fuse_req *req = NULL;
+
+	spin_lock(&fcq->lock);
+	if (!list_empty(&fcq->pending)) {
+		req = list_first_entry(&fcq->pending, struct fuse_req, list);
+		clear_bit(FR_PENDING, &req->flags);
+		list_del_init(&req->list);
+	}
+	spin_unlock(&fcq->lock);
+
+	return req;
+}
+
+/*
+ * Wait for work on a device bound to a CPU.  Readers wait exclusively on the
+ * per-CPU queue, so each local request wakes a single thread, but they also
+ * wait non-exclusively on the shared queue, since interrupts, forgets and
+ * requests from CPUs without a bound device must still make progress when
+ * every daemon thread is bound.
+ */
+static int fuse_cpu_queue_wait(struct fuse_iqueue *fiq,
+			       struct fuse_cpu_queue *fcq)
+{
+	DEFINE_WAIT(local);
+	DEFINE_WAIT(shared);
+	int err = 0;
+
+	for (;;) {
+		prepare_to_wait_exclusive(&fcq->waitq, &local,
+					  TASK_INTERRUPTIBLE);
+		prepare_to_wait(&fiq->waitq, &shared, TASK_INTERRUPTIBLE);
+		if (!READ_ONCE(fiq->connected) || cpu_request_pending(fcq) ||
+		    request_pending(fiq))
+			break;
+		if (signal_pending(current)) {
+			err = -ERESTARTSYS;
+			break;
+		}
+		schedule();
+	}
+	finish_wait(&fiq->waitq, &shared);
+	finish_wait(&fcq->waitq, &local);
+
+	return err;
+}
+
 /*
  * Transfer an interrupt request to userspace
  *
@@ -1208,6 +1325,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	struct fuse_conn *fc = fud->fc;
 	struct fuse_iqueue *fiq = &fc->iq;
 	struct fuse_pqueue *fpq = &fud->pq;
+	struct fuse_cpu_queue *fcq = READ_ONCE(fud->fcq);
 	struct fuse_req *req;
 	struct fuse_args *args;
 	unsigned reqsize;
@@ -1233,6 +1351,13 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 
  restart:
 	for (;;) {
+		/* Requests queued on the local CPU are served first */
+		if (fcq) {
+			req = fuse_cpu_queue_take(fcq);
+			if (req)
+				goto found;
+		}
+
 		spin_lock(&fiq->lock);
 		if (!fiq->connected || request_pending(fiq))
 			break;
@@ -1240,8 +1365,11 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 
 		if (file->f_flags & O_NONBLOCK)
 			return -EAGAIN;
-		err = wait_event_interruptible_exclusive(fiq->waitq,
-				!fiq->connected || request_pending(fiq));
+		if (fcq)
+			err = fuse_cpu_queue_wait(fiq, fcq);
+		else
+			err = wait_event_interruptible_exclusive(fiq->waitq,
+					!fiq->connected || request_pending(fiq));
 		if (err)
 			return err;
 	}
@@ -1270,6 +1398,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	list_del_init(&req->list);
 	spin_unlock(&fiq->lock);
 
+ found:
 	args = req->args;
 	reqsize = req->in.h.len;
 
@@ -2058,18 +2187,22 @@ static __poll_t fuse_dev_poll(struct file *file, poll_table *wait)
 {
 	__poll_t mask = EPOLLOUT | EPOLLWRNORM;
 	struct fuse_iqueue *fiq;
+	struct fuse_cpu_queue *fcq;
 	struct fuse_dev *fud = fuse_get_dev(file);
 
 	if (!fud)
 		return EPOLLERR;
 
 	fiq = &fud->fc->iq;
+	fcq = READ_ONCE(fud->fcq);
 	poll_wait(file, &fiq->waitq, wait);
+	if (fcq)
+		poll_wait(file, &fcq->waitq, wait);
 
 	spin_lock(&fiq->lock);
 	if (!fiq->connected)
 		mask = EPOLLERR;
-	else if (request_pending(fiq))
+	else if (request_pending(fiq) || cpu_request_pending(fcq))
 		mask |= EPOLLIN | EPOLLRDNORM;
 	spin_unlock(&fiq->lock);
 
@@ -2089,6 +2222,33 @@ static void end_requests(struct list_head *head)
 	}
 }
 
+/*
+ * Move the requests on all per-CPU queues to @head, for ending them.  Called
+ * with fiq->lock held, after fiq->connected has been cleared.
+ */
+static void fuse_cpu_queues_abort(struct fuse_iqueue *fiq,
+				  struct list_head *head)
+{
+	struct fuse_req *req;
+	int cpu;
+
+	if (!fiq->cpu_queues)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct fuse_cpu_queue *fcq = per_cpu_ptr(fiq->cpu_queues, cpu);
+
+		spin_lock(&fcq->lock);
+		list_for_each_entry(req, &fcq->pending, list) {
+			clear_bit(FR_PENDING, &req->flags);
+			req->fcq = NULL;
+		}
+		list_splice_tail_init(&fcq->pending, head);
+		wake_up_all(&fcq->waitq);
+		spin_unlock(&fcq->lock);
+	}
+}
+
 static void end_polls(struct fuse_conn *fc)
 {
 	struct rb_node *p;
@@ -2171,6 +2331,7 @@ void fuse_abort_conn(struct fuse_conn *fc)
 		list_for_each_entry(req, &fiq->pending, list)
 			clear_bit(FR_PENDING, &req->flags);
 		list_splice_tail_init(&fiq->pending, &to_end);
+		fuse_cpu_queues_abort(fiq, &to_end);
 		while (forget_pending(fiq))
 			kfree(fuse_dequeue_forget(fiq, 1, NULL));
 		wake_up_all(&fiq->waitq);
@@ -2194,6 +2355,30 @@ void fuse_wait_aborted(struct fuse_conn *fc)
 	wait_event(fc->blocked_waitq, atomic_read(&fc->num_waiting) == 0);
 }
 
+/*
+ * Drop the device's binding to a CPU.  If it was the last device serving that
+ * CPU, whatever is still queued there is handed over to the shared queue.
+ */
+static void fuse_dev_unbind_cpu(struct fuse_dev *fud)
+{
+	struct fuse_iqueue *fiq = &fud->fc->iq;
+	struct fuse_cpu_queue *fcq = fud->fcq;
+	struct fuse_req *req;
+
+	spin_lock(&fiq->lock);
+	spin_lock(&fcq->lock);
+	if (--fcq->nr_bound || list_empty(&fcq->pending)) {
+		spin_unlock(&fcq->lock);
+		spin_unlock(&fiq->lock);
+		return;
+	}
+	list_for_each_entry(req, &fcq->pending, list)
+		req->fcq = NULL;
+	list_splice_tail_init(&fcq->pending, &fiq->pending);
+	spin_unlock(&fcq->lock);
+	fiq->ops->wake_pending_and_unlock(fiq);
+}
+
 int fuse_dev_release(struct inode *inode, struct file *file)
 {
 	struct fuse_dev *fud = fuse_get_dev(file);
@@ -2212,6 +2397,9 @@ int fuse_dev_release(struct inode *inode, struct file *file)
 
 		end_requests(&to_end);
 
+		if (fud->fcq)
+			fuse_dev_unbind_cpu(fud);
+
 		/* Are we the last open device? */
 		if (atomic_dec_and_test(&fc->dev_count)) {
 			WARN_ON(fc->iq.fasync != NULL);
@@ -2251,11 +2439,56 @@ static int fuse_device_clone(struct fuse_conn *fc, struct file *new)
 	return 0;
 }
 
+/*
+ * Bind a device to a CPU: requests submitted on that CPU will be queued on a
+ * per-CPU queue read only by the devices bound to it.  Called with fuse_mutex
+ * held.
+ */
+static int fuse_dev_bind_cpu(struct fuse_dev *fud, u32 cpu)
+{
+	struct fuse_iqueue *fiq = &fud->fc->iq;
+	struct fuse_cpu_queue __percpu *queues;
+	struct fuse_cpu_queue *fcq;
+	int i;
+
+	if (cpu >= nr_cpu_ids || !cpu_possible(cpu))
+		return -EINVAL;
+
+	if (fud->fcq)
+		return -EBUSY;
+
+	queues = fiq->cpu_queues;
+	if (!queues) {
+		queues = alloc_percpu(struct fuse_cpu_queue);
+		if (!queues)
+			return -ENOMEM;
+
+		for_each_possible_cpu(i) {
+			fcq = per_cpu_ptr(queues, i);
+			spin_lock_init(&fcq->lock);
+			init_waitqueue_head(&fcq->waitq);
+			INIT_LIST_HEAD(&fcq->pending);
+			fcq->nr_bound = 0;
+		}
+		/* Pairs with smp_load_acquire() in queue_request_cpu() */
+		smp_store_release(&fiq->cpu_queues, queues);
+	}
+
+	fcq = per_cpu_ptr(queues, cpu);
+	spin_lock(&fcq->lock);
+	fcq->nr_bound++;
+	spin_unlock(&fcq->lock);
+	WRITE_ONCE(fud->fcq, fcq);
+
+	return 0;
+}
+
 static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 			   unsigned long arg)
 {
 	int res;
 	int oldfd;
+	u32 cpu;
 	struct fuse_dev *fud = NULL;
 	struct fd f;
 
@@ -2283,6 +2516,18 @@ static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 		}
 		fdput(f);
 		break;
+	case FUSE_DEV_IOC_BIND_CPU:
+		if (get_user(cpu, (__u32 __user *)arg))
+			return -EFAULT;
+
+		fud = fuse_get_dev(file);
+		if (!fud)
+			return -EPERM;
+
+		mutex_lock(&fuse_mutex);
+		res = fuse_dev_bind_cpu(fud, cpu);
+		mutex_unlock(&fuse_mutex);
+		break;
 	default:
 		res = -ENOTTY;
 		break;
@@ -376,10 +376,35 @@ struct fuse_req {
 
 	/** fuse_mount this request belongs to */
 	struct fuse_mount *fm;
+
+	/** Per-CPU queue this request was queued on, if any */
+	struct fuse_cpu_queue *fcq;
 };
 
 struct fuse_iqueue;
 
+/**
+ * Per-CPU input queue
+ *
+ * Requests submitted on a CPU that has a device bound to it with
+ * FUSE_DEV_IOC_BIND_CPU are queued here instead of on fiq->pending, so daemon
+ * threads serving different CPUs don't contend on fiq->lock.  Interrupts and
+ * forgets always go through the shared input queue.
+ */
+struct fuse_cpu_queue {
+	/** Lock protecting accesses to members of this structure */
+	spinlock_t lock;
+
+	/** Readers bound to this CPU are waiting on this */
+	wait_queue_head_t waitq;
+
+	/** The list of pending requests */
+	struct list_head pending;
+
+	/** Number of devices bound to this CPU */
+	unsigned int nr_bound;
+};
+
 /**
  * Input queue callbacks
  *
@@ -427,7 +452,7 @@ struct fuse_iqueue {
 	wait_queue_head_t waitq;
 
 	/** The next unique request id */
-	u64 reqctr;
+	atomic64_t reqctr;
 
 	/** The list of pending requests */
 	struct list_head pending;
@@ -450,6 +475,9 @@ struct fuse_iqueue {
 
 	/** Device-specific state */
 	void *priv;
+
+	/** Per-CPU queues, allocated when the first device is bound to a CPU */
+	struct fuse_cpu_queue __percpu *cpu_queues;
 };
 
 #define FUSE_PQ_HASH_BITS 8
@@ -481,6 +509,9 @@ struct fuse_dev {
 
 	/** list entry on fc->devices */
 	struct list_head entry;
+
+	/** Per-CPU queue this device is bound to, if any */
+	struct fuse_cpu_queue *fcq;
 };
 
 enum fuse_dax_mode {
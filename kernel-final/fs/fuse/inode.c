@@ -871,6 +871,7 @@ void fuse_conn_put(struct fuse_conn *fc)
 			fuse_dax_conn_free(fc);
 		if (fiq->ops->release)
 			fiq->ops->release(fiq);
+		free_percpu(fiq->cpu_queues);
 		put_pid_ns(fc->pid_ns);
 		put_user_ns(fc->user_ns);
 		bucket = rcu_dereference_protected(fc->curr_bucket, 1);
@@ -193,6 +193,9 @@ extern const struct dentry_operations ns_dentry_operations;
 int getname_statx_lookup_flags(int flags);
 int do_statx(int dfd, struct filename *filename, unsigned int flags,
 	     unsigned int mask, struct statx __user *buffer);
+int vfs_statx_child(int dfd, const struct path *dir, const char *name,
+		    int len, int flags, struct kstat *stat, u32 request_mask);
+void statx_fill(struct statx *out, const struct kstat *stat);
 
 /*
  * fs/splice.c:
@@ -19,9 +19,21 @@
 #include <linux/fdtable.h>
 #include <linux/ratelimit.h>
 #include <linux/exportfs.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
+#include <linux/memcontrol.h>
+#include <linux/sched/mm.h>
 #include "overlayfs.h"
 
 #define OVL_COPY_UP_CHUNK_SIZE (1 << 20)
+/* Files smaller than this are always copied up by a single thread */
+#define OVL_COPY_UP_PARALLEL_MIN (64 << 20)
+#define OVL_COPY_UP_THREADS_MAX 16
+
+static unsigned int ovl_copy_up_threads = 4;
+module_param_named(copy_up_threads, ovl_copy_up_threads, uint, 0644);
+MODULE_PARM_DESC(copy_up_threads,
+		 "Maximum number of threads copying up data of a large file");
 
 static int ovl_ccup_set(const char *buf, const struct kernel_param *param)
 {
@@ -37,6 +49,22 @@ static int ovl_ccup_get(char *buf, const struct kernel_param *param)
 module_param_call(check_copy_up, ovl_ccup_set, ovl_ccup_get, NULL, 0644);
 MODULE_PARM_DESC(check_copy_up, "Obsolete; does nothing");
 
+static void ovl_cu_stats_account(struct ovl_fs *ofs, u64 ns)
+{
+	struct ovl_cu_stats *stats = &ofs->cu_stats;
+	s64 max = atomic64_read(&stats->max_ns);
+
+	atomic64_inc(&stats->copy_ups);
+	atomic64_add(ns, &stats->total_ns);
+	while (ns > max) {
+		s64 old = atomic64_cmpxchg(&stats->max_ns, max, ns);
+
+		if (old == max)
+			break;
+		max = old;
+	}
+}
+
 static bool ovl_must_copy_xattr(const char *name)
 {
 	return !strcmp(name, XATTR_POSIX_ACL_ACCESS) ||
@@ -230,13 +258,181 @@ static int ovl_copy_fileattr(struct inode *inode, const struct path *old,
 	return ovl_real_fileattr_set(new, &newfa);
 }
 
+/*
+ * Copy one chunk at the same offset in lower and upper file.  The caller
+ * holds ovl_want_write() on the upper sb, so this must not take freeze
+ * protection again: no vfs_copy_file_range() here.  Reflink was already
+ * tried for the whole file with do_clone_file_range().
+ */
+static ssize_t ovl_copy_up_chunk(struct file *old_file, struct file *new_file,
+				 loff_t pos, size_t len)
+{
+	loff_t old_pos = pos, new_pos = pos;
+	ssize_t bytes;
+
+	bytes = do_splice_direct(old_file, &old_pos, new_file, &new_pos,
+				 len, SPLICE_F_MOVE);
+	WARN_ON(bytes > 0 && old_pos != new_pos);
+
+	return bytes;
+}
+
+struct ovl_cu_job {
+	struct ovl_fs *ofs;
+	/* Each worker opens the lower file itself, see ovl_cu_worker_fn() */
+	const struct path *datapath;
+	struct file *new_file;
+	const struct cred *cred;
+	struct mem_cgroup *memcg;
+	loff_t len;
+	/* Offset of the next chunk to be claimed */
+	atomic64_t next;
+	atomic_t running;
+	int error;
+	bool skip_hole;
+	struct completion done;
+};
+
+struct ovl_cu_worker {
+	struct work_struct work;
+	struct ovl_cu_job *job;
+};
+
+static void ovl_cu_job_error(struct ovl_cu_job *job, int error)
+{
+	cmpxchg(&job->error, 0, error);
+}
+
+/*
+ * Claim and copy chunks until the file is done or someone failed.  Hole
+ * detection works as in ovl_copy_up_file(), only at chunk granularity.
+ */
+static void ovl_cu_job_run(struct ovl_cu_job *job, struct file *old_file,
+			   bool can_signal)
+{
+	while (!READ_ONCE(job->error)) {
+		loff_t pos = atomic64_fetch_add(OVL_COPY_UP_CHUNK_SIZE,
+						&job->next);
+		loff_t end = min_t(loff_t, pos + OVL_COPY_UP_CHUNK_SIZE,
+				   job->len);
+		ssize_t bytes;
+
+		if (pos >= job->len)
+			break;
+
+		if (can_signal && signal_pending_state(TASK_KILLABLE, current)) {
+			ovl_cu_job_error(job, -EINTR);
+			break;
+		}
+
+		if (job->skip_hole) {
+			loff_t data_pos = vfs_llseek(old_file, pos, SEEK_DATA);
+
+			if (data_pos == -ENXIO || data_pos >= end)
+				continue;
+			if (data_pos > pos)
+				pos = data_pos;
+		}
+
+		while (pos < end) {
+			bytes = ovl_copy_up_chunk(old_file, job->new_file,
+						  pos, end - pos);
+			if (bytes <= 0) {
+				ovl_cu_job_error(job, bytes ? (int)bytes : -EIO);
+				return;
+			}
+			atomic64_add(bytes, &job->ofs->cu_stats.data_bytes);
+			pos += bytes;
+		}
+	}
+}
+
+static void ovl_cu_worker_fn(struct work_struct *work)
+{
+	struct ovl_cu_worker *worker = container_of(work, struct ovl_cu_worker,
+						    work);
+	struct ovl_cu_job *job = worker->job;
+	struct mem_cgroup *old_memcg;
+	const struct cred *old_cred;
+	struct file *old_file;
+
+	/* Charge the page cache we fill to the task doing the copy-up */
+	old_memcg = set_active_memcg(job->memcg);
+	old_cred = override_creds(job->cred);
+	/*
+	 * SEEK_DATA moves f_pos and reads share f_ra, so workers don't use
+	 * the caller's file.
+	 */
+	old_file = ovl_path_open(job->datapath, O_LARGEFILE | O_RDONLY);
+	if (IS_ERR(old_file)) {
+		ovl_cu_job_error(job, PTR_ERR(old_file));
+	} else {
+		ovl_cu_job_run(job, old_file, false);
+		fput(old_file);
+	}
+	revert_creds(old_cred);
+	set_active_memcg(old_memcg);
+
+	if (atomic_dec_and_test(&job->running))
+		complete(&job->done);
+}
+
+/*
+ * Copy a large file with several threads.  The caller takes a share of the
+ * chunks itself, so this still makes progress if no worker can be queued.
+ * Returns -ENOMEM if the copy was not started and should be done serially.
+ */
+static int ovl_copy_up_parallel(struct ovl_fs *ofs,
+				const struct path *datapath,
+				struct file *old_file, struct file *new_file,
+				loff_t len, bool skip_hole)
+{
+	struct ovl_cu_job job = {
+		.ofs = ofs,
+		.datapath = datapath,
+		.new_file = new_file,
+		.cred = current_cred(),
+		.len = len,
+		.skip_hole = skip_hole,
+	};
+	struct ovl_cu_worker *workers;
+	unsigned int i, nr;
+
+	nr = min3(READ_ONCE(ovl_copy_up_threads), num_online_cpus(),
+		  (unsigned int)OVL_COPY_UP_THREADS_MAX);
+	if (nr < 2)
+		return -ENOMEM;
+
+	/* Slot 0 is the caller */
+	workers = kcalloc(nr, sizeof(*workers), GFP_KERNEL);
+	if (!workers)
+		return -ENOMEM;
+
+	job.memcg = get_mem_cgroup_from_mm(current->mm);
+	atomic64_set(&job.next, 0);
+	atomic_set(&job.running, nr - 1);
+	init_completion(&job.done);
+
+	for (i = 1; i < nr; i++) {
+		workers[i].job = &job;
+		INIT_WORK(&workers[i].work, ovl_cu_worker_fn);
+		queue_work(system_unbound_wq, &workers[i].work);
+	}
+
+	ovl_cu_job_run(&job, old_file, true);
+	wait_for_completion(&job.done);
+	mem_cgroup_put(job.memcg);
+	kfree(workers);
+
+	return job.error;
+}
+
 static int ovl_copy_up_file(struct ovl_fs *ofs, struct dentry *dentry,
 			    struct file *new_file, loff_t len)
 {
 	struct path datapath;
 	struct file *old_file;
 	loff_t old_pos = 0;
-	loff_t new_pos = 0;
 	loff_t cloned;
 	loff_t data_pos = -1;
 	loff_t hole_len;
@@ -261,6 +457,14 @@ static int ovl_copy_up_file(struct ovl_fs *ofs, struct dentry *dentry,
 	if (old_file->f_mode & FMODE_LSEEK)
 		skip_hole = true;
 
+	if (len >= OVL_COPY_UP_PARALLEL_MIN) {
+		error = ovl_copy_up_parallel(ofs, &datapath, old_file,
+					     new_file, len, skip_hole);
+		if (error != -ENOMEM)
+			goto out_sync;
+		error = 0;
+	}
+
 	while (len) {
 		size_t this_len = OVL_COPY_UP_CHUNK_SIZE;
 		long bytes;
@@ -294,7 +498,7 @@ static int ovl_copy_up_file(struct ovl_fs *ofs, struct dentry *dentry,
 			if (data_pos > old_pos) {
 				hole_len = data_pos - old_pos;
 				len -= hole_len;
-				old_pos = new_pos = data_pos;
+				old_pos = data_pos;
 				continue;
 			} else if (data_pos == -ENXIO) {
 				break;
@@ -303,19 +507,22 @@ static int ovl_copy_up_file(struct ovl_fs *ofs, struct dentry *dentry,
 			}
 		}
 
-		bytes = do_splice_direct(old_file, &old_pos,
-					 new_file, &new_pos,
-					 this_len, SPLICE_F_MOVE);
+		bytes = ovl_copy_up_chunk(old_file, new_file, old_pos,
+					  this_len);
 		if (bytes <= 0) {
 			error = bytes;
 			break;
 		}
-		WARN_ON(old_pos != new_pos);
+		atomic64_add(bytes, &ofs->cu_stats.data_bytes);
+		old_pos += bytes;
 
 		len -= bytes;
 	}
+out_sync:
 	if (!error && ovl_should_sync(ofs))
 		error = vfs_fsync(new_file, 0);
+	if (!error)
+		atomic64_inc(&ofs->cu_stats.data_copy_ups);
 out_fput:
 	fput(old_file);
 	return error;
@@ -995,6 +1202,7 @@ static int ovl_copy_up_one(struct dentry *parent, struct dentry *dentry,
 	int err;
 	DEFINE_DELAYED_CALL(done);
 	struct path parentpath;
+	u64 start;
 	struct ovl_copy_up_ctx ctx = {
 		.parent = parent,
 		.dentry = dentry,
@@ -1038,6 +1246,7 @@ static int ovl_copy_up_one(struct dentry *parent, struct dentry *dentry,
 			return PTR_ERR(ctx.link);
 	}
 
+	start = ktime_get_ns();
 	err = ovl_copy_up_start(dentry, flags);
 	/* err < 0: interrupted, err > 0: raced with another copy-up */
 	if (unlikely(err)) {
@@ -1051,6 +1260,9 @@ static int ovl_copy_up_one(struct dentry *parent, struct dentry *dentry,
 		if (!err && ovl_dentry_needs_data_copy_up_locked(dentry, flags))
 			err = ovl_copy_up_meta_inode_data(&ctx);
 		ovl_copy_up_end(dentry);
+		if (!err)
+			ovl_cu_stats_account(OVL_FS(dentry->d_sb),
+					     ktime_get_ns() - start);
 	}
 	do_delayed_call(&done);
 
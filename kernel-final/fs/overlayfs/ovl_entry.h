@@ -48,6 +48,16 @@ struct ovl_path {
 };
 
 /* private information held for overlayfs's superblock */
+/* Copy-up statistics, shown in /proc/<pid>/mountstats */
+struct ovl_cu_stats {
+	atomic64_t copy_ups;
+	atomic64_t data_copy_ups;
+	/* Bytes actually copied, holes and cloned ranges not included */
+	atomic64_t data_bytes;
+	atomic64_t total_ns;
+	atomic64_t max_ns;
+};
+
 struct ovl_fs {
 	unsigned int numlayer;
 	/* Number of unique fs among layers including upper fs */
@@ -83,6 +93,7 @@ struct ovl_fs {
 	struct dentry *whiteout;
 	/* r/o snapshot of upperdir sb's only taken on volatile mounts */
 	errseq_t errseq;
+	struct ovl_cu_stats cu_stats;
 };
 
 static inline struct vfsmount *ovl_upper_mnt(struct ovl_fs *ofs)
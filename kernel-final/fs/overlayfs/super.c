@@ -394,6 +394,21 @@ static int ovl_show_options(struct seq_file *m, struct dentry *dentry)
 	return 0;
 }
 
+/* Copy-up statistics of this overlay, appended to its mountstats line */
+static int ovl_show_stats(struct seq_file *m, struct dentry *dentry)
+{
+	struct ovl_cu_stats *stats = &OVL_FS(dentry->d_sb)->cu_stats;
+
+	seq_printf(m, "copy_ups=%lld data_copy_ups=%lld data_bytes=%lld "
+		   "total_us=%llu max_us=%llu",
+		   atomic64_read(&stats->copy_ups),
+		   atomic64_read(&stats->data_copy_ups),
+		   atomic64_read(&stats->data_bytes),
+		   div_u64(atomic64_read(&stats->total_ns), NSEC_PER_USEC),
+		   div_u64(atomic64_read(&stats->max_ns), NSEC_PER_USEC));
+	return 0;
+}
+
 static int ovl_remount(struct super_block *sb, int *flags, char *data)
 {
 	struct ovl_fs *ofs = sb->s_fs_info;
@@ -424,6 +439,7 @@ static const struct super_operations ovl_super_operations = {
 	.sync_fs	= ovl_sync_fs,
 	.statfs		= ovl_statfs,
 	.show_options	= ovl_show_options,
+	.show_stats	= ovl_show_stats,
 	.remount_fs	= ovl_remount,
 };
 
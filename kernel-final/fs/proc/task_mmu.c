@@ -20,6 +20,7 @@
 #include <linux/uaccess.h>
 #include <linux/pkeys.h>
 #include <linux/module.h>
+#include <linux/sysctl.h>
 
 #include <asm/elf.h>
 #include <asm/tlb.h>
@@ -814,6 +815,232 @@ static void smap_gather_stats(struct vm_area_struct *vma,
 		walk_page_range(vma->vm_mm, start, vma->vm_end, ops, mss);
 }
 
+/*
+ * Cached statistics
+ *
+ * With vm.smaps_cache enabled, the statistics of anonymous vmas are kept per
+ * PUD-sized region, and a read only walks the regions whose page tables were
+ * changed since the last read, as reported by vma_smaps_invalidate() from the
+ * fault, unmap, reclaim and migration paths.
+ *
+ * Regions with pages or swap entries shared with another process are walked
+ * on every read, since their PSS changes without our page tables changing.
+ * That keeps the cached RSS, PSS and swap numbers exact.  Referenced and the
+ * clean/dirty split follow accessed and dirty bits set by the hardware behind
+ * our back, so they can lag until the region is walked again.
+ */
+#define SMAPS_REGION_SHIFT	PUD_SHIFT
+
+static int sysctl_smaps_cache __read_mostly;
+
+struct smaps_regions {
+	struct rcu_head rcu;
+	/* The vma range and flags the statistics were gathered for */
+	unsigned long start;
+	unsigned long end;
+	vm_flags_t vm_flags;
+	unsigned long nr;
+	/* Regions to walk again on the next read */
+	unsigned long *stale;
+	struct mem_size_stats mss[];
+};
+
+struct smaps_cache {
+	/* Serializes readers gathering statistics into the cache */
+	struct mutex lock;
+	/* Replaced when the vma is resized, hence RCU for invalidations */
+	struct smaps_regions __rcu *regions;
+};
+
+static struct smaps_regions *smaps_regions_alloc(struct vm_area_struct *vma)
+{
+	unsigned long nr = ((vma->vm_end - 1) >> SMAPS_REGION_SHIFT) -
+			   (vma->vm_start >> SMAPS_REGION_SHIFT) + 1;
+	struct smaps_regions *regions;
+
+	regions = kvzalloc(struct_size(regions, mss, nr) +
+			   BITS_TO_LONGS(nr) * sizeof(unsigned long),
+			   GFP_KERNEL_ACCOUNT);
+	if (!regions)
+		return NULL;
+
+	regions->start = vma->vm_start;
+	regions->end = vma->vm_end;
+	regions->vm_flags = vma->vm_flags;
+	regions->nr = nr;
+	regions->stale = (unsigned long *)&regions->mss[nr];
+	bitmap_fill(regions->stale, nr);
+
+	return regions;
+}
+
+static struct smaps_cache *smaps_cache_get(struct vm_area_struct *vma)
+{
+	struct smaps_cache *cache = READ_ONCE(vma->smaps_cache);
+
+	if (cache)
+		return cache;
+
+	cache = kzalloc(sizeof(*cache), GFP_KERNEL_ACCOUNT);
+	if (!cache)
+		return NULL;
+	mutex_init(&cache->lock);
+
+	/* Readers only hold mmap_lock for read, so they may race here */
+	if (cmpxchg(&vma->smaps_cache, NULL, cache)) {
+		kfree(cache);
+		cache = READ_ONCE(vma->smaps_cache);
+	}
+
+	return cache;
+}
+
+void vma_smaps_free(struct vm_area_struct *vma)
+{
+	struct smaps_cache *cache = vma->smaps_cache;
+
+	if (!cache)
+		return;
+
+	kvfree(rcu_dereference_protected(cache->regions, true));
+	mutex_destroy(&cache->lock);
+	kfree(cache);
+}
+
+void __vma_smaps_invalidate(struct vm_area_struct *vma, unsigned long start,
+			    unsigned long end)
+{
+	struct smaps_cache *cache = READ_ONCE(vma->smaps_cache);
+	struct smaps_regions *regions;
+	unsigned long i, last;
+
+	rcu_read_lock();
+	regions = rcu_dereference(cache->regions);
+	if (!regions)
+		goto out;
+
+	start = max(start, regions->start);
+	end = min(end, regions->end);
+	if (start >= end)
+		goto out;
+
+	last = ((end - 1) >> SMAPS_REGION_SHIFT) -
+	       (regions->start >> SMAPS_REGION_SHIFT);
+	for (i = (start >> SMAPS_REGION_SHIFT) -
+		 (regions->start >> SMAPS_REGION_SHIFT); i <= last; i++) {
+		/* Don't bounce the cacheline on every fault */
+		if (!test_bit(i, regions->stale))
+			set_bit(i, regions->stale);
+	}
+out:
+	rcu_read_unlock();
+}
+
+/* Whether none of the pages or swap entries accounted in @mss are shared */
+static bool smaps_exclusive(const struct mem_size_stats *mss)
+{
+	return !mss->shared_clean && !mss->shared_dirty &&
+	       mss->swap_pss == (u64)mss->swap << PSS_SHIFT;
+}
+
+static void smaps_add(struct mem_size_stats *mss,
+		      const struct mem_size_stats *from)
+{
+	mss->resident += from->resident;
+	mss->shared_clean += from->shared_clean;
+	mss->shared_dirty += from->shared_dirty;
+	mss->private_clean += from->private_clean;
+	mss->private_dirty += from->private_dirty;
+	mss->referenced += from->referenced;
+	mss->anonymous += from->anonymous;
+	mss->lazyfree += from->lazyfree;
+	mss->anonymous_thp += from->anonymous_thp;
+	mss->shmem_thp += from->shmem_thp;
+	mss->file_thp += from->file_thp;
+	mss->swap += from->swap;
+	mss->shared_hugetlb += from->shared_hugetlb;
+	mss->private_hugetlb += from->private_hugetlb;
+	mss->pss += from->pss;
+	mss->pss_anon += from->pss_anon;
+	mss->pss_file += from->pss_file;
+	mss->pss_shmem += from->pss_shmem;
+	mss->pss_dirty += from->pss_dirty;
+	mss->pss_locked += from->pss_locked;
+	mss->swap_pss += from->swap_pss;
+}
+
+/*
+ * Add the stats of the whole @vma to @mss, walking only the regions that
+ * changed since they were last cached.
+ */
+static void smap_gather_stats_cached(struct vm_area_struct *vma,
+		struct mem_size_stats *mss)
+{
+	struct smaps_regions *regions, *old;
+	struct smaps_cache *cache;
+	unsigned long i, base, start, end;
+
+	/*
+	 * KSM can make our pages shared by changing the page tables of
+	 * another process only, so mergeable vmas are never cached.
+	 */
+	if (!READ_ONCE(sysctl_smaps_cache) || !vma_is_anonymous(vma) ||
+	    (vma->vm_flags & VM_MERGEABLE))
+		goto uncached;
+
+	cache = smaps_cache_get(vma);
+	if (!cache)
+		goto uncached;
+
+	mutex_lock(&cache->lock);
+	regions = rcu_dereference_protected(cache->regions,
+					    lockdep_is_held(&cache->lock));
+	if (!regions || regions->start != vma->vm_start ||
+	    regions->end != vma->vm_end) {
+		old = regions;
+		regions = smaps_regions_alloc(vma);
+		if (!regions) {
+			mutex_unlock(&cache->lock);
+			goto uncached;
+		}
+		rcu_assign_pointer(cache->regions, regions);
+		if (old)
+			kvfree_rcu(old, rcu);
+	} else if (regions->vm_flags != vma->vm_flags) {
+		/* e.g. mlock() changed what is accounted as Locked */
+		regions->vm_flags = vma->vm_flags;
+		bitmap_fill(regions->stale, regions->nr);
+	}
+
+	base = regions->start >> SMAPS_REGION_SHIFT;
+	for (i = 0; i < regions->nr; i++) {
+		struct mem_size_stats *region_mss = &regions->mss[i];
+
+		/*
+		 * Fully ordered, so a concurrent change of the page tables is
+		 * either seen by the walk or marks the region stale again.
+		 */
+		if (test_and_clear_bit(i, regions->stale)) {
+			start = max(regions->start,
+				    (base + i) << SMAPS_REGION_SHIFT);
+			end = min(regions->end - 1,
+				  ((base + i + 1) << SMAPS_REGION_SHIFT) - 1) + 1;
+
+			memset(region_mss, 0, sizeof(*region_mss));
+			walk_page_range(vma->vm_mm, start, end,
+					&smaps_walk_ops, region_mss);
+			if (!smaps_exclusive(region_mss))
+				set_bit(i, regions->stale);
+		}
+		smaps_add(mss, region_mss);
+	}
+	mutex_unlock(&cache->lock);
+	return;
+
+uncached:
+	smap_gather_stats(vma, mss, 0);
+}
+
 #define SEQ_PUT_DEC(str, val) \
 		seq_put_decimal_ull_width(m, str, (val) >> 10, 8)
 
@@ -864,7 +1091,7 @@ static int show_smap(struct seq_file *m, void *v)
 
 	memset(&mss, 0, sizeof(mss));
 
-	smap_gather_stats(vma, &mss, 0);
+	smap_gather_stats_cached(vma, &mss);
 
 	show_map_vma(m, vma);
 
@@ -918,7 +1145,7 @@ static int show_smaps_rollup(struct seq_file *m, void *v)
 
 	vma_start = vma->vm_start;
 	do {
-		smap_gather_stats(vma, &mss, 0);
+		smap_gather_stats_cached(vma, &mss);
 		last_vma_end = vma->vm_end;
 
 		/*
@@ -1072,6 +1299,26 @@ const struct file_operations proc_pid_smaps_rollup_operations = {
 	.release	= smaps_rollup_release,
 };
 
+static struct ctl_table smaps_sysctl_table[] = {
+	{
+		.procname	= "smaps_cache",
+		.data		= &sysctl_smaps_cache,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= SYSCTL_ONE,
+	},
+	{ }
+};
+
+static int __init smaps_sysctl_init(void)
+{
+	register_sysctl_init("vm", smaps_sysctl_table);
+	return 0;
+}
+fs_initcall(smaps_sysctl_init);
+
 enum clear_refs_types {
 	CLEAR_REFS_ALL = 1,
 	CLEAR_REFS_ANON,
@@ -21,9 +21,13 @@
 #include <linux/unistd.h>
 #include <linux/compat.h>
 #include <linux/uaccess.h>
+#include <linux/fcntl.h>
+#include <linux/sizes.h>
 
 #include <asm/unaligned.h>
 
+#include "internal.h"
+
 /*
  * Note the "unsafe_put_user() semantics: we goto a
  * label for errors.
@@ -383,6 +387,134 @@ SYSCALL_DEFINE3(getdents64, unsigned int, fd,
 	return error;
 }
 
+/*
+ * getdents_statx() fills a kernel buffer first: the attributes are looked
+ * up after ->iterate_shared() has returned, since filesystems call the
+ * actor with the directory locked and the child lookup may need that lock.
+ */
+#define GETDENTS_STATX_MAX_BUF	SZ_256K
+
+struct getdents_statx_callback {
+	struct dir_context ctx;
+	void *buf;
+	int used;
+	int prev_reclen;
+	int count;
+	int error;
+};
+
+static bool filldir_statx(struct dir_context *ctx, const char *name,
+			  int namlen, loff_t offset, u64 ino,
+			  unsigned int d_type)
+{
+	struct getdents_statx_callback *buf =
+		container_of(ctx, struct getdents_statx_callback, ctx);
+	struct dirent_statx *dirent, *prev;
+	int reclen = ALIGN(offsetof(struct dirent_statx, d_name) + namlen + 1,
+			   sizeof(u64));
+
+	buf->error = verify_dirent_name(name, namlen);
+	if (unlikely(buf->error))
+		return false;
+	buf->error = -EINVAL;	/* only used if we fail.. */
+	if (reclen > buf->count)
+		return false;
+	if (buf->prev_reclen && signal_pending(current))
+		return false;
+
+	dirent = buf->buf + buf->used;
+	if (buf->prev_reclen) {
+		prev = (void *)dirent - buf->prev_reclen;
+		prev->d_off = offset;
+	}
+	memset(dirent, 0, offsetof(struct dirent_statx, d_name));
+	dirent->d_ino = ino;
+	dirent->d_reclen = reclen;
+	dirent->d_type = d_type;
+	memcpy(dirent->d_name, name, namlen);
+	dirent->d_name[namlen] = 0;
+
+	buf->prev_reclen = reclen;
+	buf->used += reclen;
+	buf->count -= reclen;
+	return true;
+}
+
+/**
+ * sys_getdents_statx - Read directory entries along with their attributes
+ * @fd: Open directory
+ * @dirent: Buffer for struct dirent_statx records
+ * @count: Size of @dirent
+ * @flags: AT_STATX_SYNC_TYPE flags
+ * @mask: STATX_xxx flags for the wanted attributes
+ *
+ * Works like getdents64(), but each record also carries the lstat()-like
+ * attributes of the entry, or the error looking them up in d_result.
+ * Symlinks and automount points are never followed.
+ */
+SYSCALL_DEFINE5(getdents_statx, unsigned int, fd,
+		struct dirent_statx __user *, dirent, unsigned int, count,
+		unsigned int, flags, unsigned int, mask)
+{
+	struct getdents_statx_callback buf = {
+		.ctx.actor = filldir_statx,
+	};
+	struct dirent_statx *d;
+	struct fd f;
+	int error, pos;
+
+	if (flags & ~AT_STATX_SYNC_TYPE)
+		return -EINVAL;
+	if ((flags & AT_STATX_SYNC_TYPE) == AT_STATX_SYNC_TYPE)
+		return -EINVAL;
+	if (mask & STATX__RESERVED)
+		return -EINVAL;
+	mask &= ~STATX_CHANGE_COOKIE;
+	flags |= AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT;
+
+	buf.count = min_t(unsigned int, count, GETDENTS_STATX_MAX_BUF);
+	buf.buf = kvmalloc(buf.count, GFP_KERNEL);
+	if (!buf.buf)
+		return -ENOMEM;
+
+	f = fdget_pos(fd);
+	if (!f.file) {
+		error = -EBADF;
+		goto out_free;
+	}
+
+	error = iterate_dir(f.file, &buf.ctx);
+	if (error >= 0)
+		error = buf.error;
+	if (!buf.prev_reclen)
+		goto out_put;
+
+	d = buf.buf + buf.used - buf.prev_reclen;
+	d->d_off = buf.ctx.pos;
+
+	for (pos = 0; pos < buf.used; pos += d->d_reclen) {
+		struct kstat stat;
+
+		d = buf.buf + pos;
+		d->d_result = vfs_statx_child(fd, &f.file->f_path, d->d_name,
+					      strlen(d->d_name), flags, &stat,
+					      mask);
+		if (!d->d_result)
+			statx_fill(&d->d_stat, &stat);
+		cond_resched();
+	}
+
+	if (copy_to_user(dirent, buf.buf, buf.used))
+		error = -EFAULT;
+	else
+		error = buf.used;
+out_put:
+	fdput_pos(f);
+out_free:
+	kvfree(buf.buf);
+	return error;
+}
+
 #ifdef CONFIG_COMPAT
 struct compat_old_linux_dirent {
 	compat_ulong_t	d_ino;
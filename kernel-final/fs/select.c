@@ -27,6 +27,7 @@
 #include <linux/file.h>
 #include <linux/fdtable.h>
 #include <linux/fs.h>
+#include <linux/eventpoll.h>
 #include <linux/rcupdate.h>
 #include <linux/hrtimer.h>
 #include <linux/freezer.h>
@@ -968,6 +969,238 @@ static int do_poll(struct poll_list *list, struct poll_wqueues *wait,
 	return count;
 }
 
+/*
+ * Programs that predate epoll often hand the very same large pollfd array
+ * to poll() in a loop.  Once an array of at least POLL_CACHE_MIN_FDS entries
+ * has been seen twice in a row by a thread, its wait queue registrations
+ * are kept in a private eventpoll instance and later calls only look at
+ * the descriptors that were woken up (or reported ready last time, poll()
+ * being level triggered) instead of calling ->poll() on every one of them.
+ *
+ * Every call still makes sure that each descriptor refers to the file it
+ * was registered for: in O(1) through the fd table's close_gen while no
+ * fd got closed, otherwise one by one.  Anything unusual (closed or reused
+ * descriptors, duplicates, epoll files, files without ->poll) falls back
+ * to do_poll().
+ */
+#define POLL_CACHE_MIN_FDS	256
+
+#ifdef CONFIG_EPOLL
+struct poll_cache {
+	struct eventpoll *ep;
+	/* Set when the recorded array cannot be cached, e.g. duplicate fds */
+	bool uncacheable;
+	unsigned int nfds;
+	/* files->close_gen when the registrations were last known valid */
+	unsigned long close_gen;
+	/* The fd table close_gen belongs to */
+	struct files_struct *files;
+	/* ->fd and ->events of the last array, ->revents is scratch space */
+	struct pollfd fds[];
+};
+
+static void poll_cache_drop_ep(struct poll_cache *cache)
+{
+	if (cache->ep) {
+		ep_poll_cache_free(cache->ep);
+		cache->ep = NULL;
+	}
+}
+
+void release_poll_cache(struct task_struct *tsk)
+{
+	struct poll_cache *cache = tsk->poll_cache;
+
+	if (!cache)
+		return;
+	tsk->poll_cache = NULL;
+	poll_cache_drop_ep(cache);
+	kvfree(cache);
+}
+
+/* Returns true if @list carries the same fds and events as @cache */
+static bool poll_cache_same(struct poll_cache *cache, struct poll_list *list,
+			    unsigned int nfds)
+{
+	struct pollfd *cfd = cache->fds;
+	struct poll_list *walk;
+	int i;
+
+	if (cache->nfds != nfds)
+		return false;
+
+	for (walk = list; walk; walk = walk->next) {
+		for (i = 0; i < walk->len; i++, cfd++) {
+			if (walk->entries[i].fd != cfd->fd ||
+			    walk->entries[i].events != cfd->events)
+				return false;
+		}
+	}
+	return true;
+}
+
+static void poll_cache_record(struct poll_list *list, unsigned int nfds)
+{
+	struct poll_cache *cache = current->poll_cache;
+	struct pollfd *cfd;
+	struct poll_list *walk;
+	int i;
+
+	if (cache && cache->nfds != nfds) {
+		release_poll_cache(current);
+		cache = NULL;
+	}
+	if (!cache) {
+		cache = kvmalloc(struct_size(cache, fds, nfds),
+				 GFP_KERNEL_ACCOUNT);
+		if (!cache)
+			return;
+		cache->ep = NULL;
+		cache->nfds = nfds;
+		current->poll_cache = cache;
+	}
+	poll_cache_drop_ep(cache);
+	cache->uncacheable = false;
+
+	cfd = cache->fds;
+	for (walk = list; walk; walk = walk->next) {
+		for (i = 0; i < walk->len; i++, cfd++) {
+			cfd->fd = walk->entries[i].fd;
+			cfd->events = walk->entries[i].events;
+			cfd->revents = 0;
+		}
+	}
+}
+
+static int poll_cache_build(struct poll_cache *cache)
+{
+	unsigned long gen = files_close_gen(current->files);
+	unsigned int i;
+	int error;
+
+	cache->ep = ep_poll_cache_alloc();
+	if (!cache->ep)
+		return -ENOMEM;
+
+	for (i = 0; i < cache->nfds; i++) {
+		struct pollfd *cfd = &cache->fds[i];
+		__poll_t filter;
+		struct fd f;
+
+		if (cfd->fd < 0)
+			continue;
+		f = fdget(cfd->fd);
+		if (!f.file)
+			return -EBADF;
+		filter = demangle_poll(cfd->events) | EPOLLERR | EPOLLHUP;
+		error = ep_poll_cache_add(cache->ep, f.file, cfd->fd, filter, i);
+		fdput(f);
+		if (error)
+			return error;
+		cond_resched();
+	}
+	cache->close_gen = gen;
+	cache->files = current->files;
+	return 0;
+}
+
+static bool poll_cache_valid(struct poll_cache *cache)
+{
+	unsigned long gen = files_close_gen(current->files);
+	unsigned int i;
+
+	/* Generations of different fd tables can't be compared */
+	if (cache->files != current->files)
+		return false;
+	if (gen == cache->close_gen)
+		return true;
+
+	for (i = 0; i < cache->nfds; i++) {
+		struct pollfd *cfd = &cache->fds[i];
+		struct fd f;
+		bool match;
+
+		if (cfd->fd < 0)
+			continue;
+		f = fdget(cfd->fd);
+		if (!f.file)
+			return false;
+		match = ep_poll_cache_match(cache->ep, f.file, cfd->fd);
+		fdput(f);
+		if (!match)
+			return false;
+	}
+	cache->close_gen = gen;
+	return true;
+}
+
+static void poll_cache_report(void *priv, u64 data, __poll_t revents)
+{
+	struct poll_cache *cache = priv;
+
+	cache->fds[data].revents = mangle_poll(revents);
+}
+
+/*
+ * Returns the number of ready descriptors, -ERESTARTNOHAND, or -EAGAIN if
+ * @list has to go through do_poll() this time.
+ */
+static int poll_cached(struct poll_list *list, unsigned int nfds,
+		       struct timespec64 *end_time)
+{
+	struct poll_cache *cache = current->poll_cache;
+	struct pollfd *cfd;
+	struct poll_list *walk;
+	int count, i;
+
+	if (nfds < POLL_CACHE_MIN_FDS || net_busy_loop_on())
+		return -EAGAIN;
+
+	if (!cache || !poll_cache_same(cache, list, nfds)) {
+		poll_cache_record(list, nfds);
+		return -EAGAIN;
+	}
+	if (cache->uncacheable)
+		return -EAGAIN;
+
+	if (!cache->ep) {
+		if (poll_cache_build(cache)) {
+			poll_cache_drop_ep(cache);
+			cache->uncacheable = true;
+			return -EAGAIN;
+		}
+	} else if (!poll_cache_valid(cache)) {
+		/* Descriptors changed under us, rebuild once the array repeats */
+		poll_cache_drop_ep(cache);
+		return -EAGAIN;
+	}
+
+	count = ep_poll_cache_wait(cache->ep, end_time, poll_cache_report,
+				   cache);
+	if (count < 0)
+		return count;
+
+	cfd = cache->fds;
+	for (walk = list; walk; walk = walk->next) {
+		for (i = 0; i < walk->len; i++, cfd++) {
+			walk->entries[i].revents = cfd->revents;
+			cfd->revents = 0;
+		}
+	}
+	return count;
+}
+#else
+void release_poll_cache(struct task_struct *tsk)
+{
+}
+
+static inline int poll_cached(struct poll_list *list, unsigned int nfds,
+			      struct timespec64 *end_time)
+{
+	return -EAGAIN;
+}
+#endif
+
 #define N_STACK_PPS ((sizeof(stack_pps) - sizeof(struct poll_list))  / \
 			sizeof(struct pollfd))
 
@@ -1011,9 +1244,12 @@ static int do_sys_poll(struct pollfd __user *ufds, unsigned int nfds,
 		}
 	}
 
-	poll_initwait(&table);
-	fdcount = do_poll(head, &table, end_time);
-	poll_freewait(&table);
+	fdcount = poll_cached(head, nfds, end_time);
+	if (fdcount == -EAGAIN) {
+		poll_initwait(&table);
+		fdcount = do_poll(head, &table, end_time);
+		poll_freewait(&table);
+	}
 
 	if (!user_write_access_begin(ufds, nfds * sizeof(*ufds)))
 		goto out_fds;
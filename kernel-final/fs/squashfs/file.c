@@ -34,6 +34,7 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -533,6 +534,111 @@ out:
 	return error;
 }
 
+/*
+ * Readahead of several datablocks decompresses them in parallel, up to the
+ * number of decompressors the mount allows (see "threads=").  Each block is
+ * a job that decompresses straight into its own locked page cache pages,
+ * so the jobs share nothing but the decompressor streams.
+ */
+#define SQUASHFS_RA_MAX_JOBS	16
+
+static struct workqueue_struct *squashfs_read_wq;
+
+struct squashfs_ra_job {
+	struct work_struct work;
+	struct inode *inode;
+	struct page **pages;
+	unsigned int nr_pages;
+	unsigned int expected;
+	u64 block;
+	int bsize;
+	bool tail;
+	bool queued;
+};
+
+static void squashfs_readahead_block(struct squashfs_ra_job *job)
+{
+	struct squashfs_sb_info *msblk = job->inode->i_sb->s_fs_info;
+	struct squashfs_page_actor *actor;
+	struct page *last_page = NULL;
+	int i, res = -ENOMEM;
+
+	actor = squashfs_page_actor_init_special(msblk, job->pages,
+						 job->nr_pages, job->expected);
+	if (actor) {
+		res = squashfs_read_data(job->inode->i_sb, job->block,
+					 job->bsize, NULL, actor);
+		last_page = squashfs_page_actor_free(actor);
+	}
+
+	if (res == job->expected) {
+		int bytes;
+
+		/* Last page (if present) may have trailing bytes not filled */
+		bytes = res % PAGE_SIZE;
+		if (job->tail && bytes && last_page)
+			memzero_page(last_page, bytes, PAGE_SIZE - bytes);
+
+		for (i = 0; i < job->nr_pages; i++) {
+			flush_dcache_page(job->pages[i]);
+			SetPageUptodate(job->pages[i]);
+		}
+	}
+
+	for (i = 0; i < job->nr_pages; i++) {
+		unlock_page(job->pages[i]);
+		put_page(job->pages[i]);
+	}
+}
+
+static void squashfs_readahead_work(struct work_struct *work)
+{
+	squashfs_readahead_block(container_of(work, struct squashfs_ra_job,
+					      work));
+}
+
+static void squashfs_readahead_wait(struct squashfs_ra_job *job)
+{
+	if (job->queued) {
+		flush_work(&job->work);
+		job->queued = false;
+	}
+}
+
+static void squashfs_free_ra_jobs(struct squashfs_ra_job *jobs, int nr_jobs)
+{
+	int i;
+
+	for (i = 0; i < nr_jobs; i++) {
+		squashfs_readahead_wait(&jobs[i]);
+		kfree(jobs[i].pages);
+	}
+	kfree(jobs);
+}
+
+static struct squashfs_ra_job *squashfs_alloc_ra_jobs(struct inode *inode,
+		int nr_jobs, unsigned int max_pages)
+{
+	struct squashfs_ra_job *jobs;
+	int i;
+
+	jobs = kcalloc(nr_jobs, sizeof(*jobs), GFP_KERNEL);
+	if (!jobs)
+		return NULL;
+
+	for (i = 0; i < nr_jobs; i++) {
+		jobs[i].pages = kmalloc_array(max_pages, sizeof(void *),
+					      GFP_KERNEL);
+		if (!jobs[i].pages) {
+			squashfs_free_ra_jobs(jobs, i);
+			return NULL;
+		}
+		jobs[i].inode = inode;
+		INIT_WORK(&jobs[i].work, squashfs_readahead_work);
+	}
+	return jobs;
+}
+
 static void squashfs_readahead(struct readahead_control *ractl)
 {
 	struct inode *inode = ractl->mapping->host;
@@ -541,16 +647,21 @@ static void squashfs_readahead(struct readahead_control *ractl)
 	unsigned short shift = msblk->block_log - PAGE_SHIFT;
 	loff_t start = readahead_pos(ractl) & ~mask;
 	size_t len = readahead_length(ractl) + readahead_pos(ractl) - start;
-	struct squashfs_page_actor *actor;
+	struct squashfs_ra_job *jobs, *job;
 	unsigned int nr_pages = 0;
 	struct page **pages;
 	int i, file_end = i_size_read(inode) >> msblk->block_log;
 	unsigned int max_pages = 1UL << shift;
+	int nr_jobs, cur = 0;
 
 	readahead_expand(ractl, start, (len | mask) + 1);
 
-	pages = kmalloc_array(max_pages, sizeof(void *), GFP_KERNEL);
-	if (!pages)
+	nr_jobs = min_t(size_t, readahead_length(ractl) >> msblk->block_log,
+			min(msblk->max_thread_num, SQUASHFS_RA_MAX_JOBS));
+	nr_jobs = max(nr_jobs, 1);
+
+	jobs = squashfs_alloc_ra_jobs(inode, nr_jobs, max_pages);
+	if (!jobs)
 		return;
 
 	for (;;) {
@@ -558,7 +669,10 @@ static void squashfs_readahead(struct readahead_control *ractl)
 		int res, bsize;
 		u64 block = 0;
 		unsigned int expected;
-		struct page *last_page;
+
+		job = &jobs[cur];
+		squashfs_readahead_wait(job);
+		pages = job->pages;
 
 		expected = start >> msblk->block_log == file_end ?
 			   (i_size_read(inode) & (msblk->block_size - 1)) :
@@ -591,37 +705,22 @@ static void squashfs_readahead(struct readahead_control *ractl)
 		if (bsize == 0)
 			goto skip_pages;
 
-		actor = squashfs_page_actor_init_special(msblk, pages, nr_pages,
-							 expected);
-		if (!actor)
-			goto skip_pages;
-
-		res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
-
-		last_page = squashfs_page_actor_free(actor);
-
-		if (res == expected) {
-			int bytes;
-
-			/* Last page (if present) may have trailing bytes not filled */
-			bytes = res % PAGE_SIZE;
-			if (index == file_end && bytes && last_page)
-				memzero_page(last_page, bytes,
-					     PAGE_SIZE - bytes);
-
-			for (i = 0; i < nr_pages; i++) {
-				flush_dcache_page(pages[i]);
-				SetPageUptodate(pages[i]);
-			}
-		}
+		job->nr_pages = nr_pages;
+		job->expected = expected;
+		job->block = block;
+		job->bsize = bsize;
+		job->tail = index == file_end;
 
-		for (i = 0; i < nr_pages; i++) {
-			unlock_page(pages[i]);
-			put_page(pages[i]);
+		if (nr_jobs == 1) {
+			squashfs_readahead_block(job);
+			continue;
 		}
+		job->queued = true;
+		queue_work(squashfs_read_wq, &job->work);
+		cur = (cur + 1) % nr_jobs;
 	}
 
-	kfree(pages);
+	squashfs_free_ra_jobs(jobs, nr_jobs);
 	return;
 
 skip_pages:
@@ -629,7 +728,19 @@ skip_pages:
 		unlock_page(pages[i]);
 		put_page(pages[i]);
 	}
-	kfree(pages);
+	squashfs_free_ra_jobs(jobs, nr_jobs);
+}
+
+int __init squashfs_init_readahead(void)
+{
+	squashfs_read_wq = alloc_workqueue("squashfs_read",
+					   WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+	return squashfs_read_wq ? 0 : -ENOMEM;
+}
+
+void squashfs_destroy_readahead(void)
+{
+	destroy_workqueue(squashfs_read_wq);
 }
 
 const struct address_space_operations squashfs_aops = {
@@ -623,8 +623,15 @@ static int __init init_squashfs_fs(void)
 	if (err)
 		return err;
 
+	err = squashfs_init_readahead();
+	if (err) {
+		destroy_inodecache();
+		return err;
+	}
+
 	err = register_filesystem(&squashfs_fs_type);
 	if (err) {
+		squashfs_destroy_readahead();
 		destroy_inodecache();
 		return err;
 	}
@@ -638,6 +645,7 @@ static int __init init_squashfs_fs(void)
 static void __exit exit_squashfs_fs(void)
 {
 	unregister_filesystem(&squashfs_fs_type);
+	squashfs_destroy_readahead();
 	destroy_inodecache();
 }
 
@@ -19,6 +19,8 @@
 #include <linux/pagemap.h>
 #include <linux/compat.h>
 #include <linux/iversion.h>
+#include <linux/audit.h>
+#include <linux/fs_struct.h>
 
 #include <linux/uaccess.h>
 #include <asm/unistd.h>
@@ -208,6 +210,29 @@ int getname_statx_lookup_flags(int flags)
 	return lookup_flags;
 }
 
+static int vfs_statx_path(const struct path *path, int flags,
+			  struct kstat *stat, u32 request_mask)
+{
+	int error = vfs_getattr(path, stat, request_mask, flags);
+
+	stat->mnt_id = real_mount(path->mnt)->mnt_id;
+	stat->result_mask |= STATX_MNT_ID;
+
+	if (path->mnt->mnt_root == path->dentry)
+		stat->attributes |= STATX_ATTR_MOUNT_ROOT;
+	stat->attributes_mask |= STATX_ATTR_MOUNT_ROOT;
+
+	/* Handle STATX_DIOALIGN for block devices. */
+	if (request_mask & STATX_DIOALIGN) {
+		struct inode *inode = d_backing_inode(path->dentry);
+
+		if (S_ISBLK(inode->i_mode))
+			bdev_statx_dioalign(inode, stat);
+	}
+
+	return error;
+}
+
 /**
  * vfs_statx - Get basic and extra attributes by filename
  * @dfd: A file descriptor representing the base dir for a relative filename
@@ -239,23 +264,7 @@ retry:
 	if (error)
 		goto out;
 
-	error = vfs_getattr(&path, stat, request_mask, flags);
-
-	stat->mnt_id = real_mount(path.mnt)->mnt_id;
-	stat->result_mask |= STATX_MNT_ID;
-
-	if (path.mnt->mnt_root == path.dentry)
-		stat->attributes |= STATX_ATTR_MOUNT_ROOT;
-	stat->attributes_mask |= STATX_ATTR_MOUNT_ROOT;
-
-	/* Handle STATX_DIOALIGN for block devices. */
-	if (request_mask & STATX_DIOALIGN) {
-		struct inode *inode = d_backing_inode(path.dentry);
-
-		if (S_ISBLK(inode->i_mode))
-			bdev_statx_dioalign(inode, stat);
-	}
-
+	error = vfs_statx_path(&path, flags, stat, request_mask);
 	path_put(&path);
 	if (retry_estale(error, lookup_flags)) {
 		lookup_flags |= LOOKUP_REVAL;
@@ -601,8 +610,7 @@ SYSCALL_DEFINE4(fstatat64, int, dfd, const char __user *, filename,
 }
 #endif /* __ARCH_WANT_STAT64 || __ARCH_WANT_COMPAT_STAT64 */
 
-static noinline_for_stack int
-cp_statx(const struct kstat *stat, struct statx __user *buffer)
+void statx_fill(struct statx *out, const struct kstat *stat)
 {
 	struct statx tmp;
 
@@ -637,6 +645,15 @@ cp_statx(const struct kstat *stat, struct statx __user *buffer)
 	tmp.stx_dio_mem_align = stat->dio_mem_align;
 	tmp.stx_dio_offset_align = stat->dio_offset_align;
 
+	*out = tmp;
+}
+
+static noinline_for_stack int
+cp_statx(const struct kstat *stat, struct statx __user *buffer)
+{
+	struct statx tmp;
+
+	statx_fill(&tmp, stat);
 	return copy_to_user(buffer, &tmp, sizeof(tmp)) ? -EFAULT : 0;
 }
 
@@ -689,6 +706,166 @@ SYSCALL_DEFINE5(statx,
 	return ret;
 }
 
+/*
+ * Look up a single name component directly in an already pinned directory,
+ * skipping the path walk setup.  Returns -EAGAIN if the name needs the
+ * full walk: more than one component, "." or "..", a symlink to follow,
+ * a mount point or automount trigger, or when audit wants the names.
+ */
+static int statx_lookup_child(const struct path *dir, const char *name,
+			      int len, unsigned int flags, struct kstat *stat,
+			      u32 request_mask)
+{
+	struct path path = { .mnt = dir->mnt };
+	int error;
+
+	if (!len || memchr(name, '/', len) ||
+	    (name[0] == '.' && (len == 1 || (len == 2 && name[1] == '.'))) ||
+	    !audit_dummy_context())
+		return -EAGAIN;
+
+	path.dentry = lookup_one_positive_unlocked(mnt_idmap(dir->mnt), name,
+						   dir->dentry, len);
+	if (IS_ERR(path.dentry))
+		return PTR_ERR(path.dentry);
+
+	if (d_managed(path.dentry) ||
+	    (d_is_symlink(path.dentry) && !(flags & AT_SYMLINK_NOFOLLOW))) {
+		dput(path.dentry);
+		return -EAGAIN;
+	}
+
+	error = vfs_statx_path(&path, flags, stat, request_mask);
+	dput(path.dentry);
+	return error;
+}
+
+/**
+ * vfs_statx_child - Get attributes of a directory entry
+ * @dfd: File descriptor of the directory, used if a full walk is needed
+ * @dir: The same directory, already pinned by the caller
+ * @name: NUL terminated entry name
+ * @len: Length of @name
+ * @flags: Flags to control the query
+ * @stat: The result structure to fill in.
+ * @request_mask: STATX_xxx flags indicating what the caller wants
+ */
+int vfs_statx_child(int dfd, const struct path *dir, const char *name,
+		    int len, int flags, struct kstat *stat, u32 request_mask)
+{
+	struct filename *fname;
+	int error;
+
+	error = statx_lookup_child(dir, name, len, flags, stat, request_mask);
+	if (error != -EAGAIN)
+		return error;
+
+	fname = getname_kernel(name);
+	error = vfs_statx(dfd, fname, flags, stat, request_mask);
+	putname(fname);
+	return error;
+}
+
+static int statx_batch_one(int dfd, const struct path *dir,
+			   const struct statx_batch *ent, unsigned int flags,
+			   unsigned int mask)
+{
+	const char __user *uname = u64_to_user_ptr(ent->name);
+	struct statx __user *buffer = u64_to_user_ptr(ent->buf);
+	char name[NAME_MAX + 1];
+	struct filename *fname;
+	struct kstat stat;
+	long len;
+	int error;
+
+	if (dir) {
+		len = strncpy_from_user(name, uname, sizeof(name));
+		if (len < 0)
+			return len;
+		if (len < sizeof(name)) {
+			error = statx_lookup_child(dir, name, len, flags,
+						   &stat, mask);
+			if (!error)
+				return cp_statx(&stat, buffer);
+			if (error != -EAGAIN)
+				return error;
+		}
+	}
+
+	fname = getname_flags(uname, getname_statx_lookup_flags(flags), NULL);
+	error = do_statx(dfd, fname, flags, mask, buffer);
+	putname(fname);
+	return error;
+}
+
+/**
+ * sys_statx_batch - Get enhanced stats of many files in one call
+ * @dfd: Base directory to pathwalk from.
+ * @entries: Array of name/buffer pairs, results are stored in it.
+ * @nr: Number of entries, at most STATX_BATCH_MAX.
+ * @flags: AT_* flags as for statx(), applied to every entry.
+ * @mask: Parts of statx struct actually required.
+ *
+ * Single component names are looked up directly in @dfd, everything else
+ * goes through the same path walk as statx().  A failure of one entry is
+ * reported in its result field and does not stop the batch.
+ *
+ * Returns the number of entries processed, which is less than @nr only if
+ * a fatal signal is pending or @entries faults part way through.
+ */
+SYSCALL_DEFINE5(statx_batch,
+		int, dfd, struct statx_batch __user *, entries,
+		unsigned int, nr, unsigned int, flags, unsigned int, mask)
+{
+	struct path dir, *dirp = NULL;
+	unsigned int i;
+
+	if (flags & ~(AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT |
+		      AT_STATX_SYNC_TYPE))
+		return -EINVAL;
+	if ((flags & AT_STATX_SYNC_TYPE) == AT_STATX_SYNC_TYPE)
+		return -EINVAL;
+	if (mask & STATX__RESERVED)
+		return -EINVAL;
+	if (nr > STATX_BATCH_MAX)
+		return -E2BIG;
+	mask &= ~STATX_CHANGE_COOKIE;
+
+	/* Pin the directory once, the fast path looks up in it directly */
+	if (dfd == AT_FDCWD) {
+		get_fs_pwd(current->fs, &dir);
+	} else {
+		struct fd f = fdget_raw(dfd);
+
+		if (!f.file)
+			return -EBADF;
+		dir = f.file->f_path;
+		path_get(&dir);
+		fdput(f);
+	}
+	if (d_can_lookup(dir.dentry))
+		dirp = &dir;
+
+	for (i = 0; i < nr; i++) {
+		struct statx_batch ent;
+		int error;
+
+		if (copy_from_user(&ent, &entries[i], sizeof(ent)))
+			break;
+		error = statx_batch_one(dfd, dirp, &ent, flags, mask);
+		if (put_user(error, &entries[i].result))
+			break;
+		if (fatal_signal_pending(current)) {
+			i++;
+			break;
+		}
+		cond_resched();
+	}
+	path_put(&dir);
+
+	return i ? i : (nr ? -EFAULT : 0);
+}
+
 #if defined(CONFIG_COMPAT) && defined(__ARCH_WANT_COMPAT_STAT)
 static int cp_compat_stat(struct kstat *stat, struct compat_stat __user *ubuf)
 {
@@ -15,6 +15,7 @@
 #include "xfs_defer.h"
 #include "xfs_inode.h"
 #include "xfs_dir2.h"
+#include "xfs_dir2_priv.h"
 #include "xfs_attr.h"
 #include "xfs_trans_space.h"
 #include "xfs_trans.h"
@@ -641,6 +642,55 @@ xfs_ip2xflags(
 	return flags;
 }
 
+/*
+ * A cold lookup in a directory is usually followed by lookups of its
+ * siblings, and those hash to data blocks all over the directory.  The
+ * first time a name is looked up in a multi-block directory, start
+ * readahead of its data blocks so the following lookups do not each
+ * wait for a read.  Large directories are left alone.
+ */
+#define XFS_DIR_LOOKUP_RA_BYTES	(256 * 1024)
+
+static void
+xfs_dir_lookup_readahead(
+	struct xfs_inode	*dp)
+{
+	struct xfs_da_geometry	*geo = dp->i_mount->m_dir_geo;
+	struct xfs_ifork	*ifp = xfs_ifork_ptr(dp, XFS_DATA_FORK);
+	struct xfs_iext_cursor	icur;
+	struct xfs_bmbt_irec	map;
+	struct blk_plug		plug;
+	xfs_dablk_t		last_da, da;
+	unsigned int		lock_mode;
+
+	if (xfs_iflags_test_and_set(dp, XFS_IDIRRA))
+		return;
+	if (ifp->if_format != XFS_DINODE_FMT_EXTENTS &&
+	    ifp->if_format != XFS_DINODE_FMT_BTREE)
+		return;
+	if (dp->i_disk_size <= geo->blksize ||
+	    dp->i_disk_size > XFS_DIR_LOOKUP_RA_BYTES)
+		return;
+
+	lock_mode = xfs_ilock_data_map_shared(dp);
+	if (xfs_iread_extents(NULL, dp, XFS_DATA_FORK))
+		goto out_unlock;
+
+	last_da = xfs_dir2_byte_to_da(geo, XFS_DIR2_LEAF_OFFSET);
+	blk_start_plug(&plug);
+	for_each_xfs_iext(ifp, &icur, &map) {
+		if (map.br_startoff >= last_da)
+			break;
+		for (da = roundup((xfs_dablk_t)map.br_startoff, geo->fsbcount);
+		     da < map.br_startoff + map.br_blockcount && da < last_da;
+		     da += geo->fsbcount)
+			xfs_dir3_data_readahead(dp, da, XFS_DABUF_MAP_HOLE_OK);
+	}
+	blk_finish_plug(&plug);
+out_unlock:
+	xfs_iunlock(dp, lock_mode);
+}
+
 /*
  * Lookups up an inode from "name". If ci_name is not NULL, then a CI match
  * is allowed, otherwise it has to be an exact match. If a CI match is found,
@@ -662,6 +712,7 @@ xfs_lookup(
 	if (xfs_is_shutdown(dp->i_mount))
 		return -EIO;
 
+	xfs_dir_lookup_readahead(dp);
 	error = xfs_dir_lookup(NULL, dp, name, &inum, ci_name);
 	if (error)
 		goto out_unlock;
@@ -1456,8 +1456,17 @@ xlog_get_iclog_buffer_size(
 {
 	if (mp->m_logbufs <= 0)
 		mp->m_logbufs = XLOG_MAX_ICLOGS;
-	if (mp->m_logbsize <= 0)
-		mp->m_logbsize = XLOG_BIG_RECORD_BSIZE;
+	if (mp->m_logbsize <= 0) {
+		/*
+		 * Checkpoints are written out in iclog sized pieces.  Where
+		 * that doesn't cost seeks, use the largest iclogs so that
+		 * fewer writes and less iclog switching are needed per push.
+		 */
+		if (xfs_has_logv2(mp) && bdev_nonrot(log->l_targ->bt_bdev))
+			mp->m_logbsize = XLOG_MAX_RECORD_BSIZE;
+		else
+			mp->m_logbsize = XLOG_BIG_RECORD_BSIZE;
+	}
 
 	log->l_iclog_bufs = mp->m_logbufs;
 	log->l_iclog_size = mp->m_logbsize;
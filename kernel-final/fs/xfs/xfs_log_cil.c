@@ -924,6 +924,7 @@ xlog_cil_order_write(
 	enum _record_type	record)
 {
 	struct xfs_cil_ctx	*ctx;
+	ktime_t			stall = 0;
 
 restart:
 	spin_lock(&cil->xc_push_lock);
@@ -949,12 +950,16 @@ restart:
 		switch (record) {
 		case _START_RECORD:
 			if (!ctx->start_lsn) {
+				if (!stall)
+					stall = ktime_get();
 				xlog_wait(&cil->xc_start_wait, &cil->xc_push_lock);
 				goto restart;
 			}
 			break;
 		case _COMMIT_RECORD:
 			if (!ctx->commit_lsn) {
+				if (!stall)
+					stall = ktime_get();
 				xlog_wait(&cil->xc_commit_wait, &cil->xc_push_lock);
 				goto restart;
 			}
@@ -962,6 +967,12 @@ restart:
 		}
 	}
 	spin_unlock(&cil->xc_push_lock);
+
+	if (stall) {
+		XFS_STATS_INC(cil->xc_log->l_mp, xs_cil_order_wait);
+		XFS_STATS_ADD(cil->xc_log->l_mp, xs_cil_order_wait_us,
+			      ktime_us_delta(ktime_get(), stall));
+	}
 	return 0;
 }
 
@@ -1487,9 +1498,14 @@ xlog_cil_push_background(
 	 * calling xlog_cil_over_hard_limit() in this context.
 	 */
 	if (xlog_cil_over_hard_limit(log, space_used)) {
+		ktime_t		stall = ktime_get();
+
 		trace_xfs_log_cil_wait(log, cil->xc_ctx->ticket);
 		ASSERT(space_used < log->l_logsize);
 		xlog_wait(&cil->xc_push_wait, &cil->xc_push_lock);
+		XFS_STATS_INC(log->l_mp, xs_cil_throttle);
+		XFS_STATS_ADD(log->l_mp, xs_cil_throttle_us,
+			      ktime_us_delta(ktime_get(), stall));
 		return;
 	}
 
@@ -24,6 +24,8 @@ int xfs_stats_format(struct xfsstats __percpu *stats, char *buf)
 	uint64_t	xs_write_bytes = 0;
 	uint64_t	xs_read_bytes = 0;
 	uint64_t	defer_relog = 0;
+	uint64_t	xs_cil_throttle_us = 0;
+	uint64_t	xs_cil_order_wait_us = 0;
 
 	static const struct xstats_entry {
 		char	*desc;
@@ -52,7 +54,7 @@ int xfs_stats_format(struct xfsstats __percpu *stats, char *buf)
 		{ "rmapbt",		xfsstats_offset(xs_refcbt_2)	},
 		{ "refcntbt",		xfsstats_offset(xs_qm_dqreclaims)},
 		/* we print both series of quota information together */
-		{ "qm",			xfsstats_offset(xs_xstrat_bytes)},
+		{ "qm",			xfsstats_offset(xs_cil_throttle)},
 	};
 
 	/* Loop over all stats groups */
@@ -72,8 +74,17 @@ int xfs_stats_format(struct xfsstats __percpu *stats, char *buf)
 		xs_write_bytes += per_cpu_ptr(stats, i)->s.xs_write_bytes;
 		xs_read_bytes += per_cpu_ptr(stats, i)->s.xs_read_bytes;
 		defer_relog += per_cpu_ptr(stats, i)->s.defer_relog;
+		xs_cil_throttle_us +=
+			per_cpu_ptr(stats, i)->s.xs_cil_throttle_us;
+		xs_cil_order_wait_us +=
+			per_cpu_ptr(stats, i)->s.xs_cil_order_wait_us;
 	}
 
+	len += scnprintf(buf + len, PATH_MAX-len, "cil %u %llu %u %llu\n",
+			counter_val(stats, xfsstats_offset(xs_cil_throttle)),
+			xs_cil_throttle_us,
+			counter_val(stats, xfsstats_offset(xs_cil_order_wait)),
+			xs_cil_order_wait_us);
 	len += scnprintf(buf + len, PATH_MAX-len, "xpc %llu %llu %llu\n",
 			xs_xstrat_bytes, xs_write_bytes, xs_read_bytes);
 	len += scnprintf(buf + len, PATH_MAX-len, "defer_relog %llu\n",
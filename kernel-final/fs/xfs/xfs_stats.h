@@ -133,11 +133,15 @@ struct __xfsstats {
 	uint32_t		xs_qm_dqwants;
 	uint32_t		xs_qm_dquot;
 	uint32_t		xs_qm_dquot_unused;
+	uint32_t		xs_cil_throttle;	/* commits throttled */
+	uint32_t		xs_cil_order_wait;	/* pushes kept in order */
 /* Extra precision counters */
 	uint64_t		xs_xstrat_bytes;
 	uint64_t		xs_write_bytes;
 	uint64_t		xs_read_bytes;
 	uint64_t		defer_relog;
+	uint64_t		xs_cil_throttle_us;
+	uint64_t		xs_cil_order_wait_us;
 };
 
 #define	xfsstats_offset(f)	(offsetof(struct __xfsstats, f)/sizeof(uint32_t))
@@ -17,6 +17,7 @@
 struct page;
 struct device;
 struct dentry;
+struct wb_par_batch;
 
 /*
  * Bits in bdi_writeback.state
@@ -38,6 +39,9 @@ enum wb_stat_item {
 
 #define WB_STAT_BATCH (8*(1+ilog2(nr_cpu_ids)))
 
+/* upper limit of backing_dev_info->wb_threads */
+#define BDI_MAX_WB_THREADS	8
+
 /*
  * why some writeback work was initiated
  */
@@ -143,6 +147,8 @@ struct bdi_writeback {
 
 	unsigned long dirty_sleep;	/* last wait */
 
+	struct wb_par_batch *par_batch;	/* parallel writeback, flusher only */
+
 	struct list_head bdi_node;	/* anchored at bdi->wb_list */
 
 #ifdef CONFIG_CGROUP_WRITEBACK
@@ -173,6 +179,7 @@ struct backing_dev_info {
 	unsigned int capabilities; /* Device capabilities */
 	unsigned int min_ratio;
 	unsigned int max_ratio, max_prop_frac;
+	unsigned int wb_threads;	/* flusher threads per writeback */
 
 	/*
 	 * Sum of avg_write_bw of wbs with dirty inodes.  > 0 if there are
@@ -56,6 +56,17 @@ static inline void eventpoll_release(struct file *file)
 int do_epoll_ctl(int epfd, int op, int fd, struct epoll_event *epds,
 		 bool nonblock);
 
+/* Private instances used by the poll(2) registration cache */
+struct eventpoll;
+struct timespec64;
+struct eventpoll *ep_poll_cache_alloc(void);
+void ep_poll_cache_free(struct eventpoll *ep);
+int ep_poll_cache_add(struct eventpoll *ep, struct file *file, int fd,
+		      __poll_t events, u64 data);
+bool ep_poll_cache_match(struct eventpoll *ep, struct file *file, int fd);
+int ep_poll_cache_wait(struct eventpoll *ep, struct timespec64 *timeout,
+		       void (*report)(void *, u64, __poll_t), void *priv);
+
 /* Tells if the epoll_ctl(2) operation needs an event copy from userspace */
 static inline int ep_op_has_event(int op)
 {
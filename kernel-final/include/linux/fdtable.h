@@ -61,6 +61,8 @@ struct files_struct {
    */
 	spinlock_t file_lock ____cacheline_aligned_in_smp;
 	unsigned int next_fd;
+	/* Bumped under file_lock whenever an open fd is closed or replaced */
+	unsigned long close_gen;
 	unsigned long close_on_exec_init[1];
 	unsigned long open_fds_init[1];
 	unsigned long full_fds_bits_init[1];
@@ -111,6 +113,15 @@ static inline struct file *lookup_fd_rcu(unsigned int fd)
 	return files_lookup_fd_rcu(current->files, fd);
 }
 
+/*
+ * Unchanged close_gen means no fd that was open when it was read has
+ * been closed or pointed at another file since.
+ */
+static inline unsigned long files_close_gen(struct files_struct *files)
+{
+	return smp_load_acquire(&files->close_gen);
+}
+
 struct file *task_lookup_fd_rcu(struct task_struct *task, unsigned int fd);
 struct file *task_lookup_next_fd_rcu(struct task_struct *task, unsigned int *fd);
 
@@ -129,6 +140,9 @@ extern int __close_range(unsigned int fd, unsigned int max_fd, unsigned int flag
 extern struct file *close_fd_get_file(unsigned int fd);
 extern int unshare_fd(unsigned long unshare_flags, unsigned int max_fds,
 		      struct files_struct **new_fdp);
+extern void release_fd_cache(struct task_struct *tsk);
+extern int set_fd_cache(unsigned long batch);
+extern int get_fd_cache(void);
 
 extern struct kmem_cache *files_cachep;
 
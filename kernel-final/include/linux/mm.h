@@ -646,6 +646,34 @@ static inline void vma_numab_state_init(struct vm_area_struct *vma) {}
 static inline void vma_numab_state_free(struct vm_area_struct *vma) {}
 #endif /* CONFIG_NUMA_BALANCING */
 
+#ifdef CONFIG_PROC_PAGE_MONITOR
+void vma_smaps_free(struct vm_area_struct *vma);
+void __vma_smaps_invalidate(struct vm_area_struct *vma, unsigned long start,
+			    unsigned long end);
+
+static inline void vma_smaps_init(struct vm_area_struct *vma)
+{
+	vma->smaps_cache = NULL;
+}
+
+/*
+ * Page table entries of @vma in [@start, @end) changed, so the statistics
+ * cached for them by /proc/pid/smaps have to be gathered again.  Must be
+ * called after the new entries are visible to page table walkers.
+ */
+static inline void vma_smaps_invalidate(struct vm_area_struct *vma,
+					unsigned long start, unsigned long end)
+{
+	if (unlikely(READ_ONCE(vma->smaps_cache)))
+		__vma_smaps_invalidate(vma, start, end);
+}
+#else
+static inline void vma_smaps_init(struct vm_area_struct *vma) {}
+static inline void vma_smaps_free(struct vm_area_struct *vma) {}
+static inline void vma_smaps_invalidate(struct vm_area_struct *vma,
+					unsigned long start, unsigned long end) {}
+#endif /* CONFIG_PROC_PAGE_MONITOR */
+
 #ifdef CONFIG_PER_VMA_LOCK
 /*
  * Try to read-lock a vma. The function is allowed to occasionally yield false
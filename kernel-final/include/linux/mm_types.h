@@ -611,6 +611,10 @@ struct vm_area_struct {
 #endif
 #ifdef CONFIG_NUMA_BALANCING
 	struct vma_numab_state *numab_state;	/* NUMA Balancing state */
+#endif
+#ifdef CONFIG_PROC_PAGE_MONITOR
+	/* Statistics cached for /proc/pid/smaps, see fs/proc/task_mmu.c */
+	struct smaps_cache *smaps_cache;
 #endif
 	struct vm_userfaultfd_ctx vm_userfaultfd_ctx;
 #ifdef CONFIG_GMEM
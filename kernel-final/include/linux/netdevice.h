@@ -2057,6 +2057,8 @@ enum netdev_ml_priv_type {
  *			Assigned by a driver before netdev registration using
  *			SET_NETDEV_DEVLINK_PORT macro. This pointer is static
  *			during the time netdevice is registered.
+ *	@page_pools:	Page pools created for this device, for reporting
+ *			their stats over netlink.
  *
  *	FIXME: cleanup struct net_device such that network protocol info
  *	moves out.
@@ -2414,6 +2416,9 @@ struct net_device {
 	struct rtnl_hw_stats64	*offload_xstats_l3;
 
 	struct devlink_port	*devlink_port;
+#ifdef CONFIG_PAGE_POOL_STATS
+	struct hlist_head	page_pools;
+#endif
 };
 #define to_net_dev(d) container_of(d, struct net_device, dev)
 
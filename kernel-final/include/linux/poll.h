@@ -111,6 +111,7 @@ struct poll_wqueues {
 extern void poll_initwait(struct poll_wqueues *pwq);
 extern void poll_freewait(struct poll_wqueues *pwq);
 extern u64 select_estimate_accuracy(struct timespec64 *tv);
+extern void release_poll_cache(struct task_struct *tsk);
 
 #define MAX_INT64_SECONDS (((s64)(~((u64)0)>>1)/HZ)-1)
 
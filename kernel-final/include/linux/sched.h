@@ -49,6 +49,7 @@ struct bpf_local_storage;
 struct bpf_run_ctx;
 struct capture_control;
 struct cfs_rq;
+struct fd_cache;
 struct fs_struct;
 struct futex_pi_state;
 struct io_context;
@@ -59,6 +60,7 @@ struct nsproxy;
 struct perf_event_context;
 struct pid_namespace;
 struct pipe_inode_info;
+struct poll_cache;
 struct rcu_node;
 struct reclaim_state;
 struct robust_list_head;
@@ -1100,6 +1102,10 @@ struct task_struct {
 
 	/* Open file information: */
 	struct files_struct		*files;
+	/* Reserved descriptors, see PR_SET_FD_CACHE: */
+	struct fd_cache			*fd_cache;
+	/* Cached poll(2) registrations, see fs/select.c: */
+	struct poll_cache		*poll_cache;
 
 #ifdef CONFIG_IO_URING
 	struct io_uring_task		*io_uring;
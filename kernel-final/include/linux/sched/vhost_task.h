@@ -10,5 +10,6 @@ struct vhost_task *vhost_task_create(bool (*fn)(void *), void *arg,
 void vhost_task_start(struct vhost_task *vtsk);
 void vhost_task_stop(struct vhost_task *vtsk);
 void vhost_task_wake(struct vhost_task *vtsk);
+pid_t vhost_task_pid(struct vhost_task *vtsk);
 
 #endif
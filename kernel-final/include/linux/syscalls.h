@@ -47,6 +47,8 @@ struct stat64;
 struct statfs;
 struct statfs64;
 struct statx;
+struct statx_batch;
+struct dirent_statx;
 struct sysinfo;
 struct timespec;
 struct __kernel_old_timeval;
@@ -1058,6 +1060,13 @@ asmlinkage long sys_memfd_secret(unsigned int flags);
 asmlinkage long sys_set_mempolicy_home_node(unsigned long start, unsigned long len,
 					    unsigned long home_node,
 					    unsigned long flags);
+asmlinkage long sys_statx_batch(int dfd, struct statx_batch __user *entries,
+				unsigned int nr, unsigned int flags,
+				unsigned int mask);
+asmlinkage long sys_getdents_statx(unsigned int fd,
+				   struct dirent_statx __user *dirent,
+				   unsigned int count, unsigned int flags,
+				   unsigned int mask);
 
 /*
  * Architecture-specific system calls
@@ -331,6 +331,9 @@ extern struct hlist_nulls_head *nf_conntrack_hash;
 extern unsigned int nf_conntrack_htable_size;
 extern seqcount_spinlock_t nf_conntrack_generation;
 extern unsigned int nf_conntrack_max;
+extern u8 nf_conntrack_hash_auto;
+extern unsigned int nf_conntrack_hash_resizes;
+extern unsigned int nf_conntrack_hash_max_chain;
 
 /* must be called with rcu read lock held */
 static inline void
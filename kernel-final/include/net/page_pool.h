@@ -34,6 +34,8 @@
 #include <linux/ptr_ring.h>
 #include <linux/dma-direction.h>
 
+struct net_device;
+
 #define PP_FLAG_DMA_MAP		BIT(0) /* Should page_pool do the DMA
 					* map/unmap
 					*/
@@ -83,6 +85,7 @@ struct page_pool_params {
 	unsigned int	offset;  /* DMA addr offset */
 	void (*init_callback)(struct page *page, void *arg);
 	void *init_arg;
+	struct net_device *netdev; /* netdev reporting the pool stats, or NULL */
 };
 
 #ifdef CONFIG_PAGE_POOL_STATS
@@ -129,6 +132,8 @@ u64 *page_pool_ethtool_stats_get(u64 *data, void *stats);
  */
 bool page_pool_get_stats(struct page_pool *pool,
 			 struct page_pool_stats *stats);
+int page_pool_get_netdev_stats(struct net_device *dev,
+			       struct page_pool_stats *stats);
 #else
 
 static inline int page_pool_ethtool_stats_get_count(void)
@@ -208,6 +213,11 @@ struct page_pool {
 	refcount_t user_cnt;
 
 	u64 destroy_cnt;
+
+#ifdef CONFIG_PAGE_POOL_STATS
+	/* anchor in p.netdev->page_pools */
+	struct hlist_node netdev_node;
+#endif
 };
 
 struct page *page_pool_alloc_pages(struct page_pool *pool, gfp_t gfp);
@@ -243,6 +243,7 @@ struct tls_context {
 	u8 rx_conf:3;
 	u8 zerocopy_sendfile:1;
 	u8 rx_no_pad:1;
+	u8 tx_parallel:1;
 
 	int (*push_pending_record)(struct sock *sk, int flags);
 	void (*sk_write_space)(struct sock *sk);
@@ -276,6 +277,13 @@ struct tls_context {
 	union tls_crypto_context crypto_send;
 	union tls_crypto_context crypto_recv;
 
+	/* records decrypted straight into the reader's buffer vs. copied,
+	 * here rather than in priv_ctx_rx as tls_get_info() reads them
+	 * under RCU only
+	 */
+	u64 rx_zc_decrypts;
+	u64 rx_copy_decrypts;
+
 	struct list_head list;
 	refcount_t refcount;
 	struct rcu_head rcu;
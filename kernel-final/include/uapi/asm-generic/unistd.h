@@ -886,8 +886,13 @@ __SYSCALL(__NR_futex_waitv, sys_futex_waitv)
 #define __NR_set_mempolicy_home_node 450
 __SYSCALL(__NR_set_mempolicy_home_node, sys_set_mempolicy_home_node)
 
+#define __NR_statx_batch 451
+__SYSCALL(__NR_statx_batch, sys_statx_batch)
+#define __NR_getdents_statx 452
+__SYSCALL(__NR_getdents_statx, sys_getdents_statx)
+
 #undef __NR_syscalls
-#define __NR_syscalls 451
+#define __NR_syscalls 453
 #define __NR_peep_page 548
 __SYSCALL(__NR_peep_page, sys_peep_page)
 
@@ -989,6 +989,7 @@ struct fuse_notify_retrieve_in {
 /* Device ioctls: */
 #define FUSE_DEV_IOC_MAGIC		229
 #define FUSE_DEV_IOC_CLONE		_IOR(FUSE_DEV_IOC_MAGIC, 0, uint32_t)
+#define FUSE_DEV_IOC_BIND_CPU		_IOW(FUSE_DEV_IOC_MAGIC, 1, uint32_t)
 
 struct fuse_lseek_in {
 	uint64_t	fh;
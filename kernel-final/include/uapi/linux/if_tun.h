@@ -61,6 +61,9 @@
 #define TUNSETFILTEREBPF _IOR('T', 225, int)
 #define TUNSETCARRIER _IOW('T', 226, int)
 #define TUNGETDEVNETNS _IO('T', 227)
+/* Move several packets per call, see struct tun_mmsg */
+#define TUNSENDMMSG _IOW('T', 228, struct tun_mmsg)
+#define TUNRECVMMSG _IOW('T', 229, struct tun_mmsg)
 
 /* TUNSETIFF ifr flags */
 #define IFF_TUN		0x0001
@@ -115,4 +118,24 @@ struct tun_filter {
 	__u8   addr[][ETH_ALEN];
 };
 
+/*
+ * Batched I/O (TUNSENDMMSG/TUNRECVMMSG). Each tun_mmsghdr describes one
+ * packet laid out as for write()/read(), including tun_pi and the
+ * virtio-net header if enabled. The ioctl returns the number of packets
+ * moved and sets len of each; on error it returns -1 unless some packets
+ * were already moved. Only MSG_DONTWAIT is accepted in flags. Reads
+ * block for the first packet at most.
+ */
+struct tun_mmsghdr {
+	__u64	iov;	/* const struct iovec * */
+	__u32	iovlen;
+	__u32	len;	/* bytes written or read */
+};
+
+struct tun_mmsg {
+	__u64	msgs;	/* struct tun_mmsghdr * */
+	__u32	nr;
+	__u32	flags;
+};
+
 #endif /* _UAPI__IF_TUN_H */
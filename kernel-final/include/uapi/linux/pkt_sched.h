@@ -940,6 +940,8 @@ enum {
 
 	TCA_FQ_HORIZON_DROP,	/* drop packets beyond horizon, or cap their EDT */
 
+	TCA_FQ_PCPU_ENQUEUE,	/* lockless enqueue through per-CPU lists */
+
 	__TCA_FQ_MAX
 };
 
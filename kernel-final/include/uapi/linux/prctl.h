@@ -294,4 +294,8 @@ struct prctl_mm_map {
 
 #define PR_SET_MEMORY_MERGE		67
 #define PR_GET_MEMORY_MERGE		68
+
+/* Per-thread cache of reserved file descriptors, 0 disables */
+#define PR_SET_FD_CACHE			69
+#define PR_GET_FD_CACHE			70
 #endif /* _LINUX_PRCTL_H */
@@ -157,6 +157,36 @@ struct statx {
 
 #define STATX__RESERVED		0x80000000U	/* Reserved for future struct statx expansion */
 
+/*
+ * One entry of a statx_batch() request.  @name points to a path relative to
+ * the batch's dfd, @buf to the struct statx to fill in.  @result is set to 0
+ * or to the negative error code for this entry.
+ */
+struct statx_batch {
+	__u64	name;
+	__u64	buf;
+	__s32	result;
+	__u32	__spare;
+};
+
+#define STATX_BATCH_MAX		1024	/* Max entries per statx_batch() call */
+
+/*
+ * Directory entry returned by getdents_statx().  The fields up to d_type
+ * match struct linux_dirent64.  d_result is 0 if d_stat holds the entry's
+ * attributes, or the negative error code of looking them up.
+ */
+struct dirent_statx {
+	__u64	d_ino;
+	__s64	d_off;
+	__u16	d_reclen;
+	__u8	d_type;
+	__u8	__pad;
+	__s32	d_result;
+	struct statx d_stat;
+	char	d_name[];
+};
+
 #ifndef __KERNEL__
 /*
  * This is deprecated, and shall remain the same value in the future.  To avoid
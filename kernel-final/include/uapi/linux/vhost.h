@@ -92,6 +92,17 @@
 #define VHOST_SET_BACKEND_FEATURES _IOW(VHOST_VIRTIO, 0x25, __u64)
 #define VHOST_GET_BACKEND_FEATURES _IOR(VHOST_VIRTIO, 0x26, __u64)
 
+/* Share a worker thread between devices of the same owner, e.g. to serve
+ * several queue pairs of a multiqueue virtio-net device from one thread.
+ * VHOST_GET_WORKER returns the id of the worker serving this device.
+ * VHOST_ATTACH_WORKER switches this device over to the worker with the given
+ * id. It must be issued before any ring kick or backend is set. */
+#define VHOST_GET_WORKER _IOR(VHOST_VIRTIO, 0x27, __u32)
+#define VHOST_ATTACH_WORKER _IOW(VHOST_VIRTIO, 0x28, __u32)
+/* Get utilization of the worker serving this device */
+#define VHOST_GET_WORKER_STATS _IOR(VHOST_VIRTIO, 0x29,	\
+				    struct vhost_worker_stats)
+
 /* VHOST_NET specific defines */
 
 /* Attach virtio net ring to a raw socket, or tap device.
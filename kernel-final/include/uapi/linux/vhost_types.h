@@ -47,6 +47,22 @@ struct vhost_vring_addr {
 	__u64 log_guest_addr;
 };
 
+struct vhost_worker_stats {
+	/* Worker id, see VHOST_ATTACH_WORKER */
+	__u32 id;
+	/* Worker thread id, for setting its affinity */
+	__u32 pid;
+	/* Number of devices served by the worker */
+	__u32 users;
+	__u32 padding;
+	/* Work items run */
+	__u64 works;
+	/* Time spent running work items */
+	__u64 busy_ns;
+	/* Part of busy_ns spent busy polling */
+	__u64 poll_ns;
+};
+
 /* no alignment requirement */
 struct vhost_iotlb_msg {
 	__u64 iova;
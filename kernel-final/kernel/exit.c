@@ -18,6 +18,7 @@
 #include <linux/capability.h>
 #include <linux/completion.h>
 #include <linux/personality.h>
+#include <linux/poll.h>
 #include <linux/tty.h>
 #include <linux/iocontext.h>
 #include <linux/key.h>
@@ -866,6 +867,7 @@ void __noreturn do_exit(long code)
 
 	exit_sem(tsk);
 	exit_shm(tsk);
+	release_poll_cache(tsk);
 	exit_files(tsk);
 	exit_fs(tsk);
 	if (group_dead)
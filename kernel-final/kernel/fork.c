@@ -35,6 +35,7 @@
 #include <linux/sem.h>
 #include <linux/file.h>
 #include <linux/fdtable.h>
+#include <linux/poll.h>
 #include <linux/iocontext.h>
 #include <linux/key.h>
 #include <linux/kmsan.h>
@@ -524,6 +525,7 @@ struct vm_area_struct *vm_area_dup(struct vm_area_struct *orig)
 	}
 	INIT_LIST_HEAD(&new->anon_vma_chain);
 	vma_numab_state_init(new);
+	vma_smaps_init(new);
 	dup_anon_vma_name(orig, new);
 
 #ifdef CONFIG_GMEM
@@ -539,6 +541,7 @@ struct vm_area_struct *vm_area_dup(struct vm_area_struct *orig)
 void __vm_area_free(struct vm_area_struct *vma)
 {
 	vma_numab_state_free(vma);
+	vma_smaps_free(vma);
 	free_anon_vma_name(vma);
 	vma_lock_free(vma);
 	kmem_cache_free(vm_area_cachep, vma);
@@ -2441,6 +2444,8 @@ __latent_entropy struct task_struct *copy_process(
 #ifdef CONFIG_IO_URING
 	p->io_uring = NULL;
 #endif
+	p->fd_cache = NULL;
+	p->poll_cache = NULL;
 
 #if defined(SPLIT_RSS_COUNTING)
 	memset(&p->rss_stat, 0, sizeof(p->rss_stat));
@@ -3495,6 +3500,12 @@ int ksys_unshare(unsigned long unshare_flags)
 		if (new_nsproxy)
 			switch_task_namespaces(current, new_nsproxy);
 
+		if (new_fd) {
+			release_fd_cache(current);
+			/* Its registrations were checked against the old table */
+			release_poll_cache(current);
+		}
+
 		task_lock(current);
 
 		if (new_fs) {
@@ -3559,6 +3570,7 @@ int unshare_files(void)
 		return error;
 
 	old = task->files;
+	release_fd_cache(task);
 	task_lock(task);
 	task->files = copy;
 	task_unlock(task);
@@ -42,6 +42,7 @@
 #include <linux/ptrace.h>
 #include <linux/fs_struct.h>
 #include <linux/file.h>
+#include <linux/fdtable.h>
 #include <linux/mount.h>
 #include <linux/gfp.h>
 #include <linux/syscore_ops.h>
@@ -2711,6 +2712,16 @@ SYSCALL_DEFINE5(prctl, int, option, unsigned long, arg2, unsigned long, arg3,
 		error = !!test_bit(MMF_VM_MERGE_ANY, &me->mm->flags);
 		break;
 #endif
+	case PR_SET_FD_CACHE:
+		if (arg3 || arg4 || arg5)
+			return -EINVAL;
+		error = set_fd_cache(arg2);
+		break;
+	case PR_GET_FD_CACHE:
+		if (arg2 || arg3 || arg4 || arg5)
+			return -EINVAL;
+		error = get_fd_cache();
+		break;
 	default:
 		error = -EINVAL;
 		break;
@@ -147,3 +147,16 @@ void vhost_task_start(struct vhost_task *vtsk)
 	wake_up_new_task(vtsk->task);
 }
 EXPORT_SYMBOL_GPL(vhost_task_start);
+
+/**
+ * vhost_task_pid - thread id of a vhost_task
+ * @vtsk: vhost_task to look up
+ *
+ * Returns the id of the worker thread in the caller's pid namespace, so
+ * the owner can find it to set its affinity.
+ */
+pid_t vhost_task_pid(struct vhost_task *vtsk)
+{
+	return task_pid_vnr(vtsk->task);
+}
+EXPORT_SYMBOL_GPL(vhost_task_pid);
@@ -331,6 +331,25 @@ static ssize_t strict_limit_show(struct device *dev,
 }
 static DEVICE_ATTR_RW(strict_limit);
 
+static ssize_t writeback_threads_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct backing_dev_info *bdi = dev_get_drvdata(dev);
+	unsigned int threads;
+	ssize_t ret;
+
+	ret = kstrtouint(buf, 10, &threads);
+	if (ret < 0)
+		return ret;
+
+	if (!threads || threads > BDI_MAX_WB_THREADS)
+		return -EINVAL;
+	WRITE_ONCE(bdi->wb_threads, threads);
+
+	return count;
+}
+BDI_SHOW(writeback_threads, bdi->wb_threads)
+
 static struct attribute *bdi_dev_attrs[] = {
 	&dev_attr_read_ahead_kb.attr,
 	&dev_attr_min_ratio.attr,
@@ -341,6 +360,7 @@ static struct attribute *bdi_dev_attrs[] = {
 	&dev_attr_max_bytes.attr,
 	&dev_attr_stable_pages_required.attr,
 	&dev_attr_strict_limit.attr,
+	&dev_attr_writeback_threads.attr,
 	NULL,
 };
 ATTRIBUTE_GROUPS(bdi_dev);
@@ -490,6 +510,7 @@ static void wb_exit(struct bdi_writeback *wb)
 		percpu_counter_destroy(&wb->stat[i]);
 
 	fprop_local_destroy_percpu(&wb->completions);
+	kfree(wb->par_batch);
 }
 
 #ifdef CONFIG_CGROUP_WRITEBACK
@@ -950,6 +971,7 @@ int bdi_init(struct backing_dev_info *bdi)
 	bdi->min_ratio = 0;
 	bdi->max_ratio = 100 * BDI_RATIO_SCALE;
 	bdi->max_prop_frac = FPROP_FRAC_BASE;
+	bdi->wb_threads = 1;
 	INIT_LIST_HEAD(&bdi->bdi_list);
 	INIT_LIST_HEAD(&bdi->wb_list);
 	init_waitqueue_head(&bdi->wb_waitq);
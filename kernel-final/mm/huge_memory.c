@@ -2390,6 +2390,7 @@ out:
 	 *     any further changes to individual pte will notify. So no need
 	 *     to call mmu_notifier->invalidate_range()
 	 */
+	vma_smaps_invalidate(vma, range.start, range.end);
 	mmu_notifier_invalidate_range_only_end(&range);
 }
 
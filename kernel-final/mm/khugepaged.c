@@ -1220,6 +1220,7 @@ static int collapse_huge_page(struct mm_struct *mm, unsigned long address,
 	pgtable_trans_huge_deposit(mm, pmd, pgtable);
 	set_pmd_at(mm, address, pmd, _pmd);
 	update_mmu_cache_pmd(vma, address, pmd);
+	vma_smaps_invalidate(vma, address, address + HPAGE_PMD_SIZE);
 	spin_unlock(pmd_ptl);
 
 	hpage = NULL;
@@ -772,6 +772,7 @@ static int madvise_free_single_vma(struct vm_area_struct *vma,
 	walk_page_range(vma->vm_mm, range.start, range.end,
 			&madvise_free_walk_ops, &tlb);
 	tlb_end_vma(&tlb, vma);
+	vma_smaps_invalidate(vma, range.start, range.end);
 	mmu_notifier_invalidate_range_end(&range);
 	tlb_finish_mmu(&tlb);
 
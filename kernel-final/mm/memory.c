@@ -1321,6 +1321,8 @@ copy_page_range(struct vm_area_struct *dst_vma, struct vm_area_struct *src_vma)
 		raw_write_seqcount_end(&src_mm->write_protect_seq);
 		mmu_notifier_invalidate_range_end(&range);
 	}
+	/* The pages copied to the child are now shared */
+	vma_smaps_invalidate(src_vma, src_vma->vm_start, src_vma->vm_end);
 	return ret;
 }
 
@@ -1735,6 +1737,7 @@ static void unmap_single_vma(struct mmu_gather *tlb,
 			}
 		} else
 			unmap_page_range(tlb, vma, start, end, details);
+		vma_smaps_invalidate(vma, start, end);
 	}
 }
 
@@ -5301,6 +5304,13 @@ vm_fault_t handle_mm_fault(struct vm_area_struct *vma, unsigned long address,
 
 	lru_gen_exit_fault();
 
+	/*
+	 * If the mmap_lock was dropped the vma may be gone, but then nothing
+	 * was mapped into an anonymous vma, the only ones with cached smaps.
+	 */
+	if (!(ret & (VM_FAULT_RETRY | VM_FAULT_COMPLETED)))
+		vma_smaps_invalidate(vma, address, address + 1);
+
 	if (flags & FAULT_FLAG_USER) {
 		mem_cgroup_exit_user_fault();
 		/*
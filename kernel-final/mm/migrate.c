@@ -270,6 +270,7 @@ static bool remove_migration_pte(struct folio *folio,
 		/* No need to invalidate - it was non-present before */
 		update_mmu_cache(vma, pvmw.address, pvmw.pte);
 	}
+	vma_smaps_invalidate(vma, addr, addr + folio_size(folio));
 
 	return true;
 }
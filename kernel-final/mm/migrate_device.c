@@ -546,6 +546,7 @@ int migrate_vma_setup(struct migrate_vma *args)
 
 	if (args->cpages)
 		migrate_vma_unmap(args);
+	vma_smaps_invalidate(args->vma, args->start, args->end);
 
 	/*
 	 * At this point pages are locked and unmapped, and thus they have
@@ -688,6 +689,7 @@ static void migrate_vma_insert_page(struct migrate_vma *migrate,
 	}
 
 	pte_unmap_unlock(ptep, ptl);
+	vma_smaps_invalidate(vma, addr, addr + PAGE_SIZE);
 	*src = MIGRATE_PFN_MIGRATE;
 	return;
 
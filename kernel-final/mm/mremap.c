@@ -565,6 +565,9 @@ unsigned long move_page_tables(struct vm_area_struct *vma,
 	}
 
 	mmu_notifier_invalidate_range_end(&range);
+	vma_smaps_invalidate(vma, range.start, old_end);
+	vma_smaps_invalidate(new_vma, new_addr - (old_addr - range.start),
+			     new_addr);
 
 	return len + old_addr - old_end;	/* how much done */
 }
@@ -1761,6 +1761,7 @@ discard:
 		folio_put(folio);
 	}
 
+	vma_smaps_invalidate(vma, range.start, range.end);
 	mmu_notifier_invalidate_range_end(&range);
 
 	return ret;
@@ -2116,6 +2117,7 @@ static bool try_to_migrate_one(struct folio *folio, struct vm_area_struct *vma,
 		folio_put(folio);
 	}
 
+	vma_smaps_invalidate(vma, range.start, range.end);
 	mmu_notifier_invalidate_range_end(&range);
 
 	return ret;
@@ -1997,6 +1997,7 @@ static int unuse_mm(struct mm_struct *mm, unsigned int type)
 	for_each_vma(vmi, vma) {
 		if (vma->anon_vma) {
 			ret = unuse_vma(vma, type);
+			vma_smaps_invalidate(vma, vma->vm_start, vma->vm_end);
 			if (ret)
 				break;
 		}
@@ -118,6 +118,7 @@ int mfill_atomic_install_pte(pmd_t *dst_pmd,
 
 	/* No need to invalidate - it was non-present before */
 	update_mmu_cache(dst_vma, dst_addr, dst_pte);
+	vma_smaps_invalidate(dst_vma, dst_addr, dst_addr + PAGE_SIZE);
 	ret = 0;
 out_unlock:
 	pte_unmap_unlock(dst_pte, ptl);
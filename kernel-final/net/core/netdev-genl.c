@@ -4,10 +4,71 @@
 #include <linux/notifier.h>
 #include <linux/rtnetlink.h>
 #include <net/net_namespace.h>
+#include <net/page_pool.h>
 #include <net/sock.h>
 
 #include "netdev-genl-gen.h"
 
+static int
+netdev_nl_page_pool_stats_fill(struct net_device *netdev, struct sk_buff *rsp)
+{
+#ifdef CONFIG_PAGE_POOL_STATS
+	struct page_pool_stats stats = {};
+	struct nlattr *nest;
+	int pools;
+
+	pools = page_pool_get_netdev_stats(netdev, &stats);
+	if (!pools)
+		return 0;
+
+	nest = nla_nest_start(rsp, NETDEV_A_DEV_PAGE_POOL_STATS);
+	if (!nest)
+		return -EMSGSIZE;
+
+	if (nla_put_u32(rsp, NETDEV_A_PAGE_POOL_STATS_POOLS, pools) ||
+	    nla_put_u64_64bit(rsp, NETDEV_A_PAGE_POOL_STATS_ALLOC_FAST,
+			      stats.alloc_stats.fast,
+			      NETDEV_A_PAGE_POOL_STATS_PAD) ||
+	    nla_put_u64_64bit(rsp, NETDEV_A_PAGE_POOL_STATS_ALLOC_SLOW,
+			      stats.alloc_stats.slow,
+			      NETDEV_A_PAGE_POOL_STATS_PAD) ||
+	    nla_put_u64_64bit(rsp, NETDEV_A_PAGE_POOL_STATS_ALLOC_SLOW_HIGH_ORDER,
+			      stats.alloc_stats.slow_high_order,
+			      NETDEV_A_PAGE_POOL_STATS_PAD) ||
+	    nla_put_u64_64bit(rsp, NETDEV_A_PAGE_POOL_STATS_ALLOC_EMPTY,
+			      stats.alloc_stats.empty,
+			      NETDEV_A_PAGE_POOL_STATS_PAD) ||
+	    nla_put_u64_64bit(rsp, NETDEV_A_PAGE_POOL_STATS_ALLOC_REFILL,
+			      stats.alloc_stats.refill,
+			      NETDEV_A_PAGE_POOL_STATS_PAD) ||
+	    nla_put_u64_64bit(rsp, NETDEV_A_PAGE_POOL_STATS_ALLOC_WAIVE,
+			      stats.alloc_stats.waive,
+			      NETDEV_A_PAGE_POOL_STATS_PAD) ||
+	    nla_put_u64_64bit(rsp, NETDEV_A_PAGE_POOL_STATS_RECYCLE_CACHED,
+			      stats.recycle_stats.cached,
+			      NETDEV_A_PAGE_POOL_STATS_PAD) ||
+	    nla_put_u64_64bit(rsp, NETDEV_A_PAGE_POOL_STATS_RECYCLE_CACHE_FULL,
+			      stats.recycle_stats.cache_full,
+			      NETDEV_A_PAGE_POOL_STATS_PAD) ||
+	    nla_put_u64_64bit(rsp, NETDEV_A_PAGE_POOL_STATS_RECYCLE_RING,
+			      stats.recycle_stats.ring,
+			      NETDEV_A_PAGE_POOL_STATS_PAD) ||
+	    nla_put_u64_64bit(rsp, NETDEV_A_PAGE_POOL_STATS_RECYCLE_RING_FULL,
+			      stats.recycle_stats.ring_full,
+			      NETDEV_A_PAGE_POOL_STATS_PAD) ||
+	    nla_put_u64_64bit(rsp,
+			      NETDEV_A_PAGE_POOL_STATS_RECYCLE_RELEASED_REFCNT,
+			      stats.recycle_stats.released_refcnt,
+			      NETDEV_A_PAGE_POOL_STATS_PAD)) {
+		nla_nest_cancel(rsp, nest);
+		return -EMSGSIZE;
+	}
+
+	nla_nest_end(rsp, nest);
+#endif
+	return 0;
+}
+
 static int
 netdev_nl_dev_fill(struct net_device *netdev, struct sk_buff *rsp,
 		   u32 portid, u32 seq, int flags, u32 cmd)
@@ -20,7 +81,8 @@ netdev_nl_dev_fill(struct net_device *netdev, struct sk_buff *rsp,
 
 	if (nla_put_u32(rsp, NETDEV_A_DEV_IFINDEX, netdev->ifindex) ||
 	    nla_put_u64_64bit(rsp, NETDEV_A_DEV_XDP_FEATURES,
-			      netdev->xdp_features, NETDEV_A_DEV_PAD)) {
+			      netdev->xdp_features, NETDEV_A_DEV_PAD) ||
+	    netdev_nl_page_pool_stats_fill(netdev, rsp)) {
 		genlmsg_cancel(rsp, hdr);
 		return -EINVAL;
 	}
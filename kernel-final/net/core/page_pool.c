@@ -89,6 +89,53 @@ bool page_pool_get_stats(struct page_pool *pool,
 }
 EXPORT_SYMBOL(page_pool_get_stats);
 
+/* Protects the netdev->page_pools lists */
+static DEFINE_SPINLOCK(page_pools_lock);
+
+static void page_pool_link_netdev(struct page_pool *pool)
+{
+	if (!pool->p.netdev)
+		return;
+
+	spin_lock_bh(&page_pools_lock);
+	hlist_add_head(&pool->netdev_node, &pool->p.netdev->page_pools);
+	spin_unlock_bh(&page_pools_lock);
+}
+
+static void page_pool_unlink_netdev(struct page_pool *pool)
+{
+	if (!pool->p.netdev)
+		return;
+
+	spin_lock_bh(&page_pools_lock);
+	hlist_del(&pool->netdev_node);
+	spin_unlock_bh(&page_pools_lock);
+}
+
+/**
+ * page_pool_get_netdev_stats() - add up the stats of a device's page pools
+ * @dev: netdev the pools were created for, see page_pool_params.netdev
+ * @stats: stats to add to, initialized by the caller
+ *
+ * Return: number of page pools of the device.
+ */
+int page_pool_get_netdev_stats(struct net_device *dev,
+			       struct page_pool_stats *stats)
+{
+	struct page_pool *pool;
+	int cnt = 0;
+
+	spin_lock_bh(&page_pools_lock);
+	hlist_for_each_entry(pool, &dev->page_pools, netdev_node) {
+		page_pool_get_stats(pool, stats);
+		cnt++;
+	}
+	spin_unlock_bh(&page_pools_lock);
+
+	return cnt;
+}
+EXPORT_SYMBOL(page_pool_get_netdev_stats);
+
 u8 *page_pool_ethtool_stats_get_strings(u8 *data)
 {
 	int i;
@@ -132,6 +179,14 @@ EXPORT_SYMBOL(page_pool_ethtool_stats_get);
 #define alloc_stat_inc(pool, __stat)
 #define recycle_stat_inc(pool, __stat)
 #define recycle_stat_add(pool, __stat, val)
+
+static void page_pool_link_netdev(struct page_pool *pool)
+{
+}
+
+static void page_pool_unlink_netdev(struct page_pool *pool)
+{
+}
 #endif
 
 static bool page_pool_producer_lock(struct page_pool *pool)
@@ -240,6 +295,7 @@ struct page_pool *page_pool_create(const struct page_pool_params *params)
 		return ERR_PTR(err);
 	}
 
+	page_pool_link_netdev(pool);
 	return pool;
 }
 EXPORT_SYMBOL(page_pool_create);
@@ -886,6 +942,7 @@ void page_pool_destroy(struct page_pool *pool)
 	if (!page_pool_put(pool))
 		return;
 
+	page_pool_unlink_netdev(pool);
 	page_pool_unlink_napi(pool);
 	page_pool_free_frag(pool);
 
@@ -69,6 +69,8 @@ struct conntrack_gc_work {
 	u32			avg_timeout;
 	u32			count;
 	u32			start_time;
+	u32			entries;
+	u32			max_chainlen;
 	bool			exiting;
 	bool			early_drop;
 };
@@ -205,6 +207,22 @@ EXPORT_SYMBOL_GPL(nf_conntrack_htable_size);
 unsigned int nf_conntrack_max __read_mostly;
 EXPORT_SYMBOL_GPL(nf_conntrack_max);
 seqcount_spinlock_t nf_conntrack_generation __read_mostly;
+
+/* While a resize is in progress, the old table and how many of its
+ * buckets have been moved to nf_conntrack_hash so far.
+ */
+static struct hlist_nulls_head *nf_conntrack_hash_old;
+static unsigned int nf_conntrack_htable_size_old;
+static unsigned int nf_conntrack_resize_pos;
+
+/* Let gc grow and shrink the table with the number of entries */
+u8 nf_conntrack_hash_auto __read_mostly;
+unsigned int nf_conntrack_hash_resizes __read_mostly;
+/* Longest chain seen by the last full gc scan */
+unsigned int nf_conntrack_hash_max_chain __read_mostly;
+static unsigned int nf_conntrack_htable_size_min __read_mostly;
+static unsigned int nf_conntrack_resize_target;
+static struct work_struct nf_conntrack_resize_work;
 static siphash_aligned_key_t nf_conntrack_hash_rnd;
 
 static u32 hash_conntrack_raw(const struct nf_conntrack_tuple *tuple,
@@ -231,9 +249,60 @@ static u32 hash_conntrack_raw(const struct nf_conntrack_tuple *tuple,
 	return (u32)siphash_4u64(a, b, c, d, &nf_conntrack_hash_rnd);
 }
 
+/*
+ * Map a raw hash to a slot: slots below nf_conntrack_htable_size are
+ * buckets of nf_conntrack_hash, the ones above are buckets of the old
+ * table that a resize has not moved yet.  Must be called under
+ * nf_conntrack_generation, and the slot used with nf_ct_hash_slot().
+ */
 static u32 scale_hash(u32 hash)
 {
-	return reciprocal_scale(hash, nf_conntrack_htable_size);
+	u32 bucket;
+
+	if (likely(!nf_conntrack_hash_old))
+		return reciprocal_scale(hash, nf_conntrack_htable_size);
+
+	bucket = reciprocal_scale(hash, nf_conntrack_htable_size_old);
+	if (bucket < nf_conntrack_resize_pos)
+		return reciprocal_scale(hash, nf_conntrack_htable_size);
+	return nf_conntrack_htable_size + bucket;
+}
+
+/* caller must hold the lock of @slot */
+static struct hlist_nulls_head *nf_ct_hash_slot(unsigned int slot)
+{
+	if (likely(slot < nf_conntrack_htable_size))
+		return &nf_conntrack_hash[slot];
+	return &nf_conntrack_hash_old[slot - nf_conntrack_htable_size];
+}
+
+/*
+ * Chain and bucket (its nulls value) of raw @hash for a lockless walk.
+ * A resize may move entries from one table to the other while we walk,
+ * so a walk that found nothing has to restart if the returned sequence
+ * is stale by then.
+ */
+static struct hlist_nulls_head *nf_conntrack_get_chain(u32 hash,
+						     unsigned int *bucket,
+						     unsigned int *sequence)
+{
+	struct hlist_nulls_head *chain;
+	unsigned int seq, slot;
+
+	do {
+		seq = read_seqcount_begin(&nf_conntrack_generation);
+		slot = scale_hash(hash);
+		if (likely(slot < nf_conntrack_htable_size)) {
+			*bucket = slot;
+			chain = &nf_conntrack_hash[slot];
+		} else {
+			*bucket = slot - nf_conntrack_htable_size;
+			chain = &nf_conntrack_hash_old[*bucket];
+		}
+	} while (read_seqcount_retry(&nf_conntrack_generation, seq));
+
+	*sequence = seq;
+	return chain;
 }
 
 static u32 __hash_conntrack(const struct net *net,
@@ -742,15 +811,14 @@ ____nf_conntrack_find(struct net *net, const struct nf_conntrack_zone *zone,
 		      const struct nf_conntrack_tuple *tuple, u32 hash)
 {
 	struct nf_conntrack_tuple_hash *h;
-	struct hlist_nulls_head *ct_hash;
+	struct hlist_nulls_head *chain;
 	struct hlist_nulls_node *n;
-	unsigned int bucket, hsize;
+	unsigned int bucket, sequence;
 
 begin:
-	nf_conntrack_get_ht(&ct_hash, &hsize);
-	bucket = reciprocal_scale(hash, hsize);
+	chain = nf_conntrack_get_chain(hash, &bucket, &sequence);
 
-	hlist_nulls_for_each_entry_rcu(h, n, &ct_hash[bucket], hnnode) {
+	hlist_nulls_for_each_entry_rcu(h, n, chain, hnnode) {
 		struct nf_conn *ct;
 
 		ct = nf_ct_tuplehash_to_ctrack(h);
@@ -772,6 +840,10 @@ begin:
 		goto begin;
 	}
 
+	/* a resize moved buckets under us */
+	if (read_seqcount_retry(&nf_conntrack_generation, sequence))
+		goto begin;
+
 	return NULL;
 }
 
@@ -837,9 +909,9 @@ static void __nf_conntrack_hash_insert(struct nf_conn *ct,
 				       unsigned int reply_hash)
 {
 	hlist_nulls_add_head_rcu(&ct->tuplehash[IP_CT_DIR_ORIGINAL].hnnode,
-			   &nf_conntrack_hash[hash]);
+			   nf_ct_hash_slot(hash));
 	hlist_nulls_add_head_rcu(&ct->tuplehash[IP_CT_DIR_REPLY].hnnode,
-			   &nf_conntrack_hash[reply_hash]);
+			   nf_ct_hash_slot(reply_hash));
 }
 
 static bool nf_ct_ext_valid_pre(const struct nf_ct_ext *ext)
@@ -901,7 +973,7 @@ nf_conntrack_hash_check_insert(struct nf_conn *ct)
 	max_chainlen = MIN_CHAINLEN + get_random_u32_below(MAX_CHAINLEN);
 
 	/* See if there's one in the list already, including reverse */
-	hlist_nulls_for_each_entry(h, n, &nf_conntrack_hash[hash], hnnode) {
+	hlist_nulls_for_each_entry(h, n, nf_ct_hash_slot(hash), hnnode) {
 		if (nf_ct_key_equal(h, &ct->tuplehash[IP_CT_DIR_ORIGINAL].tuple,
 				    zone, net))
 			goto out;
@@ -912,7 +984,7 @@ nf_conntrack_hash_check_insert(struct nf_conn *ct)
 
 	chainlen = 0;
 
-	hlist_nulls_for_each_entry(h, n, &nf_conntrack_hash[reply_hash], hnnode) {
+	hlist_nulls_for_each_entry(h, n, nf_ct_hash_slot(reply_hash), hnnode) {
 		if (nf_ct_key_equal(h, &ct->tuplehash[IP_CT_DIR_REPLY].tuple,
 				    zone, net))
 			goto out;
@@ -1054,7 +1126,7 @@ static int nf_ct_resolve_clash_harder(struct sk_buff *skb, u32 repl_idx)
 	/* Reply direction must never result in a clash, unless both origin
 	 * and reply tuples are identical.
 	 */
-	hlist_nulls_for_each_entry(h, n, &nf_conntrack_hash[repl_idx], hnnode) {
+	hlist_nulls_for_each_entry(h, n, nf_ct_hash_slot(repl_idx), hnnode) {
 		if (nf_ct_key_equal(h,
 				    &loser_ct->tuplehash[IP_CT_DIR_REPLY].tuple,
 				    zone, net))
@@ -1080,7 +1152,7 @@ static int nf_ct_resolve_clash_harder(struct sk_buff *skb, u32 repl_idx)
 	hlist_nulls_add_fake(&loser_ct->tuplehash[IP_CT_DIR_ORIGINAL].hnnode);
 
 	hlist_nulls_add_head_rcu(&loser_ct->tuplehash[IP_CT_DIR_REPLY].hnnode,
-				 &nf_conntrack_hash[repl_idx]);
+				 nf_ct_hash_slot(repl_idx));
 
 	NF_CT_STAT_INC(net, clash_resolve);
 	return NF_ACCEPT;
@@ -1228,7 +1300,7 @@ __nf_conntrack_confirm(struct sk_buff *skb)
 	/* See if there's one in the list already, including reverse:
 	   NAT could have grabbed it without realizing, since we're
 	   not in the hash.  If there is, we lost race. */
-	hlist_nulls_for_each_entry(h, n, &nf_conntrack_hash[hash], hnnode) {
+	hlist_nulls_for_each_entry(h, n, nf_ct_hash_slot(hash), hnnode) {
 		if (nf_ct_key_equal(h, &ct->tuplehash[IP_CT_DIR_ORIGINAL].tuple,
 				    zone, net))
 			goto out;
@@ -1237,7 +1309,7 @@ __nf_conntrack_confirm(struct sk_buff *skb)
 	}
 
 	chainlen = 0;
-	hlist_nulls_for_each_entry(h, n, &nf_conntrack_hash[reply_hash], hnnode) {
+	hlist_nulls_for_each_entry(h, n, nf_ct_hash_slot(reply_hash), hnnode) {
 		if (nf_ct_key_equal(h, &ct->tuplehash[IP_CT_DIR_REPLY].tuple,
 				    zone, net))
 			goto out;
@@ -1302,19 +1374,19 @@ nf_conntrack_tuple_taken(const struct nf_conntrack_tuple *tuple,
 	struct net *net = nf_ct_net(ignored_conntrack);
 	const struct nf_conntrack_zone *zone;
 	struct nf_conntrack_tuple_hash *h;
-	struct hlist_nulls_head *ct_hash;
-	unsigned int hash, hsize;
+	struct hlist_nulls_head *chain;
+	unsigned int hash, bucket, sequence;
 	struct hlist_nulls_node *n;
 	struct nf_conn *ct;
 
 	zone = nf_ct_zone(ignored_conntrack);
+	hash = hash_conntrack_raw(tuple, nf_ct_zone_id(zone, IP_CT_DIR_REPLY), net);
 
 	rcu_read_lock();
  begin:
-	nf_conntrack_get_ht(&ct_hash, &hsize);
-	hash = __hash_conntrack(net, tuple, nf_ct_zone_id(zone, IP_CT_DIR_REPLY), hsize);
+	chain = nf_conntrack_get_chain(hash, &bucket, &sequence);
 
-	hlist_nulls_for_each_entry_rcu(h, n, &ct_hash[hash], hnnode) {
+	hlist_nulls_for_each_entry_rcu(h, n, chain, hnnode) {
 		ct = nf_ct_tuplehash_to_ctrack(h);
 
 		if (ct == ignored_conntrack)
@@ -1349,11 +1421,14 @@ nf_conntrack_tuple_taken(const struct nf_conntrack_tuple *tuple,
 		}
 	}
 
-	if (get_nulls_value(n) != hash) {
+	if (get_nulls_value(n) != bucket) {
 		NF_CT_STAT_INC_ATOMIC(net, search_restart);
 		goto begin;
 	}
 
+	if (read_seqcount_retry(&nf_conntrack_generation, sequence))
+		goto begin;
+
 	rcu_read_unlock();
 
 	return 0;
@@ -1458,6 +1533,45 @@ static bool gc_worker_can_early_drop(const struct nf_conn *ct)
 	return false;
 }
 
+static void nf_conntrack_resize_worker(struct work_struct *work)
+{
+	unsigned int target = READ_ONCE(nf_conntrack_resize_target);
+
+	if (!conntrack_gc_work.exiting && target)
+		nf_conntrack_hash_resize(target);
+	WRITE_ONCE(nf_conntrack_resize_target, 0);
+}
+
+/*
+ * Called by gc after a full scan that found @entries hash entries (two
+ * per conntrack).  Aim for about one entry per bucket: double the table
+ * once chains average more than two entries, halve it (but not below
+ * the boot time size) once they average less than one eighth.
+ */
+static void nf_conntrack_hash_autoresize(unsigned int entries,
+					 unsigned int hashsz)
+{
+	unsigned int target;
+
+	if (!READ_ONCE(nf_conntrack_hash_auto) ||
+	    READ_ONCE(nf_conntrack_resize_target))
+		return;
+
+	if (entries > 2 * hashsz)
+		target = roundup_pow_of_two(entries);
+	else if (entries < hashsz / 8 && hashsz > nf_conntrack_htable_size_min)
+		target = max_t(unsigned int, roundup_pow_of_two(entries + 1),
+			       nf_conntrack_htable_size_min);
+	else
+		return;
+
+	if (target == hashsz)
+		return;
+
+	WRITE_ONCE(nf_conntrack_resize_target, target);
+	queue_work(system_unbound_wq, &nf_conntrack_resize_work);
+}
+
 static void gc_worker(struct work_struct *work)
 {
 	unsigned int i, hashsz, nf_conntrack_max95 = 0;
@@ -1478,6 +1592,8 @@ static void gc_worker(struct work_struct *work)
 		gc_work->avg_timeout = GC_SCAN_INTERVAL_INIT;
 		gc_work->count = GC_SCAN_INITIAL_COUNT;
 		gc_work->start_time = start_time;
+		gc_work->entries = 0;
+		gc_work->max_chainlen = 0;
 	}
 
 	next_run = gc_work->avg_timeout;
@@ -1489,6 +1605,7 @@ static void gc_worker(struct work_struct *work)
 		struct nf_conntrack_tuple_hash *h;
 		struct hlist_nulls_head *ct_hash;
 		struct hlist_nulls_node *n;
+		unsigned int chainlen = 0;
 		struct nf_conn *tmp;
 
 		rcu_read_lock();
@@ -1505,6 +1622,7 @@ static void gc_worker(struct work_struct *work)
 			long expires;
 
 			tmp = nf_ct_tuplehash_to_ctrack(h);
+			chainlen++;
 
 			if (test_bit(IPS_OFFLOAD_BIT, &tmp->status)) {
 				nf_ct_offload_timeout(tmp);
@@ -1569,6 +1687,8 @@ static void gc_worker(struct work_struct *work)
 		 * we will just continue with next hash slot.
 		 */
 		rcu_read_unlock();
+		gc_work->entries += chainlen;
+		gc_work->max_chainlen = max(gc_work->max_chainlen, chainlen);
 		cond_resched();
 		i++;
 
@@ -1584,6 +1704,9 @@ static void gc_worker(struct work_struct *work)
 
 	gc_work->next_bucket = 0;
 
+	WRITE_ONCE(nf_conntrack_hash_max_chain, gc_work->max_chainlen);
+	nf_conntrack_hash_autoresize(gc_work->entries, hashsz);
+
 	next_run = clamp(next_run, GC_SCAN_INTERVAL_MIN, GC_SCAN_INTERVAL_MAX);
 
 	delta_time = max_t(s32, nfct_time_stamp - gc_work->start_time, 1);
@@ -2514,6 +2637,7 @@ void nf_conntrack_cleanup_end(void)
 {
 	RCU_INIT_POINTER(nf_ct_hook, NULL);
 	cancel_delayed_work_sync(&conntrack_gc_work.dwork);
+	cancel_work_sync(&nf_conntrack_resize_work);
 	kvfree(nf_conntrack_hash);
 
 	nf_conntrack_proto_fini();
@@ -2590,63 +2714,124 @@ void *nf_ct_alloc_hashtable(unsigned int *sizep, int nulls)
 }
 EXPORT_SYMBOL_GPL(nf_ct_alloc_hashtable);
 
-int nf_conntrack_hash_resize(unsigned int hashsize)
+/* Old buckets moved per nf_conntrack_all_lock() section during a resize */
+#define NF_CT_RESIZE_BATCH	1024
+
+static void nf_conntrack_hash_switch(struct hlist_nulls_head *hash,
+				     unsigned int hashsize)
 {
-	int i, bucket;
-	unsigned int old_size;
-	struct hlist_nulls_head *hash, *old_hash;
-	struct nf_conntrack_tuple_hash *h;
-	struct nf_conn *ct;
+	local_bh_disable();
+	nf_conntrack_all_lock();
+	write_seqcount_begin(&nf_conntrack_generation);
 
-	if (!hashsize)
-		return -EINVAL;
+	nf_conntrack_hash_old = nf_conntrack_hash;
+	nf_conntrack_htable_size_old = nf_conntrack_htable_size;
+	nf_conntrack_resize_pos = 0;
+	nf_conntrack_hash = hash;
+	nf_conntrack_htable_size = hashsize;
 
-	hash = nf_ct_alloc_hashtable(&hashsize, 1);
-	if (!hash)
-		return -ENOMEM;
+	write_seqcount_end(&nf_conntrack_generation);
+	nf_conntrack_all_unlock();
+	local_bh_enable();
+}
 
-	mutex_lock(&nf_conntrack_mutex);
-	old_size = nf_conntrack_htable_size;
-	if (old_size == hashsize) {
-		mutex_unlock(&nf_conntrack_mutex);
-		kvfree(hash);
-		return 0;
-	}
+static void nf_conntrack_hash_move(unsigned int end)
+{
+	struct nf_conntrack_tuple_hash *h;
+	struct hlist_nulls_head *chain;
+	unsigned int i, bucket;
+	struct nf_conn *ct;
 
 	local_bh_disable();
 	nf_conntrack_all_lock();
 	write_seqcount_begin(&nf_conntrack_generation);
 
-	/* Lookups in the old hash might happen in parallel, which means we
-	 * might get false negatives during connection lookup. New connections
-	 * created because of a false negative won't make it into the hash
-	 * though since that required taking the locks.
-	 */
-
-	for (i = 0; i < nf_conntrack_htable_size; i++) {
-		while (!hlist_nulls_empty(&nf_conntrack_hash[i])) {
+	for (i = nf_conntrack_resize_pos; i < end; i++) {
+		chain = &nf_conntrack_hash_old[i];
+		while (!hlist_nulls_empty(chain)) {
 			unsigned int zone_id;
 
-			h = hlist_nulls_entry(nf_conntrack_hash[i].first,
+			h = hlist_nulls_entry(chain->first,
 					      struct nf_conntrack_tuple_hash, hnnode);
 			ct = nf_ct_tuplehash_to_ctrack(h);
 			hlist_nulls_del_rcu(&h->hnnode);
 
 			zone_id = nf_ct_zone_id(nf_ct_zone(ct), NF_CT_DIRECTION(h));
-			bucket = __hash_conntrack(nf_ct_net(ct),
-						  &h->tuple, zone_id, hashsize);
-			hlist_nulls_add_head_rcu(&h->hnnode, &hash[bucket]);
+			bucket = __hash_conntrack(nf_ct_net(ct), &h->tuple,
+						  zone_id, nf_conntrack_htable_size);
+			hlist_nulls_add_head_rcu(&h->hnnode,
+						 &nf_conntrack_hash[bucket]);
 		}
 	}
-	old_hash = nf_conntrack_hash;
+	nf_conntrack_resize_pos = end;
 
-	nf_conntrack_hash = hash;
-	nf_conntrack_htable_size = hashsize;
+	write_seqcount_end(&nf_conntrack_generation);
+	nf_conntrack_all_unlock();
+	local_bh_enable();
+}
+
+static struct hlist_nulls_head *nf_conntrack_hash_finish(void)
+{
+	struct hlist_nulls_head *old_hash;
+
+	local_bh_disable();
+	nf_conntrack_all_lock();
+	write_seqcount_begin(&nf_conntrack_generation);
+
+	old_hash = nf_conntrack_hash_old;
+	nf_conntrack_hash_old = NULL;
+	nf_conntrack_htable_size_old = 0;
+	nf_conntrack_resize_pos = 0;
 
 	write_seqcount_end(&nf_conntrack_generation);
 	nf_conntrack_all_unlock();
 	local_bh_enable();
 
+	return old_hash;
+}
+
+/*
+ * The new table is installed right away and the buckets of the old one
+ * are moved over NF_CT_RESIZE_BATCH at a time.  In between, lookups and
+ * inserts keep running against whichever table currently holds the
+ * bucket (see scale_hash()), so traffic is only held up for the duration
+ * of one batch instead of the whole rehash.
+ *
+ * Table walkers that must see every entry hold nf_conntrack_mutex and
+ * thus never run during a resize.  gc, ctnetlink dumps and /proc only
+ * look at nf_conntrack_hash and may miss entries not moved yet.
+ */
+int nf_conntrack_hash_resize(unsigned int hashsize)
+{
+	struct hlist_nulls_head *hash, *old_hash;
+	unsigned int pos, old_size;
+
+	if (!hashsize)
+		return -EINVAL;
+
+	hash = nf_ct_alloc_hashtable(&hashsize, 1);
+	if (!hash)
+		return -ENOMEM;
+
+	mutex_lock(&nf_conntrack_mutex);
+	old_size = nf_conntrack_htable_size;
+	if (old_size == hashsize) {
+		mutex_unlock(&nf_conntrack_mutex);
+		kvfree(hash);
+		return 0;
+	}
+
+	nf_conntrack_hash_switch(hash, hashsize);
+
+	for (pos = 0; pos < old_size; ) {
+		pos = min(pos + NF_CT_RESIZE_BATCH, old_size);
+		nf_conntrack_hash_move(pos);
+		cond_resched();
+	}
+
+	old_hash = nf_conntrack_hash_finish();
+	WRITE_ONCE(nf_conntrack_hash_resizes, nf_conntrack_hash_resizes + 1);
+
 	mutex_unlock(&nf_conntrack_mutex);
 
 	synchronize_net();
@@ -2711,6 +2896,7 @@ int nf_conntrack_init_start(void)
 	if (!nf_conntrack_hash)
 		return -ENOMEM;
 
+	nf_conntrack_htable_size_min = nf_conntrack_htable_size;
 	nf_conntrack_max = max_factor * nf_conntrack_htable_size;
 
 	nf_conntrack_cachep = kmem_cache_create("nf_conntrack",
@@ -2732,6 +2918,7 @@ int nf_conntrack_init_start(void)
 	if (ret < 0)
 		goto err_proto;
 
+	INIT_WORK(&nf_conntrack_resize_work, nf_conntrack_resize_worker);
 	conntrack_gc_work_init(&conntrack_gc_work);
 	queue_delayed_work(system_power_efficient_wq, &conntrack_gc_work.dwork, HZ);
 
@@ -2743,6 +2930,7 @@ int nf_conntrack_init_start(void)
 
 err_kfunc:
 	cancel_delayed_work_sync(&conntrack_gc_work.dwork);
+	cancel_work_sync(&nf_conntrack_resize_work);
 	nf_conntrack_proto_fini();
 err_proto:
 	nf_conntrack_helper_fini();
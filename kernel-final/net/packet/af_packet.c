@@ -553,16 +553,58 @@ static void prb_shutdown_retire_blk_timer(struct packet_sock *po,
 	prb_del_retire_blk_timer(pkc);
 }
 
-static void prb_setup_retire_blk_timer(struct packet_sock *po)
+static void prb_setup_retire_blk_timer(struct tpacket_kbdq_core *pkc)
 {
-	struct tpacket_kbdq_core *pkc;
-
-	pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
 	timer_setup(&pkc->retire_blk_timer, prb_retire_rx_blk_timer_expired,
 		    0);
 	pkc->retire_blk_timer.expires = jiffies;
 }
 
+static struct packet_rx_subring *prb_subring(struct tpacket_kbdq_core *pkc)
+{
+	if (!pkc->is_subring)
+		return NULL;
+	return container_of(pkc, struct packet_rx_subring, rb.prb_bdqc);
+}
+
+/* The socket owning @pkc, and the lock serialising its block queue */
+static struct packet_sock *prb_owner(struct tpacket_kbdq_core *pkc,
+				     spinlock_t **lock)
+{
+	struct packet_rx_subring *sub = prb_subring(pkc);
+	struct packet_sock *po;
+
+	if (sub) {
+		*lock = &sub->lock;
+		return sub->po;
+	}
+
+	po = container_of(pkc, struct packet_sock, rx_ring.prb_bdqc);
+	*lock = &po->sk.sk_receive_queue.lock;
+	return po;
+}
+
+/* Sub-ring filled by the current CPU */
+static struct packet_rx_subring *packet_rx_subring_cpu(const struct packet_sock *po)
+{
+	return &po->rx_subrings[raw_smp_processor_id() % po->rx_subring_nr];
+}
+
+static void packet_free_rx_subrings(struct packet_rx_subring *subs,
+				    unsigned int nr)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr; i++) {
+		spin_lock_bh(&subs[i].lock);
+		subs[i].rb.prb_bdqc.delete_blk_timer = 1;
+		spin_unlock_bh(&subs[i].lock);
+
+		prb_del_retire_blk_timer(&subs[i].rb.prb_bdqc);
+	}
+	kfree(subs);
+}
+
 static int prb_calc_retire_blk_tmo(struct packet_sock *po,
 				int blk_size_in_bytes)
 {
@@ -616,6 +658,7 @@ static void init_prb_bdqc(struct packet_sock *po,
 
 	memset(p1, 0x0, sizeof(*p1));
 
+	p1->is_subring = rb != &po->rx_ring;
 	p1->knxt_seq_num = 1;
 	p1->pkbdq = pg_vec;
 	pbd = (struct tpacket_block_desc *)pg_vec[0].buffer;
@@ -637,10 +680,51 @@ static void init_prb_bdqc(struct packet_sock *po,
 
 	p1->max_frame_len = p1->kblk_size - BLK_PLUS_PRIV(p1->blk_sizeof_priv);
 	prb_init_ft_ops(p1, req_u);
-	prb_setup_retire_blk_timer(po);
+	prb_setup_retire_blk_timer(p1);
 	prb_open_block(p1, pbd);
 }
 
+/* Split the blocks in @pg_vec evenly over po->rx_subring_req V3 rings */
+static struct packet_rx_subring *
+packet_alloc_rx_subrings(struct packet_sock *po, struct pgv *pg_vec,
+			 union tpacket_req_u *req_u)
+{
+	unsigned int i, nr = po->rx_subring_req;
+	struct tpacket_kbdq_core *pkc;
+	struct packet_rx_subring *subs;
+	union tpacket_req_u sub_req;
+
+	if (req_u->req3.tp_block_nr % nr)
+		return ERR_PTR(-EINVAL);
+
+	subs = kcalloc(nr, sizeof(*subs), GFP_KERNEL);
+	if (!subs)
+		return ERR_PTR(-ENOMEM);
+
+	sub_req = *req_u;
+	sub_req.req3.tp_block_nr /= nr;
+	if (!sub_req.req3.tp_retire_blk_tov)
+		sub_req.req3.tp_retire_blk_tov =
+			prb_calc_retire_blk_tmo(po, sub_req.req3.tp_block_size);
+
+	for (i = 0; i < nr; i++) {
+		spin_lock_init(&subs[i].lock);
+		subs[i].po = po;
+		subs[i].rb.pg_vec_len = sub_req.req3.tp_block_nr;
+		init_prb_bdqc(po, &subs[i].rb,
+			      pg_vec + i * sub_req.req3.tp_block_nr, &sub_req);
+	}
+
+	/* rx_ring itself is never filled, only keep what diag reports */
+	pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
+	memset(pkc, 0, sizeof(*pkc));
+	pkc->retire_blk_tov = subs[0].rb.prb_bdqc.retire_blk_tov;
+	pkc->blk_sizeof_priv = subs[0].rb.prb_bdqc.blk_sizeof_priv;
+	pkc->feature_req_word = subs[0].rb.prb_bdqc.feature_req_word;
+
+	return subs;
+}
+
 /*  Do NOT update the last_blk_num first.
  *  Assumes sk_buff_head lock is held.
  */
@@ -676,13 +760,14 @@ static void _prb_refresh_rx_retire_blk_timer(struct tpacket_kbdq_core *pkc)
  */
 static void prb_retire_rx_blk_timer_expired(struct timer_list *t)
 {
-	struct packet_sock *po =
-		from_timer(po, t, rx_ring.prb_bdqc.retire_blk_timer);
-	struct tpacket_kbdq_core *pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
-	unsigned int frozen;
+	struct tpacket_kbdq_core *pkc = from_timer(pkc, t, retire_blk_timer);
 	struct tpacket_block_desc *pbd;
+	struct packet_sock *po;
+	unsigned int frozen;
+	spinlock_t *lock;
 
-	spin_lock(&po->sk.sk_receive_queue.lock);
+	po = prb_owner(pkc, &lock);
+	spin_lock(lock);
 
 	frozen = prb_queue_frozen(pkc);
 	pbd = GET_CURR_PBLOCK_DESC_FROM_CORE(pkc);
@@ -744,7 +829,7 @@ refresh_timer:
 	_prb_refresh_rx_retire_blk_timer(pkc);
 
 out:
-	spin_unlock(&po->sk.sk_receive_queue.lock);
+	spin_unlock(lock);
 }
 
 static void prb_flush_block(struct tpacket_kbdq_core *pkc1,
@@ -907,8 +992,13 @@ static void prb_open_block(struct tpacket_kbdq_core *pkc1,
 static void prb_freeze_queue(struct tpacket_kbdq_core *pkc,
 				  struct packet_sock *po)
 {
+	struct packet_rx_subring *sub = prb_subring(pkc);
+
 	pkc->reset_pending_on_curr_blk = 1;
-	po->stats.stats3.tp_freeze_q_cnt++;
+	if (sub)
+		sub->freeze_q_cnt++;
+	else
+		po->stats.stats3.tp_freeze_q_cnt++;
 }
 
 #define TOTAL_PKT_LEN_INCL_ALIGN(length) (ALIGN((length), V3_ALIGNMENT))
@@ -1044,8 +1134,9 @@ static void prb_fill_curr_block(char *curr,
 	prb_run_all_ft_ops(pkc, ppd);
 }
 
-/* Assumes caller has the sk->rx_queue.lock */
+/* Assumes caller has the lock of @rb: sk->rx_queue.lock or its sub-ring's */
 static void *__packet_lookup_frame_in_block(struct packet_sock *po,
+					    struct packet_ring_buffer *rb,
 					    struct sk_buff *skb,
 					    unsigned int len
 					    )
@@ -1054,7 +1145,7 @@ static void *__packet_lookup_frame_in_block(struct packet_sock *po,
 	struct tpacket_block_desc *pbd;
 	char *curr, *end;
 
-	pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
+	pkc = GET_PBDQC_FROM_RB(rb);
 	pbd = GET_CURR_PBLOCK_DESC_FROM_CORE(pkc);
 
 	/* Queue is frozen when user space is lagging behind */
@@ -1107,6 +1198,7 @@ static void *__packet_lookup_frame_in_block(struct packet_sock *po,
 }
 
 static void *packet_current_rx_frame(struct packet_sock *po,
+					    struct packet_ring_buffer *rb,
 					    struct sk_buff *skb,
 					    int status, unsigned int len)
 {
@@ -1114,11 +1206,10 @@ static void *packet_current_rx_frame(struct packet_sock *po,
 	switch (po->tp_version) {
 	case TPACKET_V1:
 	case TPACKET_V2:
-		curr = packet_lookup_frame(po, &po->rx_ring,
-					po->rx_ring.head, status);
+		curr = packet_lookup_frame(po, rb, rb->head, status);
 		return curr;
 	case TPACKET_V3:
-		return __packet_lookup_frame_in_block(po, skb, len);
+		return __packet_lookup_frame_in_block(po, rb, skb, len);
 	default:
 		WARN(1, "TPACKET version not supported\n");
 		BUG();
@@ -1257,15 +1348,19 @@ static bool __tpacket_has_room(const struct packet_sock *po, int pow_off)
 
 static bool __tpacket_v3_has_room(const struct packet_sock *po, int pow_off)
 {
+	const struct packet_ring_buffer *rb = &po->rx_ring;
 	int idx, len;
 
-	len = READ_ONCE(po->rx_ring.prb_bdqc.knum_blocks);
-	idx = READ_ONCE(po->rx_ring.prb_bdqc.kactive_blk_num);
+	if (po->rx_subrings)
+		rb = &packet_rx_subring_cpu(po)->rb;
+
+	len = READ_ONCE(rb->prb_bdqc.knum_blocks);
+	idx = READ_ONCE(rb->prb_bdqc.kactive_blk_num);
 	if (pow_off)
 		idx += len >> pow_off;
 	if (idx >= len)
 		idx -= len;
-	return prb_lookup_block(po, &po->rx_ring, idx, TP_STATUS_KERNEL);
+	return prb_lookup_block(po, rb, idx, TP_STATUS_KERNEL);
 }
 
 static int __packet_rcv_has_room(const struct packet_sock *po,
@@ -2233,9 +2328,12 @@ drop:
 static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 		       struct packet_type *pt, struct net_device *orig_dev)
 {
+	struct packet_rx_subring *sub = NULL;
+	struct packet_ring_buffer *rb;
 	struct sock *sk;
 	struct packet_sock *po;
 	struct sockaddr_ll *sll;
+	spinlock_t *rx_lock;
 	union tpacket_uhdr h;
 	u8 *skb_head = skb->data;
 	int skb_len = skb->len;
@@ -2266,6 +2364,14 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 	if (!net_eq(dev_net(dev), sock_net(sk)))
 		goto drop;
 
+	rb = &po->rx_ring;
+	rx_lock = &sk->sk_receive_queue.lock;
+	if (po->rx_subrings) {
+		sub = packet_rx_subring_cpu(po);
+		rb = &sub->rb;
+		rx_lock = &sub->lock;
+	}
+
 	if (dev_has_header(dev)) {
 		if (sk->sk_type != SOCK_DGRAM)
 			skb_push(skb, skb->data - skb_mac_header(skb));
@@ -2338,21 +2444,21 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 			}
 		}
 	} else if (unlikely(macoff + snaplen >
-			    GET_PBDQC_FROM_RB(&po->rx_ring)->max_frame_len)) {
+			    GET_PBDQC_FROM_RB(rb)->max_frame_len)) {
 		u32 nval;
 
-		nval = GET_PBDQC_FROM_RB(&po->rx_ring)->max_frame_len - macoff;
+		nval = GET_PBDQC_FROM_RB(rb)->max_frame_len - macoff;
 		pr_err_once("tpacket_rcv: packet too big, clamped from %u to %u. macoff=%u\n",
 			    snaplen, nval, macoff);
 		snaplen = nval;
 		if (unlikely((int)snaplen < 0)) {
 			snaplen = 0;
-			macoff = GET_PBDQC_FROM_RB(&po->rx_ring)->max_frame_len;
+			macoff = GET_PBDQC_FROM_RB(rb)->max_frame_len;
 			vnet_hdr_sz = 0;
 		}
 	}
-	spin_lock(&sk->sk_receive_queue.lock);
-	h.raw = packet_current_rx_frame(po, skb,
+	spin_lock(rx_lock);
+	h.raw = packet_current_rx_frame(po, rb, skb,
 					TP_STATUS_KERNEL, (macoff+snaplen));
 	if (!h.raw)
 		goto drop_n_account;
@@ -2369,7 +2475,7 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 				    sizeof(struct virtio_net_hdr),
 				    vio_le(), true, 0)) {
 		if (po->tp_version == TPACKET_V3)
-			prb_clear_blk_fill_status(&po->rx_ring);
+			prb_clear_blk_fill_status(rb);
 		goto drop_n_account;
 	}
 
@@ -2385,13 +2491,16 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 			status |= TP_STATUS_LOSING;
 	}
 
-	po->stats.stats1.tp_packets++;
+	if (sub)
+		sub->packets++;
+	else
+		po->stats.stats1.tp_packets++;
 	if (copy_skb) {
 		status |= TP_STATUS_COPY;
 		skb_clear_delivery_time(copy_skb);
 		__skb_queue_tail(&sk->sk_receive_queue, copy_skb);
 	}
-	spin_unlock(&sk->sk_receive_queue.lock);
+	spin_unlock(rx_lock);
 
 	skb_copy_bits(skb, 0, h.raw + macoff, snaplen);
 
@@ -2485,7 +2594,7 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 		spin_unlock(&sk->sk_receive_queue.lock);
 		sk->sk_data_ready(sk);
 	} else if (po->tp_version == TPACKET_V3) {
-		prb_clear_blk_fill_status(&po->rx_ring);
+		prb_clear_blk_fill_status(rb);
 	}
 
 drop_n_restore:
@@ -2501,7 +2610,7 @@ drop:
 	return 0;
 
 drop_n_account:
-	spin_unlock(&sk->sk_receive_queue.lock);
+	spin_unlock(rx_lock);
 	atomic_inc(&po->tp_drops);
 	is_drop_n_account = true;
 
@@ -4024,6 +4133,27 @@ packet_setsockopt(struct socket *sock, int level, int optname, sockptr_t optval,
 		packet_sock_flag_set(po, PACKET_SOCK_QDISC_BYPASS, val);
 		return 0;
 	}
+	case PACKET_RX_SUBRINGS:
+	{
+		unsigned int val;
+
+		if (optlen != sizeof(val))
+			return -EINVAL;
+		if (copy_from_sockptr(&val, optval, sizeof(val)))
+			return -EFAULT;
+		if (val > nr_cpu_ids)
+			return -EINVAL;
+
+		lock_sock(sk);
+		if (po->rx_ring.pg_vec) {
+			ret = -EBUSY;
+		} else {
+			po->rx_subring_req = val;
+			ret = 0;
+		}
+		release_sock(sk);
+		return ret;
+	}
 	default:
 		return -ENOPROTOOPT;
 	}
@@ -4039,6 +4169,7 @@ static int packet_getsockopt(struct socket *sock, int level, int optname,
 	void *data = &val;
 	union tpacket_stats_u st;
 	struct tpacket_rollover_stats rstats;
+	unsigned int i;
 	int drops;
 
 	if (level != SOL_PACKET)
@@ -4055,6 +4186,16 @@ static int packet_getsockopt(struct socket *sock, int level, int optname,
 		spin_lock_bh(&sk->sk_receive_queue.lock);
 		memcpy(&st, &po->stats, sizeof(st));
 		memset(&po->stats, 0, sizeof(po->stats));
+		for (i = 0; i < po->rx_subring_nr; i++) {
+			struct packet_rx_subring *sub = &po->rx_subrings[i];
+
+			spin_lock(&sub->lock);
+			st.stats3.tp_packets += sub->packets;
+			st.stats3.tp_freeze_q_cnt += sub->freeze_q_cnt;
+			sub->packets = 0;
+			sub->freeze_q_cnt = 0;
+			spin_unlock(&sub->lock);
+		}
 		spin_unlock_bh(&sk->sk_receive_queue.lock);
 		drops = atomic_xchg(&po->tp_drops, 0);
 
@@ -4141,6 +4282,9 @@ static int packet_getsockopt(struct socket *sock, int level, int optname,
 	case PACKET_QDISC_BYPASS:
 		val = packet_sock_flag(po, PACKET_SOCK_QDISC_BYPASS);
 		break;
+	case PACKET_RX_SUBRINGS:
+		val = po->rx_subring_req;
+		break;
 	default:
 		return -ENOPROTOOPT;
 	}
@@ -4253,6 +4397,25 @@ static int packet_ioctl(struct socket *sock, unsigned int cmd,
 	return 0;
 }
 
+/* Any sub-ring with a block handed to user space?  Called with
+ * sk_receive_queue.lock held, which nests outside the sub-ring locks.
+ */
+static bool packet_rx_subrings_ready(struct packet_sock *po)
+{
+	struct packet_rx_subring *sub;
+	bool ready = false;
+	unsigned int i;
+
+	for (i = 0; i < po->rx_subring_nr && !ready; i++) {
+		sub = &po->rx_subrings[i];
+		spin_lock(&sub->lock);
+		ready = !__prb_previous_block(po, &sub->rb, TP_STATUS_KERNEL);
+		spin_unlock(&sub->lock);
+	}
+
+	return ready;
+}
+
 static __poll_t packet_poll(struct file *file, struct socket *sock,
 				poll_table *wait)
 {
@@ -4261,7 +4424,10 @@ static __poll_t packet_poll(struct file *file, struct socket *sock,
 	__poll_t mask = datagram_poll(file, sock, wait);
 
 	spin_lock_bh(&sk->sk_receive_queue.lock);
-	if (po->rx_ring.pg_vec) {
+	if (po->rx_subrings) {
+		if (packet_rx_subrings_ready(po))
+			mask |= EPOLLIN | EPOLLRDNORM;
+	} else if (po->rx_ring.pg_vec) {
 		if (!packet_previous_rx_frame(po, &po->rx_ring,
 			TP_STATUS_KERNEL))
 			mask |= EPOLLIN | EPOLLRDNORM;
@@ -4380,6 +4546,8 @@ static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 {
 	struct pgv *pg_vec = NULL;
 	struct packet_sock *po = pkt_sk(sk);
+	struct packet_rx_subring *rx_subrings = NULL;
+	unsigned int rx_subring_nr = 0;
 	unsigned long *rx_owner_map = NULL;
 	int was_running, order = 0;
 	struct packet_ring_buffer *rb;
@@ -4423,6 +4591,9 @@ static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 		err = -EINVAL;
 		if (unlikely((int)req->tp_block_size <= 0))
 			goto out;
+		if (!tx_ring && po->rx_subring_req &&
+		    po->tp_version != TPACKET_V3)
+			goto out;
 		if (unlikely(!PAGE_ALIGNED(req->tp_block_size)))
 			goto out;
 		min_frame_size = po->tp_hdrlen + po->tp_reserve;
@@ -4452,7 +4623,16 @@ static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 		switch (po->tp_version) {
 		case TPACKET_V3:
 			/* Block transmit is not supported yet */
-			if (!tx_ring) {
+			if (!tx_ring && po->rx_subring_req) {
+				rx_subrings = packet_alloc_rx_subrings(po, pg_vec,
+								       req_u);
+				if (IS_ERR(rx_subrings)) {
+					err = PTR_ERR(rx_subrings);
+					rx_subrings = NULL;
+					goto out_free_pg_vec;
+				}
+				rx_subring_nr = po->rx_subring_req;
+			} else if (!tx_ring) {
 				init_prb_bdqc(po, rb, pg_vec, req_u);
 			} else {
 				struct tpacket_req3 *req3 = &req_u->req3;
@@ -4503,6 +4683,10 @@ static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 		swap(rb->pg_vec, pg_vec);
 		if (po->tp_version <= TPACKET_V2)
 			swap(rb->rx_owner_map, rx_owner_map);
+		if (!tx_ring) {
+			swap(po->rx_subrings, rx_subrings);
+			swap(po->rx_subring_nr, rx_subring_nr);
+		}
 		rb->frame_max = (req->tp_frame_nr - 1);
 		rb->head = 0;
 		rb->frame_size = req->tp_frame_size;
@@ -4529,7 +4713,9 @@ static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 	spin_unlock(&po->bind_lock);
 	if (pg_vec && (po->tp_version > TPACKET_V2)) {
 		/* Because we don't support block-based V3 on tx-ring */
-		if (!tx_ring)
+		if (rx_subrings)
+			packet_free_rx_subrings(rx_subrings, rx_subring_nr);
+		else if (!tx_ring)
 			prb_shutdown_retire_blk_timer(po, rb_queue);
 	}
 
@@ -20,6 +20,7 @@ struct tpacket_kbdq_core {
 	unsigned int	hdrlen;
 	unsigned char	reset_pending_on_curr_blk;
 	unsigned char   delete_blk_timer;
+	unsigned char	is_subring;
 	unsigned short	kactive_blk_num;
 	unsigned short	blk_sizeof_priv;
 
@@ -76,6 +77,20 @@ struct packet_ring_buffer {
 	};
 };
 
+struct packet_sock;
+
+/* One of the PACKET_RX_SUBRINGS slices of a TPACKET_V3 rx_ring.  Each
+ * sub-ring owns a contiguous run of blocks and is filled only by the
+ * CPUs mapping to it, under its own lock instead of sk_receive_queue's.
+ */
+struct packet_rx_subring {
+	struct packet_ring_buffer	rb;
+	spinlock_t			lock;
+	struct packet_sock		*po;
+	unsigned int			packets;
+	unsigned int			freeze_q_cnt;
+} ____cacheline_aligned_in_smp;
+
 extern struct mutex fanout_mutex;
 #define PACKET_FANOUT_MAX	(1 << 16)
 
@@ -113,6 +128,9 @@ struct packet_sock {
 	union  tpacket_stats_u	stats;
 	struct packet_ring_buffer	rx_ring;
 	struct packet_ring_buffer	tx_ring;
+	struct packet_rx_subring	*rx_subrings;
+	unsigned int		rx_subring_nr;
+	unsigned int		rx_subring_req;
 	int			copy_thresh;
 	spinlock_t		bind_lock;
 	struct mutex		pg_vec_lock;
@@ -1154,8 +1154,12 @@ skip:
 		unsigned long cl;
 		int err;
 
-		/* Only support running class lockless if parent is lockless */
-		if (new && (new->flags & TCQ_F_NOLOCK) && !(parent->flags & TCQ_F_NOLOCK))
+		/* Only support running class lockless if parent is lockless,
+		 * or if it is a multiqueue root: its classes are attached to
+		 * their own tx queue and run on their own.
+		 */
+		if (new && (new->flags & TCQ_F_NOLOCK) &&
+		    !(parent->flags & (TCQ_F_NOLOCK | TCQ_F_MQROOT)))
 			qdisc_clear_nolock(new);
 
 		if (!cops || !cops->graft)
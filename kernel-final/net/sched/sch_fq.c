@@ -28,6 +28,14 @@
  *  Note : When a flow becomes empty, we do not immediately remove it from
  *  rb trees, for performance reasons (its expected to send additional packets,
  *  or SLAB cache will reuse socket for another flow)
+ *
+ *  Per-CPU enqueue (TCA_FQ_PCPU_ENQUEUE) : the qdisc runs as TCQ_F_NOLOCK.
+ *  enqueue() only timestamps the packet and pushes it on a per-CPU lockless
+ *  list; dequeue(), serialized by the qdisc seqlock, first moves these
+ *  packets into the flow queues, one cpu at a time in FIFO order. Packets
+ *  keep the timestamp taken at enqueue time, so pacing is unchanged. Staged
+ *  packets count against the limit through a per-CPU counter, which may
+ *  overshoot it by up to FQ_STAGE_BATCH packets per cpu.
  */
 
 #include <linux/module.h>
@@ -44,6 +52,9 @@
 #include <linux/hash.h>
 #include <linux/prefetch.h>
 #include <linux/vmalloc.h>
+#include <linux/llist.h>
+#include <linux/percpu.h>
+#include <linux/percpu_counter.h>
 #include <net/netlink.h>
 #include <net/pkt_sched.h>
 #include <net/sock.h>
@@ -93,6 +104,12 @@ struct fq_flow_head {
 	struct fq_flow *last;
 };
 
+/* Packets enqueued on one cpu, not yet seen by dequeue() */
+struct fq_stage {
+	struct llist_head	head;
+	atomic_t		drops;
+} ____cacheline_aligned_in_smp;
+
 struct fq_sched_data {
 	struct fq_flow_head new_flows;
 
@@ -133,8 +150,15 @@ struct fq_sched_data {
 
 	u32		timer_slack; /* hrtimer slack in ns */
 	struct qdisc_watchdog watchdog;
+
+	struct fq_stage __percpu *stage;	/* for TCA_FQ_PCPU_ENQUEUE */
+	cpumask_var_t	stage_mask;		/* cpus with staged packets */
+	struct percpu_counter stage_len;	/* staged packets, all cpus */
 };
 
+/* Per-cpu slack of fq_sched_data.stage_len */
+#define FQ_STAGE_BATCH	32
+
 /*
  * f->tail and f->age share the same location.
  * We can use the low order bit to differentiate if this location points
@@ -439,8 +463,9 @@ static bool fq_packet_beyond_horizon(const struct sk_buff *skb,
 	return unlikely((s64)skb->tstamp > (s64)(q->ktime_cache + q->horizon));
 }
 
-static int fq_enqueue(struct sk_buff *skb, struct Qdisc *sch,
-		      struct sk_buff **to_free)
+/* Caller set fq_skb_cb(skb)->time_to_send if the skb has no EDT */
+static int __fq_enqueue(struct sk_buff *skb, struct Qdisc *sch,
+			struct sk_buff **to_free)
 {
 	struct fq_sched_data *q = qdisc_priv(sch);
 	struct fq_flow *f;
@@ -448,9 +473,7 @@ static int fq_enqueue(struct sk_buff *skb, struct Qdisc *sch,
 	if (unlikely(sch->q.qlen >= sch->limit))
 		return qdisc_drop(skb, sch, to_free);
 
-	if (!skb->tstamp) {
-		fq_skb_cb(skb)->time_to_send = q->ktime_cache = ktime_get_ns();
-	} else {
+	if (skb->tstamp) {
 		/* Check if packet timestamp is too far in the future.
 		 * Try first if our cached value, to avoid ktime_get_ns()
 		 * cost in most cases.
@@ -496,6 +519,87 @@ static int fq_enqueue(struct sk_buff *skb, struct Qdisc *sch,
 	return NET_XMIT_SUCCESS;
 }
 
+/* Lockless enqueue: sch->q.qlen only moves under the seqlock, so the limit
+ * is checked against it plus what all cpus staged since the last dequeue.
+ * Nothing here writes to a cache line shared with other cpus, except for
+ * the stage_len fold every FQ_STAGE_BATCH packets and the stage_mask bit
+ * when this cpu's list was empty.
+ */
+static int fq_stage_enqueue(struct sk_buff *skb, struct Qdisc *sch,
+			    struct sk_buff **to_free)
+{
+	struct fq_sched_data *q = qdisc_priv(sch);
+	int cpu = raw_smp_processor_id();
+	struct fq_stage *st = per_cpu_ptr(q->stage, cpu);
+
+	if (unlikely(percpu_counter_read(&q->stage_len) +
+		     READ_ONCE(sch->q.qlen) >= sch->limit)) {
+		atomic_inc(&st->drops);
+		__qdisc_drop(skb, to_free);
+		return NET_XMIT_DROP;
+	}
+	percpu_counter_add_batch(&q->stage_len, 1, FQ_STAGE_BATCH);
+
+	if (!skb->tstamp)
+		fq_skb_cb(skb)->time_to_send = ktime_get_ns();
+
+	/* Ordered after llist_add(), pairs with fq_stage_merge() */
+	if (llist_add(&skb->ll_node, &st->head))
+		cpumask_set_cpu(cpu, q->stage_mask);
+
+	return NET_XMIT_SUCCESS;
+}
+
+static int fq_enqueue(struct sk_buff *skb, struct Qdisc *sch,
+		      struct sk_buff **to_free)
+{
+	struct fq_sched_data *q = qdisc_priv(sch);
+
+	if (sch->flags & TCQ_F_NOLOCK)
+		return fq_stage_enqueue(skb, sch, to_free);
+
+	if (!skb->tstamp)
+		fq_skb_cb(skb)->time_to_send = q->ktime_cache = ktime_get_ns();
+
+	return __fq_enqueue(skb, sch, to_free);
+}
+
+/* Move staged packets into the flow queues. Each cpu's packets go in in
+ * the order they were enqueued, and packets of one flow staged on different
+ * cpus are put back in order by their time_to_send.
+ */
+static void fq_stage_merge(struct Qdisc *sch)
+{
+	struct fq_sched_data *q = qdisc_priv(sch);
+	struct sk_buff *skb, *next, *to_free = NULL;
+	struct llist_node *node;
+	struct fq_stage *st;
+	int cpu, cnt;
+
+	for_each_cpu(cpu, q->stage_mask) {
+		st = per_cpu_ptr(q->stage, cpu);
+
+		cpumask_clear_cpu(cpu, q->stage_mask);
+		/* llist_del_all() is fully ordered after the clear */
+		node = llist_del_all(&st->head);
+		if (unlikely(atomic_read(&st->drops)))
+			sch->qstats.drops += atomic_xchg(&st->drops, 0);
+		if (!node)
+			continue;
+
+		cnt = 0;
+		node = llist_reverse_order(node);
+		llist_for_each_entry_safe(skb, next, node, ll_node) {
+			__fq_enqueue(skb, sch, &to_free);
+			cnt++;
+		}
+		percpu_counter_add_batch(&q->stage_len, -cnt, FQ_STAGE_BATCH);
+	}
+
+	if (unlikely(to_free))
+		kfree_skb_list_reason(to_free, SKB_DROP_REASON_QDISC_DROP);
+}
+
 static void fq_check_throttled(struct fq_sched_data *q, u64 now)
 {
 	unsigned long sample;
@@ -523,7 +627,7 @@ static void fq_check_throttled(struct fq_sched_data *q, u64 now)
 	}
 }
 
-static struct sk_buff *fq_dequeue(struct Qdisc *sch)
+static struct sk_buff *__fq_dequeue(struct Qdisc *sch)
 {
 	struct fq_sched_data *q = qdisc_priv(sch);
 	struct fq_flow_head *head;
@@ -643,6 +747,35 @@ out:
 	return skb;
 }
 
+static struct sk_buff *fq_dequeue(struct Qdisc *sch)
+{
+	bool need_retry = true;
+	struct sk_buff *skb;
+
+	if (!(sch->flags & TCQ_F_NOLOCK))
+		return __fq_dequeue(sch);
+retry:
+	fq_stage_merge(sch);
+	skb = __fq_dequeue(sch);
+	if (!skb && need_retry) {
+		/* As in pfifo_fast_dequeue(): nothing to send (or all flows
+		 * throttled, the watchdog will reschedule us), so stop
+		 * qdisc_run_end() from rescheduling, then look again for
+		 * packets staged by whoever set STATE_MISSED.
+		 */
+		clear_bit(__QDISC_STATE_MISSED, &sch->state);
+		clear_bit(__QDISC_STATE_DRAINING, &sch->state);
+
+		/* Make sure dequeuing happens after clearing STATE_MISSED */
+		smp_mb__after_atomic();
+
+		need_retry = false;
+		goto retry;
+	}
+
+	return skb;
+}
+
 static void fq_flow_purge(struct fq_flow *flow)
 {
 	struct rb_node *p = rb_first(&flow->t_root);
@@ -659,6 +792,25 @@ static void fq_flow_purge(struct fq_flow *flow)
 	flow->qlen = 0;
 }
 
+static void fq_stage_purge(struct fq_sched_data *q)
+{
+	struct sk_buff *skb, *next;
+	struct llist_node *node;
+	struct fq_stage *st;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		st = per_cpu_ptr(q->stage, cpu);
+
+		node = llist_del_all(&st->head);
+		llist_for_each_entry_safe(skb, next, node, ll_node)
+			rtnl_kfree_skbs(skb, skb);
+		atomic_set(&st->drops, 0);
+	}
+	cpumask_clear(q->stage_mask);
+	percpu_counter_set(&q->stage_len, 0);
+}
+
 static void fq_reset(struct Qdisc *sch)
 {
 	struct fq_sched_data *q = qdisc_priv(sch);
@@ -670,6 +822,9 @@ static void fq_reset(struct Qdisc *sch)
 	sch->q.qlen = 0;
 	sch->qstats.backlog = 0;
 
+	if (q->stage)
+		fq_stage_purge(q);
+
 	fq_flow_purge(&q->internal);
 
 	if (!q->fq_root)
@@ -744,6 +899,23 @@ static void fq_free(void *addr)
 	kvfree(addr);
 }
 
+/* Lockless qdiscs dequeue under sch->seqlock rather than the qdisc lock,
+ * hold both to change the flow state. Same order as dev_reset_queue().
+ */
+static void fq_tree_lock(struct Qdisc *sch)
+{
+	if (sch->flags & TCQ_F_NOLOCK)
+		spin_lock_bh(&sch->seqlock);
+	sch_tree_lock(sch);
+}
+
+static void fq_tree_unlock(struct Qdisc *sch)
+{
+	sch_tree_unlock(sch);
+	if (sch->flags & TCQ_F_NOLOCK)
+		spin_unlock_bh(&sch->seqlock);
+}
+
 static int fq_resize(struct Qdisc *sch, u32 log)
 {
 	struct fq_sched_data *q = qdisc_priv(sch);
@@ -763,7 +935,7 @@ static int fq_resize(struct Qdisc *sch, u32 log)
 	for (idx = 0; idx < (1U << log); idx++)
 		array[idx] = RB_ROOT;
 
-	sch_tree_lock(sch);
+	fq_tree_lock(sch);
 
 	old_fq_root = q->fq_root;
 	if (old_fq_root)
@@ -772,7 +944,7 @@ static int fq_resize(struct Qdisc *sch, u32 log)
 	q->fq_root = array;
 	q->fq_trees_log = log;
 
-	sch_tree_unlock(sch);
+	fq_tree_unlock(sch);
 
 	fq_free(old_fq_root);
 
@@ -801,8 +973,58 @@ static const struct nla_policy fq_policy[TCA_FQ_MAX + 1] = {
 	[TCA_FQ_TIMER_SLACK]		= { .type = NLA_U32 },
 	[TCA_FQ_HORIZON]		= { .type = NLA_U32 },
 	[TCA_FQ_HORIZON_DROP]		= { .type = NLA_U8 },
+	[TCA_FQ_PCPU_ENQUEUE]		= { .type = NLA_U8 },
 };
 
+/* Enqueue goes lockless once the qdisc is attached, so this can only be
+ * chosen before the first fq_resize() in fq_init().
+ */
+static int fq_set_pcpu_enqueue(struct Qdisc *sch, bool enable,
+			       struct netlink_ext_ack *extack)
+{
+	struct fq_sched_data *q = qdisc_priv(sch);
+	int cpu;
+
+	if (enable == !!q->stage)
+		return 0;
+
+	if (q->fq_root) {
+		NL_SET_ERR_MSG_MOD(extack,
+				   "per-CPU enqueue can only be set at creation");
+		return -EINVAL;
+	}
+
+	if (!enable) {
+		percpu_counter_destroy(&q->stage_len);
+		free_percpu(q->stage);
+		free_cpumask_var(q->stage_mask);
+		q->stage = NULL;
+		sch->flags &= ~TCQ_F_NOLOCK;
+		return 0;
+	}
+
+	if (!zalloc_cpumask_var(&q->stage_mask, GFP_KERNEL))
+		return -ENOMEM;
+
+	if (percpu_counter_init(&q->stage_len, 0, GFP_KERNEL)) {
+		free_cpumask_var(q->stage_mask);
+		return -ENOMEM;
+	}
+
+	q->stage = alloc_percpu(struct fq_stage);
+	if (!q->stage) {
+		percpu_counter_destroy(&q->stage_len);
+		free_cpumask_var(q->stage_mask);
+		return -ENOMEM;
+	}
+
+	for_each_possible_cpu(cpu)
+		init_llist_head(&per_cpu_ptr(q->stage, cpu)->head);
+
+	sch->flags |= TCQ_F_NOLOCK;
+	return 0;
+}
+
 static int fq_change(struct Qdisc *sch, struct nlattr *opt,
 		     struct netlink_ext_ack *extack)
 {
@@ -817,7 +1039,15 @@ static int fq_change(struct Qdisc *sch, struct nlattr *opt,
 	if (err < 0)
 		return err;
 
-	sch_tree_lock(sch);
+	if (tb[TCA_FQ_PCPU_ENQUEUE]) {
+		err = fq_set_pcpu_enqueue(sch,
+					  nla_get_u8(tb[TCA_FQ_PCPU_ENQUEUE]),
+					  extack);
+		if (err)
+			return err;
+	}
+
+	fq_tree_lock(sch);
 
 	fq_log = q->fq_trees_log;
 
@@ -896,9 +1126,9 @@ static int fq_change(struct Qdisc *sch, struct nlattr *opt,
 
 	if (!err) {
 
-		sch_tree_unlock(sch);
+		fq_tree_unlock(sch);
 		err = fq_resize(sch, fq_log);
-		sch_tree_lock(sch);
+		fq_tree_lock(sch);
 	}
 	while (sch->q.qlen > sch->limit) {
 		struct sk_buff *skb = fq_dequeue(sch);
@@ -911,7 +1141,7 @@ static int fq_change(struct Qdisc *sch, struct nlattr *opt,
 	}
 	qdisc_tree_reduce_backlog(sch, drop_count, drop_len);
 
-	sch_tree_unlock(sch);
+	fq_tree_unlock(sch);
 	return err;
 }
 
@@ -922,6 +1152,11 @@ static void fq_destroy(struct Qdisc *sch)
 	fq_reset(sch);
 	fq_free(q->fq_root);
 	qdisc_watchdog_cancel(&q->watchdog);
+	if (q->stage) {
+		percpu_counter_destroy(&q->stage_len);
+		free_percpu(q->stage);
+		free_cpumask_var(q->stage_mask);
+	}
 }
 
 static int fq_init(struct Qdisc *sch, struct nlattr *opt,
@@ -996,7 +1231,9 @@ static int fq_dump(struct Qdisc *sch, struct sk_buff *skb)
 	    nla_put_u32(skb, TCA_FQ_BUCKETS_LOG, q->fq_trees_log) ||
 	    nla_put_u32(skb, TCA_FQ_TIMER_SLACK, q->timer_slack) ||
 	    nla_put_u32(skb, TCA_FQ_HORIZON, (u32)horizon) ||
-	    nla_put_u8(skb, TCA_FQ_HORIZON_DROP, q->horizon_drop))
+	    nla_put_u8(skb, TCA_FQ_HORIZON_DROP, q->horizon_drop) ||
+	    nla_put_u8(skb, TCA_FQ_PCPU_ENQUEUE,
+		       !!(sch->flags & TCQ_F_NOLOCK)))
 		goto nla_put_failure;
 
 	return nla_nest_end(skb, opts);
@@ -1010,7 +1247,7 @@ static int fq_dump_stats(struct Qdisc *sch, struct gnet_dump *d)
 	struct fq_sched_data *q = qdisc_priv(sch);
 	struct tc_fq_qd_stats st;
 
-	sch_tree_lock(sch);
+	fq_tree_lock(sch);
 
 	st.gc_flows		  = q->stat_gc_flows;
 	st.highprio_packets	  = q->stat_internal_packets;
@@ -1029,7 +1266,7 @@ static int fq_dump_stats(struct Qdisc *sch, struct gnet_dump *d)
 	st.ce_mark		  = q->stat_ce_mark;
 	st.horizon_drops	  = q->stat_horizon_drops;
 	st.horizon_caps		  = q->stat_horizon_caps;
-	sch_tree_unlock(sch);
+	fq_tree_unlock(sch);
 
 	return gnet_stats_copy_app(d, &st, sizeof(st));
 }
@@ -613,6 +613,26 @@ static int do_tls_getsockopt_no_pad(struct sock *sk, char __user *optval,
 	return 0;
 }
 
+static int do_tls_getsockopt_tx_parallel(struct sock *sk, char __user *optval,
+					 int __user *optlen)
+{
+	struct tls_context *ctx = tls_get_ctx(sk);
+	unsigned int value;
+	int len;
+
+	if (get_user(len, optlen))
+		return -EFAULT;
+
+	if (len != sizeof(value))
+		return -EINVAL;
+
+	value = ctx->tx_parallel;
+	if (copy_to_user(optval, &value, sizeof(value)))
+		return -EFAULT;
+
+	return 0;
+}
+
 static int do_tls_getsockopt(struct sock *sk, int optname,
 			     char __user *optval, int __user *optlen)
 {
@@ -632,6 +652,9 @@ static int do_tls_getsockopt(struct sock *sk, int optname,
 	case TLS_RX_EXPECT_NO_PAD:
 		rc = do_tls_getsockopt_no_pad(sk, optval, optlen);
 		break;
+	case TLS_TX_PARALLEL:
+		rc = do_tls_getsockopt_tx_parallel(sk, optval, optlen);
+		break;
 	default:
 		rc = -ENOPROTOOPT;
 		break;
@@ -856,6 +879,30 @@ static int do_tls_setsockopt_no_pad(struct sock *sk, sockptr_t optval,
 	return rc;
 }
 
+static int do_tls_setsockopt_tx_parallel(struct sock *sk, sockptr_t optval,
+					 unsigned int optlen)
+{
+	struct tls_context *ctx = tls_get_ctx(sk);
+	unsigned int value;
+
+	if (sockptr_is_null(optval) || optlen != sizeof(value))
+		return -EINVAL;
+
+	if (copy_from_sockptr(&value, optval, sizeof(value)))
+		return -EFAULT;
+
+	if (value > 1)
+		return -EINVAL;
+
+	/* Picks the TX cipher instance, so it has to come before TLS_TX */
+	if (ctx->tx_conf != TLS_BASE)
+		return -EBUSY;
+
+	ctx->tx_parallel = value;
+
+	return 0;
+}
+
 static int do_tls_setsockopt(struct sock *sk, int optname, sockptr_t optval,
 			     unsigned int optlen)
 {
@@ -877,6 +924,11 @@ static int do_tls_setsockopt(struct sock *sk, int optname, sockptr_t optval,
 	case TLS_RX_EXPECT_NO_PAD:
 		rc = do_tls_setsockopt_no_pad(sk, optval, optlen);
 		break;
+	case TLS_TX_PARALLEL:
+		lock_sock(sk);
+		rc = do_tls_setsockopt_tx_parallel(sk, optval, optlen);
+		release_sock(sk);
+		break;
 	default:
 		rc = -ENOPROTOOPT;
 		break;
@@ -1139,6 +1191,23 @@ static int tls_get_info(const struct sock *sk, struct sk_buff *skb)
 		if (err)
 			goto nla_failure;
 	}
+	if (ctx->tx_conf == TLS_SW && ctx->tx_parallel) {
+		err = nla_put_flag(skb, TLS_INFO_TX_PARALLEL);
+		if (err)
+			goto nla_failure;
+	}
+	if (ctx->rx_conf == TLS_SW || ctx->rx_conf == TLS_HW) {
+		err = nla_put_u64_64bit(skb, TLS_INFO_RX_ZC_DECRYPTS,
+					READ_ONCE(ctx->rx_zc_decrypts),
+					TLS_INFO_PAD);
+		if (err)
+			goto nla_failure;
+		err = nla_put_u64_64bit(skb, TLS_INFO_RX_COPY_DECRYPTS,
+					READ_ONCE(ctx->rx_copy_decrypts),
+					TLS_INFO_PAD);
+		if (err)
+			goto nla_failure;
+	}
 
 	rcu_read_unlock();
 	nla_nest_end(skb, start);
@@ -1161,6 +1230,9 @@ static size_t tls_get_info_size(const struct sock *sk)
 		nla_total_size(sizeof(u16)) +	/* TLS_INFO_TXCONF */
 		nla_total_size(0) +		/* TLS_INFO_ZC_RO_TX */
 		nla_total_size(0) +		/* TLS_INFO_RX_NO_PAD */
+		nla_total_size(0) +		/* TLS_INFO_TX_PARALLEL */
+		nla_total_size_64bit(sizeof(u64)) + /* TLS_INFO_RX_ZC_DECRYPTS */
+		nla_total_size_64bit(sizeof(u64)) + /* TLS_INFO_RX_COPY_DECRYPTS */
 		0;
 
 	return size;
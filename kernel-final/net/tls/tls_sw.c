@@ -490,9 +490,12 @@ static void tls_encrypt_done(void *data, int err)
 	if (!ready)
 		return;
 
-	/* Schedule the transmission */
+	/* Schedule the transmission.  Parallel encryption completes records
+	 * off the sending thread by design, push them out without delay.
+	 */
 	if (!test_and_set_bit(BIT_TX_SCHEDULED, &ctx->tx_bitmask))
-		schedule_delayed_work(&ctx->tx_work.work, 1);
+		schedule_delayed_work(&ctx->tx_work.work,
+				      tls_ctx->tx_parallel ? 0 : 1);
 }
 
 static int tls_do_encryption(struct sock *sk,
@@ -1723,6 +1726,13 @@ static int tls_rx_one_record(struct sock *sk, struct msghdr *msg,
 	if (err < 0)
 		return err;
 
+	if (darg->zc)
+		WRITE_ONCE(tls_ctx->rx_zc_decrypts,
+			   tls_ctx->rx_zc_decrypts + 1);
+	else
+		WRITE_ONCE(tls_ctx->rx_copy_decrypts,
+			   tls_ctx->rx_copy_decrypts + 1);
+
 	rxm = strp_msg(darg->skb);
 	rxm->offset += prot->prepend_size;
 	rxm->full_len -= prot->overhead_size;
@@ -2499,6 +2509,27 @@ void tls_update_rx_zc_capable(struct tls_context *tls_ctx)
 		tls_ctx->prot_info.version != TLS_1_3_VERSION;
 }
 
+/* Wrap @cipher_name in pcrypt, which spreads requests of one tfm over
+ * the padata parallel CPUs and completes them in submission order.
+ * Records still go out in tx_list order, so the ordering only keeps
+ * the completions from waking the tx worker out of turn.
+ */
+static struct crypto_aead *tls_alloc_parallel_aead(const char *cipher_name)
+{
+	char name[CRYPTO_MAX_ALG_NAME];
+	struct crypto_aead *aead;
+
+	if (snprintf(name, sizeof(name), "pcrypt(%s)", cipher_name) >=
+	    sizeof(name))
+		return NULL;
+
+	aead = crypto_alloc_aead(name, 0, 0);
+	if (IS_ERR(aead))
+		return NULL;
+
+	return aead;
+}
+
 int tls_set_sw_offload(struct sock *sk, struct tls_context *ctx, int tx)
 {
 	struct tls_context *tls_ctx = tls_get_ctx(sk);
@@ -2747,6 +2778,14 @@ int tls_set_sw_offload(struct sock *sk, struct tls_context *ctx, int tx)
 		goto free_iv;
 	}
 
+	if (!*aead && sw_ctx_tx && ctx->tx_parallel) {
+		*aead = tls_alloc_parallel_aead(cipher_name);
+		if (*aead)
+			sw_ctx_tx->async_capable = 1;
+		else
+			ctx->tx_parallel = 0;
+	}
+
 	if (!*aead) {
 		*aead = crypto_alloc_aead(cipher_name, 0, 0);
 		if (IS_ERR(*aead)) {
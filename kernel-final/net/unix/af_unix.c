@@ -2104,6 +2104,13 @@ out:
  */
 #define UNIX_SKB_FRAGS_SZ (PAGE_SIZE << get_order(32768))
 
+/*
+ * With net.unix.stream_coalesce, writes up to this size are appended to
+ * the skb at the tail of the peer's receive queue, and get an skb with
+ * at least this much room when they cannot be.
+ */
+#define UNIX_STREAM_COALESCE_SZ	SKB_WITH_OVERHEAD(2048)
+
 #if IS_ENABLED(CONFIG_AF_UNIX_OOB)
 static int queue_oob(struct socket *sock, struct msghdr *msg, struct sock *other,
 		     struct scm_cookie *scm, bool fds_sent)
@@ -2157,6 +2164,66 @@ static int queue_oob(struct socket *sock, struct msghdr *msg, struct sock *other
 }
 #endif
 
+/*
+ * Append @size bytes of a write to the last skb in @other's receive
+ * queue if it is ours, linear and has the room, so that a stream of
+ * small writes reaches the reader in a few skbs instead of one each.
+ * Returns the number of bytes appended, 0 if the write needs an skb of
+ * its own or a negative error.
+ */
+static int unix_stream_coalesce(struct sock *sk, struct sock *other,
+				struct scm_cookie *scm, struct msghdr *msg,
+				int size)
+{
+	struct unix_sock *u = unix_sk(other);
+	struct sk_buff *skb;
+	bool copied;
+	int err = 0;
+
+	/* A reader holding iolock is busy anyway, don't wait for it */
+	if (!mutex_trylock(&u->iolock))
+		return 0;
+
+	unix_state_lock(other);
+	skb = skb_peek_tail(&other->sk_receive_queue);
+	/* The OOB skb is held by u->oob_skb as well, so it is shared */
+	if (!skb || skb->sk != sk || skb_is_nonlinear(skb) ||
+	    skb_shared(skb) || skb_cloned(skb) || UNIXCB(skb).fp ||
+	    skb_tailroom(skb) < size || !unix_skb_scm_eq(skb, scm)) {
+		unix_state_unlock(other);
+		goto out;
+	}
+	/* iolock keeps readers away, this keeps a queue purge from freeing it */
+	skb_get(skb);
+	unix_state_unlock(other);
+
+	/*
+	 * Don't fault on user memory while holding the peer's iolock, a
+	 * short copy reverts the iter and the write gets an skb of its own.
+	 */
+	pagefault_disable();
+	copied = copy_from_iter_full(skb_tail_pointer(skb), size,
+				     &msg->msg_iter);
+	pagefault_enable();
+	if (!copied)
+		goto out_put;
+
+	unix_state_lock(other);
+	if (sock_flag(other, SOCK_DEAD) ||
+	    (other->sk_shutdown & RCV_SHUTDOWN)) {
+		err = -EPIPE;
+	} else {
+		__skb_put(skb, size);
+		err = size;
+	}
+	unix_state_unlock(other);
+out_put:
+	consume_skb(skb);
+out:
+	mutex_unlock(&u->iolock);
+	return err;
+}
+
 static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 			       size_t len)
 {
@@ -2167,7 +2234,8 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 	int sent = 0;
 	struct scm_cookie scm;
 	bool fds_sent = false;
-	int data_len;
+	int header_len, data_len;
+	bool coalesce;
 
 	wait_for_unix_gc();
 	err = scm_send(sock, msg, &scm, false);
@@ -2197,9 +2265,25 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 	if (sk->sk_shutdown & SEND_SHUTDOWN)
 		goto pipe_err;
 
+	coalesce = READ_ONCE(sock_net(sk)->unx.sysctl_stream_coalesce) &&
+		   !scm.fp;
+
 	while (sent < len) {
 		size = len - sent;
 
+		if (coalesce && size <= UNIX_STREAM_COALESCE_SZ) {
+			err = unix_stream_coalesce(sk, other, &scm, msg, size);
+			if (err == -EPIPE)
+				goto pipe_err;
+			if (err < 0)
+				goto out_err;
+			if (err) {
+				other->sk_data_ready(other);
+				sent += size;
+				continue;
+			}
+		}
+
 		/* Keep two messages in the pipe so it schedules better */
 		size = min_t(int, size, (sk->sk_sndbuf >> 1) - 64);
 
@@ -2210,7 +2294,13 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 
 		data_len = min_t(size_t, size, PAGE_ALIGN(data_len));
 
-		skb = sock_alloc_send_pskb(sk, size - data_len, data_len,
+		header_len = size - data_len;
+
+		/* Leave room for the writes that follow to be appended */
+		if (coalesce && size < UNIX_STREAM_COALESCE_SZ)
+			header_len = UNIX_STREAM_COALESCE_SZ;
+
+		skb = sock_alloc_send_pskb(sk, header_len, data_len,
 					   msg->msg_flags & MSG_DONTWAIT, &err,
 					   get_order(UNIX_SKB_FRAGS_SZ));
 		if (!skb)
@@ -2272,6 +2362,36 @@ out_err:
 	return sent ? : err;
 }
 
+/*
+ * Page cache pages spliced from a large folio arrive one page at a time.
+ * Grow the last frag over them instead of spending a frag (and a page
+ * reference) on each; the reference the frag holds pins the whole folio.
+ * Not with HIGHMEM: readers such as __skb_datagram_iter() kmap only the
+ * frag's first page.
+ */
+static bool unix_skb_coalesce_folio(struct sk_buff *skb, struct page *page,
+				    int offset, size_t size)
+{
+	int i = skb_shinfo(skb)->nr_frags;
+	struct page *last;
+	skb_frag_t *frag;
+
+	if (IS_ENABLED(CONFIG_HIGHMEM) || !i)
+		return false;
+
+	frag = &skb_shinfo(skb)->frags[i - 1];
+	last = skb_frag_page(frag);
+	if (page == last || page_folio(page) != page_folio(last))
+		return false;
+
+	if (((page_to_pfn(page) - page_to_pfn(last)) << PAGE_SHIFT) + offset !=
+	    skb_frag_off(frag) + skb_frag_size(frag))
+		return false;
+
+	skb_frag_size_add(frag, size);
+	return true;
+}
+
 static ssize_t unix_stream_sendpage(struct socket *socket, struct page *page,
 				    int offset, size_t size, int flags)
 {
@@ -2293,6 +2413,12 @@ static ssize_t unix_stream_sendpage(struct socket *socket, struct page *page,
 alloc_skb:
 		unix_state_unlock(other);
 		mutex_unlock(&unix_sk(other)->iolock);
+		/*
+		 * The tail skb is full: hand it to the reader before we may
+		 * sleep on sk_sndbuf, see the MSG_SENDPAGE_NOTLAST check below.
+		 */
+		if (tail)
+			other->sk_data_ready(other);
 		newskb = sock_alloc_send_pskb(sk, 0, 0, flags & MSG_DONTWAIT,
 					      &err, 0);
 		if (!newskb)
@@ -2349,7 +2475,8 @@ alloc_skb:
 		newskb = NULL;
 	}
 
-	if (skb_append_pagefrags(skb, page, offset, size)) {
+	if (!unix_skb_coalesce_folio(skb, page, offset, size) &&
+	    skb_append_pagefrags(skb, page, offset, size)) {
 		tail = skb;
 		goto alloc_skb;
 	}
@@ -2371,7 +2498,12 @@ alloc_skb:
 	unix_state_unlock(other);
 	mutex_unlock(&unix_sk(other)->iolock);
 
-	other->sk_data_ready(other);
+	/*
+	 * splice() tells us when more pages follow right away; wake the
+	 * reader once per batch rather than once per page.
+	 */
+	if (!(flags & MSG_SENDPAGE_NOTLAST))
+		other->sk_data_ready(other);
 	scm_destroy(&scm);
 	return size;
 
@@ -2381,6 +2513,8 @@ err_unlock:
 	mutex_unlock(&unix_sk(other)->iolock);
 err:
 	kfree_skb(newskb);
+	/* Don't leave pages queued by earlier NOTLAST calls unannounced */
+	other->sk_data_ready(other);
 	if (send_sigpipe && !(flags & MSG_NOSIGNAL))
 		send_sig(SIGPIPE, current, 0);
 	if (!init_scm)
@@ -19,6 +19,15 @@ static struct ctl_table unix_table[] = {
 		.mode		= 0644,
 		.proc_handler	= proc_dointvec
 	},
+	{
+		.procname	= "stream_coalesce",
+		.data		= &init_net.unx.sysctl_stream_coalesce,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= SYSCTL_ONE,
+	},
 	{ }
 };
 
@@ -34,6 +43,7 @@ int __net_init unix_sysctl_register(struct net *net)
 			goto err_alloc;
 
 		table[0].data = &net->unx.sysctl_max_dgram_qlen;
+		table[1].data = &net->unx.sysctl_stream_coalesce;
 	}
 
 	net->unx.ctl = register_net_sysctl(net, "net/unix", table);
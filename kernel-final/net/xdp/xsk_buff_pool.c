@@ -335,12 +335,12 @@ static void __xp_dma_unmap(struct xsk_dma_map *dma_map, unsigned long attrs)
 
 	for (i = 0; i < dma_map->dma_pages_cnt; i++) {
 		dma = &dma_map->dma_pages[i];
-		if (*dma) {
+		if (*dma && dma_map->dev) {
 			*dma &= ~XSK_NEXT_PG_CONTIG_MASK;
 			dma_unmap_page_attrs(dma_map->dev, *dma, PAGE_SIZE,
 					     DMA_BIDIRECTIONAL, attrs);
-			*dma = 0;
 		}
+		*dma = 0;
 	}
 
 	xp_destroy_dma_map(dma_map);
@@ -429,6 +429,16 @@ int xp_dma_map(struct xsk_buff_pool *pool, struct device *dev,
 		return -ENOMEM;
 
 	for (i = 0; i < dma_map->dma_pages_cnt; i++) {
+		/* Software devices (dev == NULL) never DMA, they copy through
+		 * the kernel mapping of the umem in which every page follows
+		 * the previous one. Record that layout so that the contiguity
+		 * checks let buffers cross page boundaries.
+		 */
+		if (!dev) {
+			dma_map->dma_pages[i] = (dma_addr_t)i << PAGE_SHIFT;
+			continue;
+		}
+
 		dma = dma_map_page_attrs(dev, pages[i], 0, PAGE_SIZE,
 					 DMA_BIDIRECTIONAL, attrs);
 		if (dma_mapping_error(dev, dma)) {
@@ -49,6 +49,9 @@
  *    h. tests for invalid and corner case Tx descriptors so that the correct ones
  *       are discarded and let through, respectively.
  *    i. 2K frame size tests
+ *    j. throughput
+ *       Send a larger stream and report packets per second, to compare copy
+ *       and zero-copy mode on the same interfaces.
  *
  * Total tests: 12
  *
@@ -1746,6 +1749,27 @@ static void testapp_xdp_metadata_count(struct test_spec *test)
 	testapp_validate_traffic(test);
 }
 
+static void testapp_throughput(struct test_spec *test)
+{
+	struct timespec start, end;
+	u64 ns;
+
+	test_spec_set_name(test, "THROUGHPUT");
+	pkt_stream_replace(test, THROUGHPUT_PKT_CNT, PKT_SIZE);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	testapp_validate_traffic(test);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (test->fail)
+		return;
+
+	ns = (end.tv_sec - start.tv_sec) * 1000000000ULL + end.tv_nsec - start.tv_nsec;
+	ksft_print_msg("%s %s%s: %u packets in %llu us, %llu pps\n", mode_string(test),
+		       busy_poll_string(test), test->name, THROUGHPUT_PKT_CNT, ns / 1000,
+		       THROUGHPUT_PKT_CNT * 1000000000ULL / ns);
+}
+
 static void testapp_poll_txq_tmout(struct test_spec *test)
 {
 	test_spec_set_name(test, "POLL_TXQ_FULL");
@@ -1921,6 +1945,9 @@ static void run_pkt_test(struct test_spec *test, enum test_mode mode, enum test_
 	case TEST_TYPE_XDP_METADATA_COUNT:
 		testapp_xdp_metadata_count(test);
 		break;
+	case TEST_TYPE_THROUGHPUT:
+		testapp_throughput(test);
+		break;
 	default:
 		break;
 	}
@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+
+#include "../kselftest_harness.h"
+
+#ifndef PR_SET_FD_CACHE
+#define PR_SET_FD_CACHE	69
+#define PR_GET_FD_CACHE	70
+#endif
+
+static int lowest_free_fd(void)
+{
+	int fd = dup(0);
+
+	if (fd >= 0)
+		close(fd);
+	return fd;
+}
+
+FIXTURE(fd_cache) {
+	int null_fd;
+};
+
+FIXTURE_SETUP(fd_cache)
+{
+	self->null_fd = open("/dev/null", O_RDONLY);
+	ASSERT_GE(self->null_fd, 0);
+
+	if (prctl(PR_SET_FD_CACHE, 8, 0, 0, 0)) {
+		if (errno == EINVAL)
+			SKIP(return, "PR_SET_FD_CACHE not supported");
+		ASSERT_EQ(errno, 0);
+	}
+}
+
+FIXTURE_TEARDOWN(fd_cache)
+{
+	prctl(PR_SET_FD_CACHE, 0, 0, 0, 0);
+	close(self->null_fd);
+}
+
+TEST_F(fd_cache, get_set)
+{
+	EXPECT_EQ(prctl(PR_GET_FD_CACHE, 0, 0, 0, 0), 8);
+	EXPECT_EQ(prctl(PR_SET_FD_CACHE, 65, 0, 0, 0), -1);
+	EXPECT_EQ(errno, EINVAL);
+	EXPECT_EQ(prctl(PR_SET_FD_CACHE, 0, 0, 0, 0), 0);
+	EXPECT_EQ(prctl(PR_GET_FD_CACHE, 0, 0, 0, 0), 0);
+}
+
+TEST_F(fd_cache, ascending_and_cloexec)
+{
+	int fds[32], i;
+
+	for (i = 0; i < 32; i++) {
+		fds[i] = open("/dev/null", i & 1 ? O_RDONLY | O_CLOEXEC :
+						    O_RDONLY);
+		ASSERT_GE(fds[i], 0);
+		EXPECT_EQ(!!(fcntl(fds[i], F_GETFD) & FD_CLOEXEC), i & 1);
+		if (i > 1)
+			EXPECT_GT(fds[i], fds[i - 2]);
+	}
+	for (i = 0; i < 32; i++)
+		EXPECT_EQ(close(fds[i]), 0);
+}
+
+TEST_F(fd_cache, reserved_slots)
+{
+	int fd, lowest;
+
+	lowest = lowest_free_fd();
+	ASSERT_GE(lowest, 0);
+
+	/* the next slot of the batch is reserved, not open */
+	fd = open("/dev/null", O_RDONLY);
+	ASSERT_GE(fd, 0);
+	EXPECT_EQ(fcntl(fd + 1, F_GETFD), -1);
+	EXPECT_EQ(errno, EBADF);
+	EXPECT_EQ(dup2(self->null_fd, fd + 1), -1);
+	EXPECT_EQ(errno, EBUSY);
+	EXPECT_EQ(close(fd), 0);
+
+	/* disabling the cache gives back POSIX lowest-fd allocation */
+	ASSERT_EQ(prctl(PR_SET_FD_CACHE, 0, 0, 0, 0), 0);
+	EXPECT_EQ(lowest_free_fd(), lowest);
+	EXPECT_EQ(dup2(self->null_fd, fd + 1), fd + 1);
+	EXPECT_EQ(close(fd + 1), 0);
+}
+
+TEST_F(fd_cache, fork)
+{
+	int lowest, status;
+	pid_t pid;
+
+	lowest = lowest_free_fd();
+	ASSERT_GE(lowest, 0);
+	ASSERT_GE(open("/dev/null", O_RDONLY), 0);
+
+	pid = fork();
+	ASSERT_GE(pid, 0);
+	if (!pid) {
+		/* the cache is not inherited, nor are its reservations */
+		if (prctl(PR_GET_FD_CACHE, 0, 0, 0, 0))
+			_exit(1);
+		if (open("/dev/null", O_RDONLY) != lowest + 1)
+			_exit(2);
+		_exit(0);
+	}
+	ASSERT_EQ(waitpid(pid, &status, 0), pid);
+	EXPECT_TRUE(WIFEXITED(status));
+	EXPECT_EQ(WEXITSTATUS(status), 0);
+	EXPECT_EQ(close(lowest), 0);
+}
+
+TEST_HARNESS_MAIN
@@ -0,0 +1,76 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Write a large compressible file and a large incompressible one to a
+# compressed btrfs on a loop device, first with one compression worker and
+# then with one per CPU, check the data and report the throughput.
+
+ksft_skip=4
+SIZE_MB=${SIZE_MB:-1024}
+DIR=$(mktemp -d)
+MNT=$DIR/mnt
+LOOP=
+
+cleanup()
+{
+	umount "$MNT" 2>/dev/null
+	[ -n "$LOOP" ] && losetup -d "$LOOP"
+	rm -rf "$DIR"
+}
+
+skip()
+{
+	echo "SKIP: $1"
+	exit $ksft_skip
+}
+
+trap cleanup EXIT
+[ "$(id -u)" -eq 0 ] || skip "must be run as root"
+command -v mkfs.btrfs >/dev/null || skip "mkfs.btrfs not found"
+
+mkdir "$MNT"
+truncate -s $((SIZE_MB * 4))M "$DIR/img"
+LOOP=$(losetup -f --show "$DIR/img") || skip "no loop device"
+mkfs.btrfs -q -f "$LOOP" || exit 1
+mount -o compress=zstd "$LOOP" "$MNT" || exit 1
+
+KNOB=/sys/fs/btrfs/$(findmnt -no UUID "$MNT")/compress_workers
+[ -w "$KNOB" ] || skip "$KNOB not present"
+
+# source data lives in memory so that reading it costs nothing
+seq -f "line %.0f of some fairly compressible text" 1 100000000 | \
+	head -c ${SIZE_MB}M > /dev/shm/btrfs_compress.text
+head -c ${SIZE_MB}M /dev/urandom > /dev/shm/btrfs_compress.random
+trap 'rm -f /dev/shm/btrfs_compress.*; cleanup' EXIT
+
+ret=0
+for workers in 1 "$(nproc)"; do
+	echo "$workers" > "$KNOB" || exit 1
+	for kind in text random; do
+		src=/dev/shm/btrfs_compress.$kind
+		dst=$MNT/$kind.$workers
+
+		start=$(date +%s%N)
+		cp "$src" "$dst"
+		sync -f "$dst"
+		end=$(date +%s%N)
+		ms=$(( (end - start) / 1000000 ))
+		echo "compress_workers=$workers $kind: $SIZE_MB MiB in $ms ms" \
+		     "($(( SIZE_MB * 1000 / (ms + 1) )) MiB/s)"
+	done
+done
+
+umount "$MNT"
+mount "$LOOP" "$MNT" || exit 1
+for workers in 1 "$(nproc)"; do
+	for kind in text random; do
+		if ! cmp -s /dev/shm/btrfs_compress.$kind \
+			    "$MNT/$kind.$workers"; then
+			echo "FAIL: $kind.$workers read back bad data"
+			ret=1
+		fi
+	done
+done
+
+[ $ret -eq 0 ] && echo "PASS"
+exit $ret
@@ -0,0 +1,66 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Measure sequential buffered write throughput on xfs on a brd ramdisk for
+# a range of write sizes, and check that the data made it to the device.
+# Small writes are where the per-folio overhead of the iomap write path
+# shows up.
+
+ksft_skip=4
+SIZE_MB=${SIZE_MB:-1024}
+MNT=$(mktemp -d)
+DEV=
+
+cleanup()
+{
+	umount "$MNT" 2>/dev/null
+	rmdir "$MNT"
+	[ -n "$DEV" ] && rmmod brd 2>/dev/null
+}
+
+skip()
+{
+	echo "SKIP: $1"
+	rmdir "$MNT"
+	exit $ksft_skip
+}
+
+[ "$(id -u)" -eq 0 ] || skip "must be run as root"
+command -v mkfs.xfs >/dev/null || skip "mkfs.xfs not found"
+[ -e /dev/ram0 ] && skip "brd is already loaded"
+modprobe brd rd_nr=1 rd_size=$(( (SIZE_MB + 512) * 1024 )) 2>/dev/null || \
+	skip "cannot load brd"
+DEV=/dev/ram0
+trap cleanup EXIT
+
+mkfs.xfs -q -f "$DEV" || exit 1
+mount "$DEV" "$MNT" || exit 1
+
+ret=0
+for bs in 4k 16k 64k 1M; do
+	count=$(( SIZE_MB * 1024 / $(numfmt --from=iec "${bs^^}") * 1024 ))
+	rm -f "$MNT/file"
+	sync -f "$MNT"
+
+	start=$(date +%s%N)
+	dd if=/dev/zero of="$MNT/file" bs=$bs count=$count \
+	   status=none || ret=1
+	end=$(date +%s%N)
+	ms=$(( (end - start) / 1000000 ))
+	echo "bs=$bs: $SIZE_MB MiB written in $ms ms" \
+	     "($(( SIZE_MB * 1000 / (ms + 1) )) MiB/s)"
+done
+
+# verify through a fresh mount
+head -c 1M /dev/urandom > "$MNT/check"
+sum=$(md5sum < "$MNT/check")
+umount "$MNT"
+mount "$DEV" "$MNT" || exit 1
+if [ "$(md5sum < "$MNT/check")" != "$sum" ] ||
+   [ "$(stat -c %s "$MNT/file")" -ne $(( SIZE_MB << 20 )) ]; then
+	echo "FAIL: data did not survive remount"
+	ret=1
+fi
+
+[ $ret -eq 0 ] && echo "PASS"
+exit $ret
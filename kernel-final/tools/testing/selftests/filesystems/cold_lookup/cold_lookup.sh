@@ -0,0 +1,88 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Build a node_modules style tree (a few hundred entries per directory,
+# a few levels deep) on ext4 and xfs images backed by a direct-io loop device, drop
+# all caches and stat every file in random order, so that each path
+# component is resolved cold.  Reports the cold and warm resolution time
+# for each filesystem.
+
+ksft_skip=4
+NR_PKGS=${NR_PKGS:-100}
+NR_FILES=${NR_FILES:-300}
+IMG_DIR=${IMG_DIR:-/var/tmp}
+IMG=$(mktemp "$IMG_DIR/cold_lookup.XXXXXX")
+MNT=$(mktemp -d)
+LIST=$(mktemp)
+DEV=
+
+cleanup()
+{
+	umount "$MNT" 2>/dev/null
+	[ -n "$DEV" ] && losetup -d "$DEV"
+	rm -f "$IMG" "$LIST"
+	rmdir "$MNT"
+}
+
+skip()
+{
+	echo "SKIP: $1"
+	exit $ksft_skip
+}
+
+trap cleanup EXIT
+[ "$(id -u)" -eq 0 ] || skip "must be run as root"
+truncate -s 2G "$IMG" || skip "cannot create image in $IMG_DIR"
+DEV=$(losetup --direct-io=on -f --show "$IMG" 2>/dev/null) ||
+	skip "cannot set up a direct-io loop device"
+
+populate()
+{
+	local p d f
+
+	for ((p = 0; p < NR_PKGS; p++)); do
+		for d in lib lib/internal test; do
+			mkdir -p "$MNT/node_modules/pkg$p/$d"
+			for ((f = 0; f < NR_FILES; f++)); do
+				: > "$MNT/node_modules/pkg$p/$d/module_$f.js"
+			done
+		done
+	done
+	(cd "$MNT" && find node_modules -type f) | shuf > "$LIST"
+}
+
+resolve()
+{
+	local start end
+
+	start=$(date +%s%N)
+	(cd "$MNT" && xargs -a "$LIST" stat -c '' >/dev/null) || return 1
+	end=$(date +%s%N)
+	echo $(((end - start) / 1000000))
+}
+
+ret=0
+for fs in ext4 xfs; do
+	if ! command -v mkfs.$fs >/dev/null; then
+		echo "$fs: mkfs.$fs not found"
+		continue
+	fi
+	case $fs in
+	ext4)	mkfs.ext4 -q -F "$DEV" ;;
+	xfs)	mkfs.xfs -q -f "$DEV" ;;
+	esac || { ret=1; continue; }
+	mount -t $fs "$DEV" "$MNT" || { ret=1; continue; }
+	populate
+	umount "$MNT"
+	mount -t $fs "$DEV" "$MNT" || { ret=1; continue; }
+
+	sync
+	echo 3 > /proc/sys/vm/drop_caches
+	cold=$(resolve) || ret=1
+	warm=$(resolve) || ret=1
+	echo "$fs: $(wc -l < "$LIST") paths, cold ${cold}ms, warm ${warm}ms"
+	umount "$MNT"
+done
+
+[ $ret -eq 0 ] && echo "PASS"
+exit $ret
@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Call poll() on a large array of pipe read ends (50k by default) while
+ * one random pipe at a time is made readable.  The "stable" run passes
+ * the same array on every call so the kernel can keep its registrations
+ * around; the "churn" run flips the events of one unused entry between
+ * calls, which defeats that and forces a full scan each time.  Both runs
+ * must report exactly the pipe that was written to.
+ *
+ * Usage: poll_cache_bench [-n nr_fds] [-i iterations]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../kselftest.h"
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int run(struct pollfd *pfds, int *wfds, unsigned int nr,
+	       unsigned long iters, bool churn, double *secs)
+{
+	unsigned long it;
+	unsigned int i;
+	double start;
+	char c = 0;
+
+	srandom(1);
+	start = now();
+	for (it = 0; it < iters; it++) {
+		unsigned int target = random() % nr;
+		int ret;
+
+		/* Entry 0 never becomes readable, POLLPRI on it is harmless */
+		if (churn)
+			pfds[0].events ^= POLLPRI;
+
+		if (write(wfds[target], &c, 1) != 1)
+			return -1;
+
+		ret = poll(pfds, nr, -1);
+		if (ret != 1) {
+			ksft_print_msg("poll returned %d, expected 1\n", ret);
+			return -1;
+		}
+		if (pfds[target].revents != POLLIN) {
+			ksft_print_msg("fd %u: revents %#x\n", target,
+				       pfds[target].revents);
+			return -1;
+		}
+		if (read(pfds[target].fd, &c, 1) != 1)
+			return -1;
+
+		/* Nothing may be left ready once the byte is consumed */
+		ret = poll(pfds, nr, 0);
+		if (ret != 0) {
+			for (i = 0; i < nr; i++)
+				if (pfds[i].revents)
+					break;
+			ksft_print_msg("stale event on fd %u\n", i);
+			return -1;
+		}
+	}
+	*secs = now() - start;
+	pfds[0].events = POLLIN;
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long iters = 20000;
+	unsigned int nr = 50000, i;
+	double stable, churn;
+	struct pollfd *pfds;
+	struct rlimit rl;
+	int opt, *wfds;
+
+	while ((opt = getopt(argc, argv, "n:i:")) != -1) {
+		switch (opt) {
+		case 'n':
+			nr = strtoul(optarg, NULL, 0);
+			break;
+		case 'i':
+			iters = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr,
+				"Usage: %s [-n nr_fds] [-i iterations]\n",
+				argv[0]);
+			return KSFT_FAIL;
+		}
+	}
+	if (!nr)
+		nr = 1;
+
+	ksft_print_header();
+	ksft_set_plan(2);
+
+	rl.rlim_cur = rl.rlim_max = 2 * nr + 64;
+	if (setrlimit(RLIMIT_NOFILE, &rl))
+		ksft_exit_skip("cannot raise RLIMIT_NOFILE to %lu: %s\n",
+			       (unsigned long)rl.rlim_cur, strerror(errno));
+
+	pfds = calloc(nr, sizeof(*pfds));
+	wfds = calloc(nr, sizeof(*wfds));
+	if (!pfds || !wfds)
+		ksft_exit_fail_msg("out of memory\n");
+
+	for (i = 0; i < nr; i++) {
+		int p[2];
+
+		if (pipe2(p, O_NONBLOCK))
+			ksft_exit_fail_msg("pipe2: %s\n", strerror(errno));
+		pfds[i].fd = p[0];
+		pfds[i].events = POLLIN;
+		wfds[i] = p[1];
+	}
+
+	if (run(pfds, wfds, nr, iters, true, &churn))
+		ksft_test_result_fail("churn\n");
+	else
+		ksft_test_result_pass("churn: %.0f polls/s\n", iters / churn);
+
+	if (run(pfds, wfds, nr, iters, false, &stable))
+		ksft_test_result_fail("stable\n");
+	else
+		ksft_test_result_pass("stable: %.0f polls/s (%.1fx)\n",
+				      iters / stable, churn / stable);
+
+	ksft_finished();
+}
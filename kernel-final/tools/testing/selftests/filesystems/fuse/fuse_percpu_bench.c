@@ -0,0 +1,295 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Measure FUSE request throughput with a shared input queue versus per-CPU
+ * queues (FUSE_DEV_IOC_BIND_CPU).
+ *
+ * A minimal daemon talking the raw /dev/fuse protocol exports a single file
+ * opened with FOPEN_DIRECT_IO, so every read() is a round trip to userspace.
+ * One daemon thread and one reader thread are pinned to each online CPU.
+ *
+ * Usage: fuse_percpu_bench [seconds]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <linux/fuse.h>
+#include "../../kselftest.h"
+
+#define FILE_NAME	"data"
+#define FILE_INO	2
+#define FILE_SIZE	(1ULL << 30)
+#define IO_SIZE		4096
+#define MAX_WRITE	(128 * 1024)
+#define BUF_SIZE	(MAX_WRITE + 8192)
+
+static char zero_buf[MAX_WRITE];
+static char mnt[] = "/tmp/fuse_bench.XXXXXX";
+static volatile bool stop;
+
+struct daemon {
+	pthread_t thread;
+	int fd;
+	int cpu;
+};
+
+struct reader {
+	pthread_t thread;
+	int cpu;
+	unsigned long ops;
+};
+
+static void pin_to_cpu(int cpu)
+{
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	sched_setaffinity(0, sizeof(set), &set);
+}
+
+static void fill_attr(struct fuse_attr *attr, uint64_t ino)
+{
+	memset(attr, 0, sizeof(*attr));
+	attr->ino = ino;
+	attr->nlink = 1;
+	if (ino == FUSE_ROOT_ID) {
+		attr->mode = S_IFDIR | 0755;
+	} else {
+		attr->mode = S_IFREG | 0444;
+		attr->size = FILE_SIZE;
+		attr->blocks = FILE_SIZE / 512;
+	}
+	attr->blksize = IO_SIZE;
+}
+
+static int reply(int fd, uint64_t unique, int error, const void *arg,
+		 size_t argsize)
+{
+	struct fuse_out_header out = {
+		.len = sizeof(out) + (error ? 0 : argsize),
+		.error = error,
+		.unique = unique,
+	};
+	struct iovec iov[2] = {
+		{ .iov_base = &out, .iov_len = sizeof(out) },
+		{ .iov_base = (void *)arg, .iov_len = argsize },
+	};
+
+	return writev(fd, iov, error || !argsize ? 1 : 2);
+}
+
+static void handle(int fd, struct fuse_in_header *in, void *arg)
+{
+	switch (in->opcode) {
+	case FUSE_INIT: {
+		struct fuse_init_in *init = arg;
+		struct fuse_init_out out = {
+			.major = FUSE_KERNEL_VERSION,
+			.minor = FUSE_KERNEL_MINOR_VERSION,
+			.max_readahead = init->max_readahead,
+			.max_background = 64,
+			.congestion_threshold = 48,
+			.max_write = MAX_WRITE,
+			.time_gran = 1,
+		};
+
+		reply(fd, in->unique, 0, &out, sizeof(out));
+		break;
+	}
+	case FUSE_LOOKUP: {
+		struct fuse_entry_out out = {
+			.nodeid = FILE_INO,
+			.entry_valid = 3600,
+			.attr_valid = 3600,
+		};
+
+		if (in->nodeid != FUSE_ROOT_ID || strcmp(arg, FILE_NAME)) {
+			reply(fd, in->unique, -ENOENT, NULL, 0);
+			break;
+		}
+		fill_attr(&out.attr, FILE_INO);
+		reply(fd, in->unique, 0, &out, sizeof(out));
+		break;
+	}
+	case FUSE_GETATTR: {
+		struct fuse_attr_out out = { .attr_valid = 3600 };
+
+		fill_attr(&out.attr, in->nodeid);
+		reply(fd, in->unique, 0, &out, sizeof(out));
+		break;
+	}
+	case FUSE_OPEN: {
+		struct fuse_open_out out = { .open_flags = FOPEN_DIRECT_IO };
+
+		reply(fd, in->unique, 0, &out, sizeof(out));
+		break;
+	}
+	case FUSE_READ: {
+		struct fuse_read_in *read_in = arg;
+		uint64_t size = read_in->size;
+
+		if (read_in->offset >= FILE_SIZE)
+			size = 0;
+		else if (size > FILE_SIZE - read_in->offset)
+			size = FILE_SIZE - read_in->offset;
+		if (size > sizeof(zero_buf))
+			size = sizeof(zero_buf);
+		reply(fd, in->unique, 0, zero_buf, size);
+		break;
+	}
+	case FUSE_FLUSH:
+	case FUSE_RELEASE:
+		reply(fd, in->unique, 0, NULL, 0);
+		break;
+	case FUSE_FORGET:
+	case FUSE_BATCH_FORGET:
+		break;
+	default:
+		reply(fd, in->unique, -ENOSYS, NULL, 0);
+		break;
+	}
+}
+
+static void *daemon_fn(void *data)
+{
+	struct daemon *d = data;
+	char *buf = malloc(BUF_SIZE);
+	ssize_t len;
+
+	if (!buf)
+		return NULL;
+
+	pin_to_cpu(d->cpu);
+	for (;;) {
+		len = read(d->fd, buf, BUF_SIZE);
+		if (len < 0) {
+			if (errno == EINTR || errno == ENOENT)
+				continue;
+			break;
+		}
+		if (len < (ssize_t)sizeof(struct fuse_in_header))
+			break;
+		handle(d->fd, (struct fuse_in_header *)buf,
+		       buf + sizeof(struct fuse_in_header));
+	}
+	free(buf);
+	return NULL;
+}
+
+static void *reader_fn(void *data)
+{
+	struct reader *r = data;
+	char path[64], *buf;
+	unsigned int seed = r->cpu;
+	off_t off;
+	int fd;
+
+	pin_to_cpu(r->cpu);
+	snprintf(path, sizeof(path), "%s/" FILE_NAME, mnt);
+	fd = open(path, O_RDONLY);
+	if (fd < 0 || posix_memalign((void **)&buf, IO_SIZE, IO_SIZE))
+		return NULL;
+
+	while (!stop) {
+		off = (off_t)(rand_r(&seed) % (FILE_SIZE / IO_SIZE)) * IO_SIZE;
+		if (pread(fd, buf, IO_SIZE, off) != IO_SIZE)
+			break;
+		r->ops++;
+	}
+	free(buf);
+	close(fd);
+	return NULL;
+}
+
+static double run(bool percpu, int ncpus, int seconds)
+{
+	struct daemon *daemons = calloc(ncpus, sizeof(*daemons));
+	struct reader *readers = calloc(ncpus, sizeof(*readers));
+	unsigned long total = 0;
+	char opts[128];
+	uint32_t arg;
+	int fd, i;
+
+	fd = open("/dev/fuse", O_RDWR);
+	if (fd < 0)
+		ksft_exit_skip("cannot open /dev/fuse: %s\n", strerror(errno));
+
+	snprintf(opts, sizeof(opts),
+		 "fd=%d,rootmode=40000,user_id=0,group_id=0", fd);
+	if (mount("bench", mnt, "fuse.bench", MS_NOSUID | MS_NODEV, opts))
+		ksft_exit_fail_msg("mount: %s\n", strerror(errno));
+
+	for (i = 0; i < ncpus; i++) {
+		daemons[i].cpu = i;
+		daemons[i].fd = open("/dev/fuse", O_RDWR);
+		arg = fd;
+		if (daemons[i].fd < 0 ||
+		    ioctl(daemons[i].fd, FUSE_DEV_IOC_CLONE, &arg))
+			ksft_exit_fail_msg("clone: %s\n", strerror(errno));
+		arg = i;
+		if (percpu && ioctl(daemons[i].fd, FUSE_DEV_IOC_BIND_CPU, &arg))
+			ksft_exit_skip("FUSE_DEV_IOC_BIND_CPU: %s\n",
+				       strerror(errno));
+		pthread_create(&daemons[i].thread, NULL, daemon_fn,
+			       &daemons[i]);
+	}
+
+	stop = false;
+	for (i = 0; i < ncpus; i++) {
+		readers[i].cpu = i;
+		pthread_create(&readers[i].thread, NULL, reader_fn, &readers[i]);
+	}
+	sleep(seconds);
+	stop = true;
+	for (i = 0; i < ncpus; i++) {
+		pthread_join(readers[i].thread, NULL);
+		total += readers[i].ops;
+	}
+
+	umount2(mnt, MNT_DETACH);
+	for (i = 0; i < ncpus; i++) {
+		pthread_join(daemons[i].thread, NULL);
+		close(daemons[i].fd);
+	}
+	close(fd);
+	free(daemons);
+	free(readers);
+
+	return (double)total / seconds;
+}
+
+int main(int argc, char **argv)
+{
+	int seconds = argc > 1 ? atoi(argv[1]) : 5;
+	int ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	double shared, percpu;
+
+	if (geteuid())
+		ksft_exit_skip("must be run as root\n");
+	if (!mkdtemp(mnt))
+		ksft_exit_fail_msg("mkdtemp: %s\n", strerror(errno));
+
+	shared = run(false, ncpus, seconds);
+	percpu = run(true, ncpus, seconds);
+	rmdir(mnt);
+
+	printf("cpus:            %d\n", ncpus);
+	printf("shared queue:    %.0f reads/s\n", shared);
+	printf("per-CPU queues:  %.0f reads/s (%+.1f%%)\n", percpu,
+	       shared ? (percpu - shared) * 100 / shared : 0);
+
+	return 0;
+}
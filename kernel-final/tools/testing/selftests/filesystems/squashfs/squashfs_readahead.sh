@@ -0,0 +1,65 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Build a squashfs image and read a large file from it with a cold page
+# cache, once with a single decompressor (datablocks are decompressed one
+# after the other) and once with per-CPU decompressors (readahead
+# decompresses datablocks in parallel).  Check the data and report the
+# throughput of each.
+
+ksft_skip=4
+SIZE_MB=${SIZE_MB:-512}
+DIR=$(mktemp -d)
+MNT=$DIR/mnt
+
+cleanup()
+{
+	umount "$MNT" 2>/dev/null
+	rm -rf "$DIR"
+}
+
+skip()
+{
+	echo "SKIP: $1"
+	exit $ksft_skip
+}
+
+trap cleanup EXIT
+[ "$(id -u)" -eq 0 ] || skip "must be run as root"
+command -v mksquashfs >/dev/null || skip "mksquashfs not found"
+
+# compressible but not trivially so
+mkdir "$DIR/src" "$MNT"
+head -c $((SIZE_MB / 2))M /dev/urandom | od -An -tx1 -w32 | \
+	head -c ${SIZE_MB}M > "$DIR/src/data"
+sum=$(md5sum < "$DIR/src/data")
+mksquashfs "$DIR/src" "$DIR/img" -b 128K -comp zstd -noappend -quiet \
+	>/dev/null 2>&1 || mksquashfs "$DIR/src" "$DIR/img" -b 128K \
+	-noappend -quiet >/dev/null || exit 1
+rm -f "$DIR/src/data"
+
+ret=0
+for threads in single percpu; do
+	if ! mount -t squashfs -o loop,threads=$threads "$DIR/img" "$MNT" \
+	     2>/dev/null; then
+		echo "threads=$threads: not supported, skipping"
+		continue
+	fi
+	sync
+	echo 3 > /proc/sys/vm/drop_caches
+
+	start=$(date +%s%N)
+	got=$(md5sum < "$MNT/data")
+	end=$(date +%s%N)
+	ms=$(( (end - start) / 1000000 ))
+	echo "threads=$threads: ${SIZE_MB} MiB cold sequential read in" \
+	     "$ms ms ($(( SIZE_MB * 1000 / (ms + 1) )) MiB/s)"
+	if [ "$got" != "$sum" ]; then
+		echo "FAIL: threads=$threads read back bad data"
+		ret=1
+	fi
+	umount "$MNT"
+done
+
+[ $ret -eq 0 ] && echo "PASS"
+exit $ret
@@ -0,0 +1,280 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Walk a large directory tree (1M files on tmpfs by default) and stat
+ * every entry, once with one statx() per file, once with statx_batch()
+ * per directory chunk and, if available, once with getdents_statx().
+ * All walks must agree.
+ *
+ * Usage: statx_batch_bench [-d base_dir] [-n nr_files] [-k]
+ */
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/stat.h>
+
+#include "../../kselftest.h"
+
+#define FILES_PER_DIR	1000
+
+#ifdef __NR_statx_batch
+
+static char names[STATX_BATCH_MAX][NAME_MAX + 1];
+static struct statx bufs[STATX_BATCH_MAX];
+static struct statx_batch ents[STATX_BATCH_MAX];
+static char dents[256 << 10] __attribute__((aligned(8)));
+
+enum walk_mode {
+	WALK_STATX,
+	WALK_BATCH,
+	WALK_GETDENTS,
+};
+
+struct walk_result {
+	unsigned long files;
+	unsigned long long ino_sum;
+	double secs;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int create_tree(const char *base, unsigned long nr_files)
+{
+	char path[PATH_MAX];
+	unsigned long i;
+	int fd;
+
+	for (i = 0; i < nr_files; i++) {
+		if (!(i % FILES_PER_DIR)) {
+			snprintf(path, sizeof(path), "%s/d%lu", base,
+				 i / FILES_PER_DIR);
+			if (mkdir(path, 0755) && errno != EEXIST)
+				return -1;
+		}
+		snprintf(path, sizeof(path), "%s/d%lu/f%lu", base,
+			 i / FILES_PER_DIR, i);
+		fd = open(path, O_CREAT | O_WRONLY, 0644);
+		if (fd < 0)
+			return -1;
+		close(fd);
+	}
+	return 0;
+}
+
+static int flush_batch(int dfd, unsigned int nr, struct walk_result *res)
+{
+	unsigned int i;
+	long ret;
+
+	ret = syscall(__NR_statx_batch, dfd, ents, nr, AT_SYMLINK_NOFOLLOW,
+		      STATX_BASIC_STATS);
+	if (ret != nr)
+		return -1;
+	for (i = 0; i < nr; i++) {
+		if (ents[i].result)
+			return -1;
+		res->ino_sum += bufs[i].stx_ino;
+		res->files++;
+	}
+	return 0;
+}
+
+#ifdef __NR_getdents_statx
+static int walk_getdents(int dfd, struct walk_result *res)
+{
+	struct dirent_statx *d;
+	long ret, pos;
+
+	while ((ret = syscall(__NR_getdents_statx, dfd, dents, sizeof(dents),
+			      0, STATX_BASIC_STATS)) > 0) {
+		for (pos = 0; pos < ret; pos += d->d_reclen) {
+			d = (struct dirent_statx *)(dents + pos);
+			if (d->d_name[0] == '.')
+				continue;
+			if (d->d_result)
+				return -1;
+			res->ino_sum += d->d_stat.stx_ino;
+			res->files++;
+		}
+	}
+	return ret;
+}
+#else
+static int walk_getdents(int dfd, struct walk_result *res)
+{
+	errno = ENOSYS;
+	return -1;
+}
+#endif
+
+/* stat all entries of all directories under @base */
+static int walk(const char *base, enum walk_mode mode,
+		struct walk_result *res)
+{
+	struct dirent *de, *sub;
+	DIR *top, *dir;
+	double start = now();
+
+	memset(res, 0, sizeof(*res));
+	top = opendir(base);
+	if (!top)
+		return -1;
+	while ((de = readdir(top))) {
+		unsigned int nr = 0;
+		int dfd;
+
+		if (de->d_name[0] == '.')
+			continue;
+		dfd = openat(dirfd(top), de->d_name, O_RDONLY | O_DIRECTORY);
+		if (dfd < 0)
+			return -1;
+		if (mode == WALK_GETDENTS) {
+			if (walk_getdents(dfd, res))
+				return -1;
+			close(dfd);
+			continue;
+		}
+		dir = fdopendir(dfd);
+		if (!dir)
+			return -1;
+		while ((sub = readdir(dir))) {
+			struct statx stx;
+
+			if (sub->d_name[0] == '.')
+				continue;
+			if (mode == WALK_STATX) {
+				if (statx(dfd, sub->d_name,
+					  AT_SYMLINK_NOFOLLOW,
+					  STATX_BASIC_STATS, &stx))
+					return -1;
+				res->ino_sum += stx.stx_ino;
+				res->files++;
+				continue;
+			}
+			strcpy(names[nr], sub->d_name);
+			ents[nr].name = (uintptr_t)names[nr];
+			ents[nr].buf = (uintptr_t)&bufs[nr];
+			ents[nr].result = -1;
+			if (++nr == STATX_BATCH_MAX) {
+				if (flush_batch(dfd, nr, res))
+					return -1;
+				nr = 0;
+			}
+		}
+		if (nr && flush_batch(dfd, nr, res))
+			return -1;
+		closedir(dir);
+	}
+	closedir(top);
+	res->secs = now() - start;
+	return 0;
+}
+
+static void remove_tree(const char *base, unsigned long nr_files)
+{
+	char path[PATH_MAX];
+	unsigned long i;
+
+	for (i = 0; i < nr_files; i++) {
+		snprintf(path, sizeof(path), "%s/d%lu/f%lu", base,
+			 i / FILES_PER_DIR, i);
+		unlink(path);
+	}
+	for (i = 0; i < (nr_files + FILES_PER_DIR - 1) / FILES_PER_DIR; i++) {
+		snprintf(path, sizeof(path), "%s/d%lu", base, i);
+		rmdir(path);
+	}
+	rmdir(base);
+}
+
+int main(int argc, char **argv)
+{
+	char base[PATH_MAX] = "/dev/shm/statx_batch.XXXXXX";
+	struct walk_result single, batched, dents_res;
+	unsigned long nr_files = 1000000;
+	bool keep = false;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:n:k")) != -1) {
+		switch (opt) {
+		case 'd':
+			snprintf(base, sizeof(base), "%s/statx_batch.XXXXXX",
+				 optarg);
+			break;
+		case 'n':
+			nr_files = strtoul(optarg, NULL, 0);
+			break;
+		case 'k':
+			keep = true;
+			break;
+		default:
+			ksft_exit_fail_msg("usage: %s [-d dir] [-n nr_files] [-k]\n",
+					   argv[0]);
+		}
+	}
+
+	if (syscall(__NR_statx_batch, AT_FDCWD, NULL, 0, 0, 0) < 0 &&
+	    errno == ENOSYS)
+		ksft_exit_skip("statx_batch() not supported\n");
+
+	if (!mkdtemp(base))
+		ksft_exit_fail_msg("mkdtemp: %s\n", strerror(errno));
+	printf("creating %lu files under %s\n", nr_files, base);
+	if (create_tree(base, nr_files))
+		ksft_exit_fail_msg("create: %s\n", strerror(errno));
+
+	/* warm the dcache so both walks measure the same thing */
+	if (walk(base, WALK_STATX, &single) || walk(base, WALK_STATX, &single))
+		ksft_exit_fail_msg("statx walk: %s\n", strerror(errno));
+	if (walk(base, WALK_BATCH, &batched))
+		ksft_exit_fail_msg("statx_batch walk failed\n");
+
+	printf("statx:          %lu files in %.3f s\n", single.files,
+	       single.secs);
+	printf("statx_batch:    %lu files in %.3f s (%.2fx)\n", batched.files,
+	       batched.secs, single.secs / batched.secs);
+
+	if (walk(base, WALK_GETDENTS, &dents_res)) {
+		if (errno != ENOSYS)
+			ksft_exit_fail_msg("getdents_statx walk: %s\n",
+					   strerror(errno));
+		dents_res = single;
+	} else {
+		printf("getdents_statx: %lu files in %.3f s (%.2fx)\n",
+		       dents_res.files, dents_res.secs,
+		       single.secs / dents_res.secs);
+	}
+
+	if (!keep)
+		remove_tree(base, nr_files);
+
+	if (single.files != nr_files || batched.files != nr_files ||
+	    single.ino_sum != batched.ino_sum ||
+	    single.ino_sum != dents_res.ino_sum)
+		ksft_exit_fail_msg("walks disagree\n");
+	ksft_exit_pass();
+}
+
+#else
+
+int main(void)
+{
+	ksft_exit_skip("statx_batch() not wired up on this architecture\n");
+}
+
+#endif
@@ -0,0 +1,72 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Write back many small dirty files on a memory backed null_blk device,
+# first with one flusher thread and then with several, check the data and
+# report the time each sync took.
+
+ksft_skip=4
+NR_FILES=${NR_FILES:-20000}
+THREADS=${THREADS:-4}
+MNT=$(mktemp -d)
+DEV=
+
+cleanup()
+{
+	umount "$MNT" 2>/dev/null
+	rmdir "$MNT"
+	[ -n "$DEV" ] && modprobe -r null_blk 2>/dev/null
+}
+
+skip()
+{
+	echo "SKIP: $1"
+	rmdir "$MNT"
+	exit $ksft_skip
+}
+
+[ "$(id -u)" -eq 0 ] || skip "must be run as root"
+command -v mkfs.ext4 >/dev/null || skip "mkfs.ext4 not found"
+[ -e /dev/nullb0 ] && skip "null_blk is already loaded"
+modprobe null_blk nr_devices=1 gb=4 bs=4096 memory_backed=1 \
+	queue_mode=2 irqmode=0 2>/dev/null || skip "cannot load null_blk"
+DEV=/dev/nullb0
+trap cleanup EXIT
+
+KNOB=/sys/block/nullb0/bdi/writeback_threads
+[ -w "$KNOB" ] || { echo "SKIP: $KNOB not present"; exit $ksft_skip; }
+
+mkfs.ext4 -q -F "$DEV" || exit 1
+mount "$DEV" "$MNT" || exit 1
+
+ret=0
+for threads in 1 "$THREADS"; do
+	echo "$threads" > "$KNOB" || exit 1
+	dir="$MNT/t$threads"
+	mkdir "$dir"
+	for ((i = 0; i < NR_FILES; i++)); do
+		printf '%08d\n' "$i" > "$dir/$i"
+	done
+
+	start=$(date +%s%N)
+	sync -f "$MNT"
+	end=$(date +%s%N)
+	echo "writeback_threads=$threads: $NR_FILES files synced in" \
+	     "$(( (end - start) / 1000000 )) ms"
+done
+
+# read everything back from the device
+umount "$MNT"
+mount "$DEV" "$MNT" || exit 1
+for threads in 1 "$THREADS"; do
+	for ((i = 0; i < NR_FILES; i += 997)); do
+		if [ "$(cat "$MNT/t$threads/$i")" != "$(printf '%08d' "$i")" ]; then
+			echo "FAIL: bad data in t$threads/$i"
+			ret=1
+		fi
+	done
+done
+echo 1 > "$KNOB"
+
+[ $ret -eq 0 ] && echo "PASS"
+exit $ret
@@ -0,0 +1,59 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Run a metadata heavy fs_mark load (zero length file creates from one
+# thread per CPU) against xfs on a brd ramdisk, once with the iclog size
+# picked automatically and once with logbsize=32k, and report files/s
+# together with the CIL push stall counters of each run.
+
+ksft_skip=4
+NR_FILES=${NR_FILES:-200000}
+MNT=$(mktemp -d)
+DEV=
+
+cleanup()
+{
+	umount "$MNT" 2>/dev/null
+	rmdir "$MNT"
+	[ -n "$DEV" ] && rmmod brd 2>/dev/null
+}
+
+skip()
+{
+	echo "SKIP: $1"
+	rmdir "$MNT"
+	exit $ksft_skip
+}
+
+[ "$(id -u)" -eq 0 ] || skip "must be run as root"
+command -v mkfs.xfs >/dev/null || skip "mkfs.xfs not found"
+command -v fs_mark >/dev/null || skip "fs_mark not found"
+[ -e /dev/ram0 ] && skip "brd is already loaded"
+modprobe brd rd_nr=1 rd_size=$((4 << 20)) 2>/dev/null || skip "cannot load brd"
+DEV=/dev/ram0
+trap cleanup EXIT
+
+threads=$(nproc)
+ret=0
+for opts in "" "logbsize=32k"; do
+	mkfs.xfs -q -f "$DEV" || exit 1
+	mount ${opts:+-o $opts} "$DEV" "$MNT" || exit 1
+	stats=/sys/fs/xfs/$(basename "$DEV")/stats/stats
+	[ -r "$stats" ] || skip "$stats not present"
+
+	dirs=""
+	for ((t = 0; t < threads; t++)); do
+		dirs="$dirs -d $MNT/d$t"
+	done
+	rate=$(fs_mark $dirs -n $((NR_FILES / threads)) -s 0 -S 0 -L 1 |
+	       awk '/^ *[0-9]/ { print $4 }')
+	[ -n "$rate" ] || ret=1
+
+	echo "${opts:-default}: $(grep -o 'logbsize=[0-9a-z]*' /proc/mounts |
+	      tail -1), $rate files/s, cil: $(grep '^cil ' "$stats" |
+	      cut -d' ' -f2-) (throttled, us, ordered, us)"
+	umount "$MNT"
+done
+
+[ $ret -eq 0 ] && echo "PASS"
+exit $ret
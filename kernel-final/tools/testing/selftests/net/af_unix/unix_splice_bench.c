@@ -0,0 +1,247 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Move a file over an AF_UNIX stream socket pair, once with read() and
+ * write() on both ends and once with splice() through pipes from the
+ * page cache to the socket and from the socket to /dev/null, and report
+ * the throughput of both.  A third, untimed run splices into the socket
+ * and checksums what recv() returns on the other end.
+ *
+ * Usage: unix_splice_bench [-f file] [-s size_mb]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../kselftest.h"
+
+#define CHUNK	(128 << 10)
+
+enum bench_mode {
+	MODE_COPY,
+	MODE_SPLICE,
+	MODE_VERIFY,
+};
+
+static char buf[CHUNK];
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t sum_bytes(uint64_t sum, const char *p, ssize_t len)
+{
+	while (len--)
+		sum = sum * 31 + (unsigned char)*p++;
+	return sum;
+}
+
+static int create_file(const char *path, size_t size, uint64_t *sum)
+{
+	size_t done = 0, i;
+	int fd;
+
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0)
+		return -1;
+
+	*sum = 0;
+	srandom(1);
+	while (done < size) {
+		size_t len = size - done < CHUNK ? size - done : CHUNK;
+
+		for (i = 0; i < len; i++)
+			buf[i] = random();
+		if (write(fd, buf, len) != (ssize_t)len) {
+			close(fd);
+			return -1;
+		}
+		*sum = sum_bytes(*sum, buf, len);
+		done += len;
+	}
+	fsync(fd);
+	return fd;
+}
+
+/* Returns bytes received, checksummed into *sum for MODE_VERIFY */
+static ssize_t receiver(int sk, enum bench_mode mode, uint64_t *sum)
+{
+	ssize_t total = 0, n;
+	int p[2], null;
+
+	*sum = 0;
+	if (mode != MODE_SPLICE) {
+		while ((n = read(sk, buf, CHUNK)) > 0) {
+			if (mode == MODE_VERIFY)
+				*sum = sum_bytes(*sum, buf, n);
+			total += n;
+		}
+		return n < 0 ? -1 : total;
+	}
+
+	null = open("/dev/null", O_WRONLY);
+	if (null < 0 || pipe(p))
+		return -1;
+	while ((n = splice(sk, NULL, p[1], NULL, CHUNK, SPLICE_F_MOVE)) > 0) {
+		total += n;
+		while (n > 0) {
+			ssize_t m = splice(p[0], NULL, null, NULL, n,
+					   SPLICE_F_MOVE);
+
+			if (m <= 0)
+				return -1;
+			n -= m;
+		}
+	}
+	return n < 0 ? -1 : total;
+}
+
+static int sender(int fd, int sk, size_t size, enum bench_mode mode)
+{
+	size_t done = 0;
+	ssize_t n;
+	int p[2];
+
+	if (mode == MODE_COPY) {
+		while (done < size) {
+			n = pread(fd, buf, CHUNK, done);
+			if (n <= 0 || write(sk, buf, n) != n)
+				return -1;
+			done += n;
+		}
+		return 0;
+	}
+
+	if (pipe(p))
+		return -1;
+	while (done < size) {
+		loff_t off = done;
+
+		n = splice(fd, &off, p[1], NULL, CHUNK, SPLICE_F_MOVE);
+		if (n <= 0)
+			return -1;
+		done += n;
+		while (n > 0) {
+			ssize_t m = splice(p[0], NULL, sk, NULL, n,
+					   SPLICE_F_MOVE);
+
+			if (m <= 0)
+				return -1;
+			n -= m;
+		}
+	}
+	close(p[0]);
+	close(p[1]);
+	return 0;
+}
+
+static int run(int fd, size_t size, enum bench_mode mode, uint64_t *sum,
+	       double *secs)
+{
+	int sk[2], status, res[2];
+	double start;
+	pid_t pid;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sk))
+		return -1;
+	if (pipe(res))
+		return -1;
+
+	start = now();
+	pid = fork();
+	if (pid < 0)
+		return -1;
+	if (!pid) {
+		uint64_t s;
+		ssize_t got;
+
+		close(sk[0]);
+		got = receiver(sk[1], mode, &s);
+		if (got != (ssize_t)size ||
+		    write(res[1], &s, sizeof(s)) != sizeof(s))
+			_exit(1);
+		_exit(0);
+	}
+
+	close(sk[1]);
+	if (sender(fd, sk[0], size, mode))
+		ksft_print_msg("sender failed: %s\n", strerror(errno));
+	close(sk[0]);
+
+	if (waitpid(pid, &status, 0) != pid ||
+	    !WIFEXITED(status) || WEXITSTATUS(status))
+		return -1;
+	*secs = now() - start;
+
+	if (read(res[0], sum, sizeof(*sum)) != sizeof(*sum))
+		return -1;
+	close(res[0]);
+	close(res[1]);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = "/tmp/unix_splice_bench.dat";
+	double copy_secs, splice_secs, secs;
+	uint64_t fsum, sum;
+	size_t size = 1024;
+	int opt, fd;
+
+	while ((opt = getopt(argc, argv, "f:s:")) != -1) {
+		switch (opt) {
+		case 'f':
+			path = optarg;
+			break;
+		case 's':
+			size = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-f file] [-s size_mb]\n",
+				argv[0]);
+			return KSFT_FAIL;
+		}
+	}
+	size <<= 20;
+
+	ksft_print_header();
+	ksft_set_plan(3);
+
+	fd = create_file(path, size, &fsum);
+	if (fd < 0)
+		ksft_exit_skip("cannot create %s: %s\n", path, strerror(errno));
+
+	if (run(fd, size, MODE_COPY, &sum, &copy_secs))
+		ksft_test_result_fail("read/write\n");
+	else
+		ksft_test_result_pass("read/write: %.0f MB/s\n",
+				      (size >> 20) / copy_secs);
+
+	if (run(fd, size, MODE_SPLICE, &sum, &splice_secs))
+		ksft_test_result_fail("splice\n");
+	else
+		ksft_test_result_pass("splice: %.0f MB/s (%.2fx)\n",
+				      (size >> 20) / splice_secs,
+				      copy_secs / splice_secs);
+
+	if (run(fd, size, MODE_VERIFY, &sum, &secs) || sum != fsum)
+		ksft_test_result_fail("splice data mismatch\n");
+	else
+		ksft_test_result_pass("splice data intact\n");
+
+	close(fd);
+	unlink(path);
+	ksft_finished();
+}
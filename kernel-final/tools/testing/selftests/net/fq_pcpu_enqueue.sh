@@ -0,0 +1,122 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# sch_fq with per-CPU enqueue (TCA_FQ_PCPU_ENQUEUE): run many paced TCP
+# flows over a multiqueue veth with fq under mq, with the locked and the
+# lockless enqueue path, and check every flow still sticks to the fq
+# maxrate. Aggregate throughput of both runs is printed for comparison.
+#
+# TOPO: CLIENT_NS (veth0, mq + fq) <---> (veth1) SERVER_NS
+
+CLIENT_NS=$(mktemp -u client-XXXXXXXX)
+CLIENT_IP4="198.51.100.1"
+
+SERVER_NS=$(mktemp -u server-XXXXXXXX)
+SERVER_IP4="198.51.100.2"
+
+NR_QUEUES=4
+NR_FLOWS=${NR_FLOWS:-32}
+DURATION=${DURATION:-5}
+# per flow rate, in Mbit/s
+MAXRATE=50
+
+# Kselftest framework requirement - SKIP code is 4.
+ksft_skip=4
+
+ret=0
+
+setup() {
+	ip netns add $CLIENT_NS
+	ip netns add $SERVER_NS
+	ip -net $CLIENT_NS link add veth0 numtxqueues $NR_QUEUES \
+		numrxqueues $NR_QUEUES type veth peer name veth1 \
+		numtxqueues $NR_QUEUES numrxqueues $NR_QUEUES netns $SERVER_NS
+
+	ip -net $CLIENT_NS link set veth0 up
+	ip -net $CLIENT_NS addr add $CLIENT_IP4/24 dev veth0
+	ip -net $SERVER_NS link set veth1 up
+	ip -net $SERVER_NS addr add $SERVER_IP4/24 dev veth1
+
+	ip net exec $SERVER_NS netserver 2>&1 >/dev/null
+}
+
+cleanup() {
+	ip net exec $SERVER_NS pkill netserver
+	ip -net $CLIENT_NS link del veth0
+	ip netns del "$CLIENT_NS"
+	ip netns del "$SERVER_NS"
+}
+
+# $1: extra fq options
+setup_qdisc() {
+	local i
+
+	ip net exec $CLIENT_NS tc qdisc del dev veth0 root 2>/dev/null
+	ip net exec $CLIENT_NS tc qdisc add dev veth0 root handle 1: mq
+	for i in $(seq 1 $NR_QUEUES); do
+		ip net exec $CLIENT_NS tc qdisc add dev veth0 parent 1:$i \
+			fq maxrate ${MAXRATE}mbit $1 || return 1
+	done
+}
+
+# Prints one throughput (Mbit/s) per flow
+do_netperf() {
+	local i
+
+	for i in $(seq 1 $NR_FLOWS); do
+		ip net exec $CLIENT_NS netperf -H $SERVER_IP4 -t TCP_STREAM \
+			-l $DURATION -P 0 -- -o THROUGHPUT &
+	done
+	wait
+}
+
+do_test() {
+	local opts=$1
+	local name=$2
+	local out total max
+
+	if ! setup_qdisc "$opts"; then
+		echo "FAIL: $name: cannot set up mq/fq"
+		ret=1
+		return
+	fi
+
+	out=$(do_netperf)
+	total=$(echo "$out" | awk '{ s += $1 } END { printf "%d", s }')
+	max=$(echo "$out" | awk 'BEGIN { m = 0 } { if ($1 > m) m = $1 } \
+				  END { printf "%d", m }')
+
+	if [ $(echo "$out" | wc -l) -ne $NR_FLOWS ] || [ "$total" -eq 0 ]; then
+		echo "FAIL: $name: netperf failed"
+		ret=1
+	elif [ $max -gt $((MAXRATE * 105 / 100)) ]; then
+		echo "FAIL: $name: flow at $max Mbit/s above maxrate $MAXRATE"
+		ret=1
+	else
+		echo "PASS: $name: $NR_FLOWS flows, $total Mbit/s, max $max Mbit/s per flow"
+	fi
+}
+
+if [ "$(id -u)" -ne 0 ]; then
+	echo "SKIP: Need root privileges"
+	exit $ksft_skip
+fi
+
+if ! which netperf >/dev/null 2>&1 || ! which netserver >/dev/null 2>&1; then
+	echo "SKIP: Could not run test without netperf"
+	exit $ksft_skip
+fi
+
+# tc prints the fq usage on stderr
+if ! tc qdisc add fq help 2>&1 | grep -q pcpu_enqueue; then
+	echo "SKIP: tc without fq pcpu_enqueue (TCA_FQ_PCPU_ENQUEUE)"
+	exit $ksft_skip
+fi
+
+trap cleanup EXIT
+setup
+
+do_test "" "fq locked enqueue"
+do_test pcpu_enqueue "fq per-CPU enqueue"
+
+exit $ret
@@ -0,0 +1,351 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * TPACKET_V3 RX ring split into per-CPU sub-rings (PACKET_RX_SUBRINGS).
+ *
+ * Without arguments: send UDP packets over lo from a thread pinned to
+ * each CPU and check that every packet shows up exactly once, in the
+ * sub-ring of the CPU that received it.
+ *
+ * With -i <ifname>: capture on that interface with one reader thread
+ * per sub-ring, each pinned to the CPU filling its ring, and report
+ * packets per second after -t seconds, e.g. while pktgen blasts a
+ * multiqueue device from several CPUs.
+ */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <netinet/ip.h>
+#include <netinet/udp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../kselftest.h"
+
+#ifndef PACKET_RX_SUBRINGS
+#define PACKET_RX_SUBRINGS	25
+#endif
+
+#define BLOCK_SIZE		(1 << 16)
+#define FRAME_SIZE		2048
+#define BLOCKS_PER_RING		8
+#define TEST_PORT		8000
+#define PKTS_PER_CPU		200
+
+struct subring_reader {
+	pthread_t thread;
+	int ring;
+	uint64_t packets;
+	uint64_t misplaced;
+	uint64_t test_packets;
+};
+
+static const char *cfg_ifname;
+static int cfg_seconds = 10;
+
+static int nr_rings;
+static int fd;
+static uint8_t *ring_mem;
+static volatile bool stop;
+
+static void pin_to_cpu(int cpu)
+{
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (sched_setaffinity(0, sizeof(set), &set))
+		ksft_exit_fail_msg("sched_setaffinity %d: %s\n", cpu,
+				   strerror(errno));
+}
+
+static int setup_socket(int rings, int version, int block_nr)
+{
+	struct tpacket_req3 req;
+	int one = 1;
+	int s;
+
+	s = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+	if (s < 0)
+		ksft_exit_fail_msg("socket: %s\n", strerror(errno));
+
+	if (setsockopt(s, SOL_PACKET, PACKET_VERSION, &version,
+		       sizeof(version)))
+		ksft_exit_fail_msg("PACKET_VERSION: %s\n", strerror(errno));
+	if (setsockopt(s, SOL_PACKET, PACKET_IGNORE_OUTGOING, &one,
+		       sizeof(one)))
+		ksft_exit_fail_msg("PACKET_IGNORE_OUTGOING: %s\n",
+				   strerror(errno));
+	if (setsockopt(s, SOL_PACKET, PACKET_RX_SUBRINGS, &rings,
+		       sizeof(rings))) {
+		if (errno == ENOPROTOOPT)
+			ksft_exit_skip("PACKET_RX_SUBRINGS not supported\n");
+		ksft_exit_fail_msg("PACKET_RX_SUBRINGS: %s\n",
+				   strerror(errno));
+	}
+
+	memset(&req, 0, sizeof(req));
+	req.tp_block_size = BLOCK_SIZE;
+	req.tp_block_nr = block_nr;
+	req.tp_frame_size = FRAME_SIZE;
+	req.tp_frame_nr = BLOCK_SIZE / FRAME_SIZE * block_nr;
+	req.tp_retire_blk_tov = 10;
+
+	if (setsockopt(s, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req))) {
+		int err = errno;
+
+		close(s);
+		errno = err;
+		return -1;
+	}
+
+	return s;
+}
+
+static void bind_socket(int s, const char *ifname)
+{
+	struct sockaddr_ll ll = {
+		.sll_family = AF_PACKET,
+		.sll_protocol = htons(ETH_P_ALL),
+		.sll_ifindex = if_nametoindex(ifname),
+	};
+
+	if (!ll.sll_ifindex)
+		ksft_exit_fail_msg("no such interface %s\n", ifname);
+	if (bind(s, (void *)&ll, sizeof(ll)))
+		ksft_exit_fail_msg("bind: %s\n", strerror(errno));
+}
+
+/* Count a test packet: the payload carries the sender's CPU */
+static void check_packet(struct subring_reader *r, struct tpacket3_hdr *ppd)
+{
+	uint8_t *pkt = (uint8_t *)ppd + ppd->tp_mac;
+	struct iphdr *iph = (void *)(pkt + ETH_HLEN);
+	struct udphdr *uh;
+	uint32_t cpu;
+
+	if (ppd->tp_snaplen < ETH_HLEN + sizeof(*iph) + sizeof(*uh) +
+			      sizeof(cpu) || iph->protocol != IPPROTO_UDP)
+		return;
+
+	uh = (void *)iph + iph->ihl * 4;
+	if (ntohs(uh->dest) != TEST_PORT)
+		return;
+
+	memcpy(&cpu, uh + 1, sizeof(cpu));
+	r->test_packets++;
+	if (cpu % nr_rings != r->ring)
+		r->misplaced++;
+}
+
+/* Hand back every block user space owns in ring @r, return false if none */
+static bool walk_ring(struct subring_reader *r, int *cur)
+{
+	bool found = false;
+
+	for (;;) {
+		int blk = r->ring * BLOCKS_PER_RING + *cur;
+		struct tpacket_block_desc *pbd;
+		struct tpacket3_hdr *ppd;
+		unsigned int i;
+
+		pbd = (void *)(ring_mem + (size_t)blk * BLOCK_SIZE);
+		if (!(__atomic_load_n(&pbd->hdr.bh1.block_status,
+				      __ATOMIC_ACQUIRE) & TP_STATUS_USER))
+			return found;
+
+		found = true;
+		r->packets += pbd->hdr.bh1.num_pkts;
+		if (!cfg_ifname) {
+			ppd = (void *)pbd + pbd->hdr.bh1.offset_to_first_pkt;
+			for (i = 0; i < pbd->hdr.bh1.num_pkts; i++) {
+				check_packet(r, ppd);
+				ppd = (void *)ppd + ppd->tp_next_offset;
+			}
+		}
+
+		__atomic_store_n(&pbd->hdr.bh1.block_status, TP_STATUS_KERNEL,
+				 __ATOMIC_RELEASE);
+		*cur = (*cur + 1) % BLOCKS_PER_RING;
+	}
+}
+
+static void *reader(void *arg)
+{
+	struct subring_reader *r = arg;
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	int cur = 0;
+
+	pin_to_cpu(r->ring);
+
+	while (!stop) {
+		if (!walk_ring(r, &cur))
+			poll(&pfd, 1, 10);
+	}
+	walk_ring(r, &cur);
+
+	return NULL;
+}
+
+static void send_from_cpus(void)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(TEST_PORT),
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	uint32_t cpu;
+	int s, i;
+
+	s = socket(AF_INET, SOCK_DGRAM, 0);
+	if (s < 0)
+		ksft_exit_fail_msg("udp socket: %s\n", strerror(errno));
+
+	for (cpu = 0; cpu < nr_rings; cpu++) {
+		pin_to_cpu(cpu);
+		for (i = 0; i < PKTS_PER_CPU; i++) {
+			if (sendto(s, &cpu, sizeof(cpu), 0, (void *)&addr,
+				   sizeof(addr)) != sizeof(cpu))
+				ksft_exit_fail_msg("sendto: %s\n",
+						   strerror(errno));
+		}
+	}
+
+	close(s);
+}
+
+static void test_setup_errors(void)
+{
+	int s;
+
+	s = setup_socket(nr_rings, TPACKET_V2, nr_rings);
+	if (s >= 0 || errno != EINVAL)
+		ksft_test_result_fail("sub-rings accepted with TPACKET_V2\n");
+	else
+		ksft_test_result_pass("sub-rings need TPACKET_V3\n");
+	if (s >= 0)
+		close(s);
+
+	if (nr_rings < 2) {
+		ksft_test_result_skip("uneven block split needs 2 CPUs\n");
+		return;
+	}
+
+	s = setup_socket(nr_rings, TPACKET_V3, nr_rings + 1);
+	if (s >= 0 || errno != EINVAL)
+		ksft_test_result_fail("uneven block split accepted\n");
+	else
+		ksft_test_result_pass("blocks must split evenly\n");
+	if (s >= 0)
+		close(s);
+}
+
+int main(int argc, char **argv)
+{
+	struct subring_reader *readers;
+	struct tpacket_stats_v3 st;
+	socklen_t len = sizeof(st);
+	uint64_t total = 0, test_total = 0, misplaced = 0;
+	int c, i;
+
+	while ((c = getopt(argc, argv, "i:t:")) != -1) {
+		switch (c) {
+		case 'i':
+			cfg_ifname = optarg;
+			break;
+		case 't':
+			cfg_seconds = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-i ifname] [-t seconds]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	nr_rings = sysconf(_SC_NPROCESSORS_ONLN);
+
+	ksft_print_header();
+	ksft_set_plan(cfg_ifname ? 1 : 4);
+
+	if (!cfg_ifname)
+		test_setup_errors();
+
+	fd = setup_socket(nr_rings, TPACKET_V3, nr_rings * BLOCKS_PER_RING);
+	if (fd < 0)
+		ksft_exit_fail_msg("PACKET_RX_RING: %s\n", strerror(errno));
+
+	ring_mem = mmap(NULL, (size_t)BLOCK_SIZE * BLOCKS_PER_RING * nr_rings,
+			PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (ring_mem == MAP_FAILED)
+		ksft_exit_fail_msg("mmap: %s\n", strerror(errno));
+
+	bind_socket(fd, cfg_ifname ?: "lo");
+
+	readers = calloc(nr_rings, sizeof(*readers));
+	if (!readers)
+		ksft_exit_fail_msg("calloc\n");
+
+	for (i = 0; i < nr_rings; i++) {
+		readers[i].ring = i;
+		if (pthread_create(&readers[i].thread, NULL, reader,
+				   &readers[i]))
+			ksft_exit_fail_msg("pthread_create\n");
+	}
+
+	if (cfg_ifname) {
+		sleep(cfg_seconds);
+	} else {
+		send_from_cpus();
+		usleep(200 * 1000);
+	}
+
+	stop = true;
+	for (i = 0; i < nr_rings; i++) {
+		pthread_join(readers[i].thread, NULL);
+		total += readers[i].packets;
+		test_total += readers[i].test_packets;
+		misplaced += readers[i].misplaced;
+	}
+
+	if (getsockopt(fd, SOL_PACKET, PACKET_STATISTICS, &st, &len))
+		ksft_exit_fail_msg("PACKET_STATISTICS: %s\n", strerror(errno));
+
+	if (cfg_ifname) {
+		for (i = 0; i < nr_rings; i++)
+			ksft_print_msg("ring %d: %" PRIu64 " pps\n", i,
+				       readers[i].packets / cfg_seconds);
+		ksft_print_msg("total: %" PRIu64 " pps, drops %u, freezes %u\n",
+			       total / cfg_seconds, st.tp_drops,
+			       st.tp_freeze_q_cnt);
+		ksft_test_result(total > 0, "captured on %d sub-rings\n",
+				 nr_rings);
+	} else {
+		ksft_test_result(test_total == (uint64_t)PKTS_PER_CPU * nr_rings,
+				 "received %" PRIu64 "/%d test packets\n",
+				 test_total, PKTS_PER_CPU * nr_rings);
+		ksft_test_result(!misplaced,
+				 "%" PRIu64 " packets in another CPU's ring\n",
+				 misplaced);
+	}
+
+	munmap(ring_mem, (size_t)BLOCK_SIZE * BLOCKS_PER_RING * nr_rings);
+	close(fd);
+	free(readers);
+	ksft_finished();
+}
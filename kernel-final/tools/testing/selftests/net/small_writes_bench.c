@@ -0,0 +1,279 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Stream many small writes to a reader and report what the reader pays
+ * per byte: CPU time per MB and bytes per read().
+ *
+ * Runs in a private network namespace, over an AF_UNIX stream socket
+ * pair with net.unix.stream_coalesce off and on, and over TCP on lo
+ * (TCP_NODELAY) with GRO off and on.  Every run also checks that the
+ * byte stream arrives intact.
+ *
+ * Usage: small_writes_bench [-m write_size] [-s size_mb]
+ */
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/ethtool.h>
+#include <linux/sockios.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../kselftest.h"
+
+#define READ_SZ		(256 << 10)
+#define COALESCE_SYSCTL	"/proc/sys/net/unix/stream_coalesce"
+
+struct rx_stats {
+	uint64_t bytes;
+	uint64_t reads;
+	uint64_t cpu_ns;
+	int intact;
+};
+
+static size_t cfg_write_size = 64;
+static size_t cfg_size = 64;
+
+static inline char pattern(uint64_t off)
+{
+	return off % 251;
+}
+
+static uint64_t cpu_ns(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000ULL +
+	       (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000ULL;
+}
+
+static void receiver(int sk, struct rx_stats *st)
+{
+	static char buf[READ_SZ];
+	uint64_t start = cpu_ns();
+	ssize_t n, i;
+
+	memset(st, 0, sizeof(*st));
+	st->intact = 1;
+	while ((n = read(sk, buf, sizeof(buf))) > 0) {
+		for (i = 0; i < n; i++) {
+			if (buf[i] != pattern(st->bytes + i))
+				st->intact = 0;
+		}
+		st->bytes += n;
+		st->reads++;
+	}
+	if (n < 0)
+		st->intact = 0;
+	st->cpu_ns = cpu_ns() - start;
+}
+
+static int sender(int sk)
+{
+	uint64_t off = 0, total = (uint64_t)cfg_size << 20;
+	char *buf;
+	size_t i;
+
+	buf = malloc(cfg_write_size);
+	if (!buf)
+		return -1;
+
+	while (off < total) {
+		size_t len = total - off < cfg_write_size ? total - off :
+							     cfg_write_size;
+
+		for (i = 0; i < len; i++)
+			buf[i] = pattern(off + i);
+		if (write(sk, buf, len) != (ssize_t)len) {
+			free(buf);
+			return -1;
+		}
+		off += len;
+	}
+	free(buf);
+	return 0;
+}
+
+/* Connected TCP sockets over lo in sk[0] (sender) and sk[1] (receiver) */
+static int tcp_pair(int sk[2])
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	socklen_t len = sizeof(addr);
+	int one = 1, lsk;
+
+	lsk = socket(AF_INET, SOCK_STREAM, 0);
+	if (lsk < 0 || bind(lsk, (void *)&addr, sizeof(addr)) ||
+	    listen(lsk, 1) || getsockname(lsk, (void *)&addr, &len))
+		return -1;
+
+	sk[0] = socket(AF_INET, SOCK_STREAM, 0);
+	if (sk[0] < 0 || connect(sk[0], (void *)&addr, sizeof(addr)))
+		return -1;
+	setsockopt(sk[0], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	sk[1] = accept(lsk, NULL, NULL);
+	close(lsk);
+	return sk[1] < 0 ? -1 : 0;
+}
+
+static int run(int tcp, struct rx_stats *st)
+{
+	int sk[2], res[2], status;
+	pid_t pid;
+
+	if (tcp ? tcp_pair(sk) : socketpair(AF_UNIX, SOCK_STREAM, 0, sk))
+		return -1;
+	if (pipe(res))
+		return -1;
+
+	pid = fork();
+	if (pid < 0)
+		return -1;
+	if (!pid) {
+		close(sk[0]);
+		receiver(sk[1], st);
+		if (write(res[1], st, sizeof(*st)) != sizeof(*st))
+			_exit(1);
+		_exit(0);
+	}
+
+	close(sk[1]);
+	if (sender(sk[0]))
+		ksft_print_msg("sender failed: %s\n", strerror(errno));
+	close(sk[0]);
+
+	if (waitpid(pid, &status, 0) != pid ||
+	    !WIFEXITED(status) || WEXITSTATUS(status))
+		return -1;
+	if (read(res[0], st, sizeof(*st)) != sizeof(*st))
+		return -1;
+	close(res[0]);
+	close(res[1]);
+	return 0;
+}
+
+static void report(int tcp, const char *name)
+{
+	struct rx_stats st;
+
+	if (run(tcp, &st) || !st.intact ||
+	    st.bytes != (uint64_t)cfg_size << 20) {
+		ksft_test_result_fail("%s: stream corrupted or short\n", name);
+		return;
+	}
+	ksft_test_result_pass("%s: %.0f us CPU/MB, %.0f bytes/read\n", name,
+			      st.cpu_ns / 1000.0 / cfg_size,
+			      (double)st.bytes / st.reads);
+}
+
+static int set_coalesce(int on)
+{
+	int fd, ret;
+
+	fd = open(COALESCE_SYSCTL, O_WRONLY);
+	if (fd < 0)
+		return -1;
+	ret = write(fd, on ? "1" : "0", 1) == 1 ? 0 : -1;
+	close(fd);
+	return ret;
+}
+
+static int lo_ioctl(unsigned long req, struct ifreq *ifr)
+{
+	int fd, ret;
+
+	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd < 0)
+		return -1;
+	strcpy(ifr->ifr_name, "lo");
+	ret = ioctl(fd, req, ifr);
+	close(fd);
+	return ret;
+}
+
+static int set_lo_gro(int on)
+{
+	struct ethtool_value ev = { .cmd = ETHTOOL_SGRO, .data = on };
+	struct ifreq ifr = { .ifr_data = (void *)&ev };
+
+	return lo_ioctl(SIOCETHTOOL, &ifr);
+}
+
+static int lo_up(void)
+{
+	struct ifreq ifr = {};
+
+	if (lo_ioctl(SIOCGIFFLAGS, &ifr))
+		return -1;
+	ifr.ifr_flags |= IFF_UP;
+	return lo_ioctl(SIOCSIFFLAGS, &ifr);
+}
+
+int main(int argc, char **argv)
+{
+	int opt;
+
+	while ((opt = getopt(argc, argv, "m:s:")) != -1) {
+		switch (opt) {
+		case 'm':
+			cfg_write_size = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			cfg_size = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr,
+				"Usage: %s [-m write_size] [-s size_mb]\n",
+				argv[0]);
+			return KSFT_FAIL;
+		}
+	}
+	if (!cfg_write_size || !cfg_size)
+		ksft_exit_fail_msg("sizes must be non-zero\n");
+
+	ksft_print_header();
+	ksft_set_plan(4);
+
+	if (unshare(CLONE_NEWNET))
+		ksft_exit_skip("unshare(CLONE_NEWNET): %s\n", strerror(errno));
+	if (lo_up())
+		ksft_exit_fail_msg("cannot bring up lo: %s\n", strerror(errno));
+
+	ksft_print_msg("%zu MB in %zu byte writes\n", cfg_size,
+		       cfg_write_size);
+
+	if (set_coalesce(0)) {
+		ksft_test_result_skip("unix: no " COALESCE_SYSCTL "\n");
+		ksft_test_result_skip("unix coalesce: no " COALESCE_SYSCTL "\n");
+	} else {
+		report(0, "unix");
+		set_coalesce(1);
+		report(0, "unix coalesce");
+	}
+
+	if (set_lo_gro(0)) {
+		ksft_test_result_skip("tcp lo: cannot toggle GRO\n");
+		ksft_test_result_skip("tcp lo gro: cannot toggle GRO\n");
+	} else {
+		report(1, "tcp lo");
+		set_lo_gro(1);
+		report(1, "tcp lo gro");
+	}
+
+	ksft_finished();
+}
@@ -9,6 +9,7 @@
 #include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <linux/tls.h>
@@ -227,6 +228,27 @@ TEST_F(tls_basic, base_base)
 	EXPECT_EQ(memcmp(buf, test_str, send_len), 0);
 };
 
+/* TLS_TX_PARALLEL picks the TX cipher, it can't change after TLS_TX */
+TEST_F(tls_basic, tx_parallel_after_keys)
+{
+	struct tls_crypto_info_keys tls12;
+	int one = 1;
+	int ret;
+
+	if (self->notls)
+		SKIP(return, "no TLS support");
+
+	tls_crypto_info_init(TLS_1_2_VERSION, TLS_CIPHER_AES_GCM_128, &tls12);
+
+	ret = setsockopt(self->fd, SOL_TLS, TLS_TX, &tls12, tls12.len);
+	ASSERT_EQ(ret, 0);
+
+	ret = setsockopt(self->fd, SOL_TLS, TLS_TX_PARALLEL,
+			 (void *)&one, sizeof(one));
+	EXPECT_EQ(ret, -1);
+	EXPECT_EQ(errno, EBUSY);
+}
+
 FIXTURE(tls)
 {
 	int fd, cfd;
@@ -238,6 +260,7 @@ FIXTURE_VARIANT(tls)
 	uint16_t tls_version;
 	uint16_t cipher_type;
 	bool nopad, fips_non_compliant;
+	bool parallel;
 };
 
 FIXTURE_VARIANT_ADD(tls, 12_aes_gcm)
@@ -311,6 +334,20 @@ FIXTURE_VARIANT_ADD(tls, 13_nopad)
 	.nopad = true,
 };
 
+FIXTURE_VARIANT_ADD(tls, 12_aes_gcm_parallel)
+{
+	.tls_version = TLS_1_2_VERSION,
+	.cipher_type = TLS_CIPHER_AES_GCM_128,
+	.parallel = true,
+};
+
+FIXTURE_VARIANT_ADD(tls, 13_aes_gcm_parallel)
+{
+	.tls_version = TLS_1_3_VERSION,
+	.cipher_type = TLS_CIPHER_AES_GCM_128,
+	.parallel = true,
+};
+
 FIXTURE_SETUP(tls)
 {
 	struct tls_crypto_info_keys tls12;
@@ -328,6 +365,12 @@ FIXTURE_SETUP(tls)
 	if (self->notls)
 		return;
 
+	if (variant->parallel) {
+		ret = setsockopt(self->fd, SOL_TLS, TLS_TX_PARALLEL,
+				 (void *)&one, sizeof(one));
+		ASSERT_EQ(ret, 0);
+	}
+
 	ret = setsockopt(self->fd, SOL_TLS, TLS_TX, &tls12, tls12.len);
 	ASSERT_EQ(ret, 0);
 
@@ -631,6 +674,62 @@ TEST_F(tls, sendmsg_multiple_stress)
 		free(test_strs[i]);
 }
 
+/* Stream numbered words over many records and check they arrive in
+ * order, reporting the throughput.
+ */
+TEST_F(tls, stream_order)
+{
+	const size_t total = 64 << 20, chunk = 1 << 16;
+	struct timespec start, end;
+	unsigned int next = 0;
+	unsigned int *buf;
+	size_t left;
+	double secs;
+	int status;
+	pid_t pid;
+
+	buf = malloc(chunk);
+	ASSERT_NE(buf, NULL);
+
+	pid = fork();
+	ASSERT_GE(pid, 0);
+
+	if (!pid) {
+		unsigned int word = 0;
+		size_t i;
+
+		for (left = total; left; left -= chunk) {
+			for (i = 0; i < chunk / sizeof(*buf); i++)
+				buf[i] = word++;
+			if (send(self->fd, buf, chunk, 0) != chunk)
+				exit(1);
+		}
+		exit(0);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	left = total;
+	while (left) {
+		int res, i;
+
+		res = recv(self->cfd, buf, chunk, MSG_WAITALL);
+		ASSERT_EQ(res, chunk);
+		for (i = 0; i < res / sizeof(*buf); i++)
+			ASSERT_EQ(buf[i], next++);
+		left -= res;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	EXPECT_EQ(waitpid(pid, &status, 0), pid);
+	EXPECT_EQ(status, 0);
+
+	secs = end.tv_sec - start.tv_sec + (end.tv_nsec - start.tv_nsec) / 1e9;
+	TH_LOG("%zu MB in %.3fs: %.1f MB/s", total >> 20, secs,
+	       (total >> 20) / secs);
+
+	free(buf);
+}
+
 TEST_F(tls, splice_from_pipe)
 {
 	int send_len = TLS_PAYLOAD_MAX_LEN;
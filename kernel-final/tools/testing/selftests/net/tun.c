@@ -7,13 +7,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <arpa/inet.h>
 #include <linux/if.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
 #include <linux/if_tun.h>
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #include "../kselftest_harness.h"
 
@@ -159,4 +164,214 @@ TEST_F(tun, reattach_close_delete) {
 	EXPECT_EQ(tun_delete(self->ifname), 0);
 }
 
+#define MMSG_ETH_P	0x88b5	/* local experimental ethertype */
+#define MMSG_BATCH	16
+#define MMSG_FRAME_LEN	64
+#define MMSG_BENCH_PKTS	(256 * 1024)
+#define MMSG_BENCH_BATCH 64
+
+FIXTURE(tun_mmsg)
+{
+	char ifname[IFNAMSIZ];
+	int fd, pfd, ifindex;
+	unsigned char frames[MMSG_BENCH_BATCH][MMSG_FRAME_LEN];
+	struct iovec iov[MMSG_BENCH_BATCH];
+	struct tun_mmsghdr msgs[MMSG_BENCH_BATCH];
+};
+
+static void mmsg_build_frame(unsigned char *frame, unsigned int seq)
+{
+	struct ethhdr *eth = (struct ethhdr *)frame;
+
+	memset(frame, 0, MMSG_FRAME_LEN);
+	memset(eth->h_dest, 0xff, ETH_ALEN);
+	eth->h_source[0] = 0x02;
+	eth->h_proto = htons(MMSG_ETH_P);
+	memcpy(frame + ETH_HLEN, &seq, sizeof(seq));
+}
+
+static void mmsg_prepare(FIXTURE_DATA(tun_mmsg) *self, int nr)
+{
+	int i;
+
+	for (i = 0; i < nr; i++) {
+		mmsg_build_frame(self->frames[i], i);
+		self->iov[i].iov_base = self->frames[i];
+		self->iov[i].iov_len = MMSG_FRAME_LEN;
+		self->msgs[i].iov = (unsigned long)&self->iov[i];
+		self->msgs[i].iovlen = 1;
+		self->msgs[i].len = 0;
+	}
+}
+
+static int mmsg_ioctl(int fd, unsigned long cmd, struct tun_mmsghdr *msgs,
+		      int nr, unsigned int flags)
+{
+	struct tun_mmsg args = {
+		.msgs = (unsigned long)msgs,
+		.nr = nr,
+		.flags = flags,
+	};
+
+	return ioctl(fd, cmd, &args);
+}
+
+static double mmsg_elapsed(struct timespec *start)
+{
+	struct timespec end;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (end.tv_sec - start->tv_sec) +
+	       (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+FIXTURE_SETUP(tun_mmsg)
+{
+	struct timeval tv = { .tv_sec = 1 };
+	struct sockaddr_ll ll = {};
+	struct ifreq ifr = {};
+	char path[128];
+	int sock, fd;
+
+	self->fd = open("/dev/net/tun", O_RDWR);
+	ASSERT_GE(self->fd, 0);
+
+	ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+	ASSERT_EQ(ioctl(self->fd, TUNSETIFF, &ifr), 0);
+	strcpy(self->ifname, ifr.ifr_name);
+
+	/* Keep IPv6 autoconf from writing to the tap */
+	snprintf(path, sizeof(path), "/proc/sys/net/ipv6/conf/%s/disable_ipv6",
+		 self->ifname);
+	fd = open(path, O_WRONLY);
+	if (fd >= 0) {
+		ASSERT_EQ(write(fd, "1", 1), 1);
+		close(fd);
+	}
+
+	sock = socket(AF_INET, SOCK_DGRAM, 0);
+	ASSERT_GE(sock, 0);
+	ASSERT_EQ(ioctl(sock, SIOCGIFFLAGS, &ifr), 0);
+	ifr.ifr_flags |= IFF_UP | IFF_NOARP;
+	ASSERT_EQ(ioctl(sock, SIOCSIFFLAGS, &ifr), 0);
+	ASSERT_EQ(ioctl(sock, SIOCGIFINDEX, &ifr), 0);
+	self->ifindex = ifr.ifr_ifindex;
+	close(sock);
+
+	self->pfd = socket(AF_PACKET, SOCK_RAW, htons(MMSG_ETH_P));
+	ASSERT_GE(self->pfd, 0);
+	ll.sll_family = AF_PACKET;
+	ll.sll_protocol = htons(MMSG_ETH_P);
+	ll.sll_ifindex = self->ifindex;
+	ASSERT_EQ(bind(self->pfd, (void *)&ll, sizeof(ll)), 0);
+	ASSERT_EQ(setsockopt(self->pfd, SOL_SOCKET, SO_RCVTIMEO, &tv,
+			     sizeof(tv)), 0);
+}
+
+FIXTURE_TEARDOWN(tun_mmsg)
+{
+	close(self->pfd);
+	close(self->fd);
+}
+
+TEST_F(tun_mmsg, send_batch)
+{
+	unsigned char buf[2048];
+	unsigned int seq;
+	int i;
+
+	mmsg_prepare(self, MMSG_BATCH);
+	ASSERT_EQ(mmsg_ioctl(self->fd, TUNSENDMMSG, self->msgs, MMSG_BATCH, 0),
+		  MMSG_BATCH);
+
+	for (i = 0; i < MMSG_BATCH; i++) {
+		EXPECT_EQ(self->msgs[i].len, MMSG_FRAME_LEN);
+		ASSERT_EQ(recv(self->pfd, buf, sizeof(buf), 0), MMSG_FRAME_LEN);
+		memcpy(&seq, buf + ETH_HLEN, sizeof(seq));
+		EXPECT_EQ(seq, i);
+	}
+}
+
+TEST_F(tun_mmsg, send_bad_frame_stops_batch)
+{
+	mmsg_prepare(self, MMSG_BATCH);
+	/* Too short for an Ethernet header */
+	self->iov[4].iov_len = ETH_HLEN - 1;
+
+	ASSERT_EQ(mmsg_ioctl(self->fd, TUNSENDMMSG, self->msgs, MMSG_BATCH, 0), 4);
+	self->msgs[0].iov = (unsigned long)&self->iov[4];
+	ASSERT_EQ(mmsg_ioctl(self->fd, TUNSENDMMSG, self->msgs, 1, 0), -1);
+	EXPECT_EQ(errno, EINVAL);
+}
+
+TEST_F(tun_mmsg, recv_batch)
+{
+	struct sockaddr_ll ll = {};
+	unsigned int seq;
+	int i, n;
+
+	ll.sll_family = AF_PACKET;
+	ll.sll_ifindex = self->ifindex;
+	ll.sll_halen = ETH_ALEN;
+	memset(ll.sll_addr, 0xff, ETH_ALEN);
+
+	mmsg_prepare(self, MMSG_BATCH);
+	for (i = 0; i < MMSG_BATCH; i++)
+		ASSERT_EQ(sendto(self->pfd, self->frames[i], MMSG_FRAME_LEN, 0,
+				 (void *)&ll, sizeof(ll)), MMSG_FRAME_LEN);
+
+	memset(self->frames, 0, sizeof(self->frames));
+	n = mmsg_ioctl(self->fd, TUNRECVMMSG, self->msgs, MMSG_BENCH_BATCH,
+		       MSG_DONTWAIT);
+	ASSERT_EQ(n, MMSG_BATCH);
+	for (i = 0; i < n; i++) {
+		EXPECT_EQ(self->msgs[i].len, MMSG_FRAME_LEN);
+		memcpy(&seq, self->frames[i] + ETH_HLEN, sizeof(seq));
+		EXPECT_EQ(seq, i);
+	}
+
+	ASSERT_EQ(mmsg_ioctl(self->fd, TUNRECVMMSG, self->msgs, 1, MSG_DONTWAIT), -1);
+	EXPECT_EQ(errno, EAGAIN);
+}
+
+TEST_F(tun_mmsg, bad_args)
+{
+	mmsg_prepare(self, 1);
+	ASSERT_EQ(mmsg_ioctl(self->fd, TUNSENDMMSG, self->msgs, 0, 0), -1);
+	EXPECT_EQ(errno, EINVAL);
+	ASSERT_EQ(mmsg_ioctl(self->fd, TUNSENDMMSG, self->msgs, 1, MSG_PEEK), -1);
+	EXPECT_EQ(errno, EINVAL);
+}
+
+/* Compare pps of write() against TUNSENDMMSG for the same frames */
+TEST_F(tun_mmsg, send_pps)
+{
+	struct timespec start;
+	double single, batched;
+	int i, n;
+
+	/* Nobody reads in this test */
+	close(self->pfd);
+	self->pfd = -1;
+
+	mmsg_prepare(self, MMSG_BENCH_BATCH);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < MMSG_BENCH_PKTS; i++)
+		ASSERT_EQ(write(self->fd, self->frames[i % MMSG_BENCH_BATCH],
+				MMSG_FRAME_LEN), MMSG_FRAME_LEN);
+	single = MMSG_BENCH_PKTS / mmsg_elapsed(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < MMSG_BENCH_PKTS; i += n) {
+		n = mmsg_ioctl(self->fd, TUNSENDMMSG, self->msgs,
+			       MMSG_BENCH_BATCH, 0);
+		ASSERT_EQ(n, MMSG_BENCH_BATCH);
+	}
+	batched = MMSG_BENCH_PKTS / mmsg_elapsed(&start);
+
+	TH_LOG("write(): %.0f pps, TUNSENDMMSG x%d: %.0f pps",
+	       single, MMSG_BENCH_BATCH, batched);
+}
+
 TEST_HARNESS_MAIN
@@ -0,0 +1,98 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Resize the conntrack hash table while it holds entries and check
+# that every entry is still there and can still be found afterwards.
+
+sfx=$(mktemp -u "XXXXXXXX")
+ns="ns-$sfx"
+
+# Kselftest framework requirement - SKIP code is 4.
+ksft_skip=4
+
+entries=20000
+ret=0
+
+sysctl_dir=/proc/sys/net/netfilter
+
+cleanup()
+{
+	[ -n "$old_max" ] && echo "$old_max" > $sysctl_dir/nf_conntrack_max
+	[ -n "$old_buckets" ] && echo "$old_buckets" > $sysctl_dir/nf_conntrack_buckets
+	ip netns del $ns
+}
+
+checktool (){
+	if ! $1 > /dev/null 2>&1; then
+		echo "SKIP: Could not $2"
+		exit $ksft_skip
+	fi
+}
+
+checktool "ip -Version" "run test without ip tool"
+checktool "conntrack -V" "run test without conntrack tool"
+checktool "ip netns add $ns" "create net namespace"
+
+trap cleanup EXIT
+
+if [ ! -w $sysctl_dir/nf_conntrack_buckets ]; then
+	echo "SKIP: nf_conntrack_buckets is not writeable"
+	exit $ksft_skip
+fi
+
+old_buckets=$(cat $sysctl_dir/nf_conntrack_buckets)
+old_max=$(cat $sysctl_dir/nf_conntrack_max)
+echo $((entries * 2)) > $sysctl_dir/nf_conntrack_max
+
+for i in $(seq 1 $entries); do
+	echo "-I -s 10.$((i >> 16)).$(((i >> 8) & 255)).$((i & 255)) -d 10.255.0.1 -p udp --sport $((1024 + (i & 0x7fff))) --dport 53 -t 3600"
+done | ip netns exec $ns conntrack --load-file - 2>/dev/null
+
+count_entries()
+{
+	ip netns exec $ns conntrack -C
+}
+
+check_entries()
+{
+	local what=$1
+	local count
+	local i
+
+	count=$(count_entries)
+	if [ "$count" -ne $entries ]; then
+		echo "FAIL: $what: have $count entries, expected $entries"
+		ret=1
+		return
+	fi
+
+	for i in 1 $((entries / 2)) $entries; do
+		if ! ip netns exec $ns conntrack -G -s 10.$((i >> 16)).$(((i >> 8) & 255)).$((i & 255)) -d 10.255.0.1 -p udp --sport $((1024 + (i & 0x7fff))) --dport 53 > /dev/null 2>&1; then
+			echo "FAIL: $what: entry $i not found"
+			ret=1
+			return
+		fi
+	done
+
+	echo "PASS: $what: $count entries"
+}
+
+check_entries "before resize"
+
+resizes=$(cat $sysctl_dir/nf_conntrack_buckets_resizes 2>/dev/null)
+
+echo $((old_buckets * 16)) > $sysctl_dir/nf_conntrack_buckets
+check_entries "grow to $(cat $sysctl_dir/nf_conntrack_buckets) buckets"
+
+echo 1024 > $sysctl_dir/nf_conntrack_buckets
+check_entries "shrink to $(cat $sysctl_dir/nf_conntrack_buckets) buckets"
+
+if [ -n "$resizes" ]; then
+	now=$(cat $sysctl_dir/nf_conntrack_buckets_resizes)
+	if [ $((now - resizes)) -lt 2 ]; then
+		echo "FAIL: resize counter went from $resizes to $now"
+		ret=1
+	fi
+fi
+
+exit $ret
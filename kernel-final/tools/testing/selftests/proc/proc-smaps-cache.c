@@ -0,0 +1,137 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Test that /proc/self/smaps_rollup reports the same anonymous memory with
+ * vm.smaps_cache enabled as with it disabled, across faults, unmaps and
+ * pages becoming shared with a child.
+ */
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define SIZE	(64UL << 20)
+
+static const char sysctl_path[] = "/proc/sys/vm/smaps_cache";
+
+struct rollup {
+	unsigned long anonymous;
+	unsigned long pss_anon;
+	unsigned long swap;
+};
+
+static int set_cache(char c)
+{
+	int fd = open(sysctl_path, O_WRONLY);
+	int rv;
+
+	if (fd == -1)
+		return -1;
+	rv = write(fd, &c, 1) == 1 ? 0 : -1;
+	close(fd);
+	return rv;
+}
+
+static unsigned long field(const char *buf, const char *name)
+{
+	const char *p = strstr(buf, name);
+
+	assert(p);
+	return strtoul(p + strlen(name), NULL, 10);
+}
+
+/* Static buffer, so that reading doesn't change the anonymous memory */
+static char buf[4096];
+
+static struct rollup read_rollup(char cache)
+{
+	struct rollup r;
+	ssize_t len;
+	int fd;
+
+	assert(set_cache(cache) == 0);
+	fd = open("/proc/self/smaps_rollup", O_RDONLY);
+	assert(fd >= 0);
+	len = read(fd, buf, sizeof(buf) - 1);
+	assert(len > 0);
+	buf[len] = '\0';
+	close(fd);
+
+	r.anonymous = field(buf, "\nAnonymous:");
+	r.pss_anon = field(buf, "\nPss_Anon:");
+	r.swap = field(buf, "\nSwap:");
+	return r;
+}
+
+static void check(void)
+{
+	struct rollup uncached = read_rollup('0');
+	struct rollup cached = read_rollup('1');
+	struct rollup again = read_rollup('1');
+
+	assert(cached.anonymous == uncached.anonymous);
+	assert(cached.pss_anon == uncached.pss_anon);
+	assert(cached.swap == uncached.swap);
+	assert(again.anonymous == cached.anonymous);
+	assert(again.pss_anon == cached.pss_anon);
+	assert(again.swap == cached.swap);
+}
+
+int main(void)
+{
+	int pipefd[2];
+	char *p;
+	pid_t pid;
+
+	if (access(sysctl_path, W_OK))
+		return 4;
+	if (set_cache('1'))
+		return 4;
+
+	p = mmap(NULL, SIZE, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	assert(p != MAP_FAILED);
+
+	/* Fill the cache, then fault everything in */
+	check();
+	memset(p, 1, SIZE);
+	check();
+
+	/* Unmap a range in the middle */
+	assert(madvise(p + SIZE / 4, SIZE / 4, MADV_DONTNEED) == 0);
+	check();
+
+	/* Share everything with a child: PSS halves */
+	assert(pipe(pipefd) == 0);
+	pid = fork();
+	assert(pid >= 0);
+	if (pid == 0) {
+		char c;
+
+		close(pipefd[1]);
+		read(pipefd[0], &c, 1);
+		_exit(0);
+	}
+	close(pipefd[0]);
+	check();
+
+	/* Break sharing of a range by writing to it */
+	memset(p, 2, SIZE / 8);
+	check();
+
+	/* And once the child is gone, everything is exclusive again */
+	close(pipefd[1]);
+	assert(waitpid(pid, NULL, 0) == pid);
+	check();
+
+	munmap(p, SIZE);
+	check();
+
+	set_cache('0');
+	return 0;
+}